@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <arith_uint256.h>
 #include <chainparams.h>
 #include <coins.h>
 #include <consensus/merkle.h>
@@ -121,4 +122,85 @@ static void AssembleBlock(benchmark::State& state)
     GetMainSignals().UnregisterBackgroundSignalScheduler();
 }
 
+/** Fill the mempool with parent and child transactions that do not fit in one
+ *  block and prepare PoS blocks from it. The full variant selects the packages
+ *  from the whole mempool for every block, the incremental variant starts from
+ *  the selection of the previous block kept in the mempool. */
+static void AssembleBlockPoS(benchmark::State& state, bool incremental)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+
+    boost::thread_group thread_group;
+    CScheduler scheduler;
+    if (::chainActive.Tip() == nullptr) {
+        InitScriptExecutionCache();
+        {
+            LOCK(cs_main);
+            ::pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+            ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+            ::pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        }
+        thread_group.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
+        GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+        LoadGenesisBlock(Params());
+        CValidationState state;
+        ActivateBestChain(state, Params());
+        assert(::chainActive.Tip() != nullptr);
+        thread_group.interrupt_all();
+        thread_group.join_all();
+        GetMainSignals().FlushBackgroundCallbacks();
+        GetMainSignals().UnregisterBackgroundSignalScheduler();
+    }
+
+    // The transactions spend outputs that do not exist, blocks are prepared
+    // without checking their validity
+    constexpr int NUM_PACKAGES{5000};
+    {
+        LOCK2(cs_main, ::mempool.cs);
+        LockPoints lp;
+        for (int i = 0; i < NUM_PACKAGES; ++i) {
+            CMutableTransaction parent;
+            parent.vin.emplace_back(COutPoint(ArithToUint256(arith_uint256(i + 1)), 0));
+            parent.vin[0].scriptWitness.stack.push_back({1});
+            parent.vout.emplace_back(COIN, CScript() << OP_TRUE);
+            const CTransactionRef parent_ref = MakeTransactionRef(parent);
+            ::mempool.addUnchecked(CTxMemPoolEntry(parent_ref, 1000 + (i * 7919) % 10000, 0, 1, false, 4, lp));
+
+            CMutableTransaction child;
+            child.vin.emplace_back(COutPoint(parent_ref->GetHash(), 0));
+            child.vin[0].scriptWitness.stack.push_back({1});
+            child.vout.emplace_back(COIN / 2, CScript() << OP_TRUE);
+            ::mempool.addUnchecked(CTxMemPoolEntry(MakeTransactionRef(child), 1000 + (i * 6007) % 20000, 0, 1, false, 4, lp));
+        }
+    }
+
+    BlockAssembler::Options options;
+    options.nBlockMaxWeight = 400000;
+    BlockAssembler assembler(Params(), options);
+    assembler.PrepareBlockPoS();
+
+    while (state.KeepRunning()) {
+        if (!incremental) {
+            LOCK(::mempool.cs);
+            ::mempool.blockCandidate.Clear();
+        }
+        assembler.PrepareBlockPoS();
+    }
+
+    LOCK2(cs_main, ::mempool.cs);
+    ::mempool.clear();
+}
+
+static void AssembleBlockPoSFull(benchmark::State& state)
+{
+    AssembleBlockPoS(state, false);
+}
+
+static void AssembleBlockPoSIncremental(benchmark::State& state)
+{
+    AssembleBlockPoS(state, true);
+}
+
 BENCHMARK(AssembleBlock, 700);
+BENCHMARK(AssembleBlockPoSFull, 50);
+BENCHMARK(AssembleBlockPoSIncremental, 50);
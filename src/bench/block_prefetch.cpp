@@ -0,0 +1,53 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/chain_setup.h>
+#include <node/blockprefetch.h>
+
+// Disconnect the chain down to the genesis block and connect it again from
+// disk, with the blocks read ahead of ConnectTip by the given number of
+// threads (none reads each block on the validation thread). Each iteration
+// connects the whole chain, blocks/sec is its length over the iteration time.
+static void ReconnectChain(benchmark::State& state, int n_threads)
+{
+    RegtestBenchChain chain;
+    const CChainParams& chainparams = Params();
+    if (n_threads > 0) {
+        g_block_prefetcher = MakeUnique<BlockPrefetcher>(chainparams.GetConsensus(), n_threads, DEFAULT_BLOCK_PREFETCH);
+    }
+
+    CBlockIndex* pindex_first;
+    {
+        LOCK(cs_main);
+        pindex_first = ::chainActive[1];
+    }
+
+    while (state.KeepRunning()) {
+        CValidationState val_state;
+        bool ok = InvalidateBlock(val_state, chainparams, pindex_first);
+        assert(ok);
+        {
+            LOCK(cs_main);
+            ResetBlockFailureFlags(pindex_first);
+        }
+        ok = ActivateBestChain(val_state, chainparams);
+        assert(ok);
+    }
+
+    g_block_prefetcher.reset();
+}
+
+static void ConnectBlocksFromDisk(benchmark::State& state)
+{
+    ReconnectChain(state, 0);
+}
+
+static void ConnectBlocksPrefetched(benchmark::State& state)
+{
+    ReconnectChain(state, BLOCK_PREFETCH_THREADS);
+}
+
+BENCHMARK(ConnectBlocksFromDisk, 5);
+BENCHMARK(ConnectBlocksPrefetched, 5);
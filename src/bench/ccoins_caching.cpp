@@ -4,9 +4,12 @@
 
 #include <bench/bench.h>
 #include <coins.h>
+#include <flatmap.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <wallet/crypter.h>
 
+#include <unordered_map>
 #include <vector>
 
 // FIXME: Dedup with SetupDummyInputs in test/transaction_tests.cpp.
@@ -86,3 +89,47 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+// Look up, insert and erase the entries of random outpoints in a coins map.
+// Compares std::unordered_map with the open addressing map used with
+// --enable-flat-coins-map.
+template <typename Map>
+static void CoinsMapAccess(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i < 100000; ++i) {
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+    }
+    Map map;
+    for (size_t i = 0; i < outpoints.size(); i += 2) {
+        map[outpoints[i]].coin.nHeight = i;
+    }
+
+    while (state.KeepRunning()) {
+        for (size_t i = 1; i < outpoints.size(); i += 2) {
+            map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoints[i]), std::tuple<>());
+        }
+        size_t found = 0;
+        for (const COutPoint& outpoint : outpoints) {
+            found += map.find(outpoint) != map.end();
+        }
+        assert(found == outpoints.size());
+        for (size_t i = 1; i < outpoints.size(); i += 2) {
+            map.erase(outpoints[i]);
+        }
+    }
+}
+
+static void CoinsMapUnordered(benchmark::State& state)
+{
+    CoinsMapAccess<std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher>>(state);
+}
+
+static void CoinsMapFlat(benchmark::State& state)
+{
+    CoinsMapAccess<flatmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher>>(state);
+}
+
+BENCHMARK(CoinsMapUnordered, 20);
+BENCHMARK(CoinsMapFlat, 20);
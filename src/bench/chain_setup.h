@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BENCH_CHAIN_SETUP_H
+#define BITCOIN_BENCH_CHAIN_SETUP_H
+
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <crypto/sha256.h>
+#include <miner.h>
+#include <pow.h>
+#include <scheduler.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/thread.hpp>
+
+/**
+ * Regtest chain of blocks paying to an OP_TRUE witness script, the second
+ * half of the blocks also spends coinbase outputs of the first half.
+ */
+class RegtestBenchChain
+{
+public:
+    RegtestBenchChain()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        InitScriptExecutionCache();
+        {
+            LOCK(cs_main);
+            ::pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+            ::pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+            ::pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        }
+        const CChainParams& chainparams = Params();
+        m_threads.create_thread(std::bind(&CScheduler::serviceQueue, &m_scheduler));
+        GetMainSignals().RegisterBackgroundSignalScheduler(m_scheduler);
+        LoadGenesisBlock(chainparams);
+        CValidationState state;
+        ActivateBestChain(state, chainparams);
+        assert(::chainActive.Tip() != nullptr);
+
+        const std::vector<unsigned char> op_true{OP_TRUE};
+        CScriptWitness witness;
+        witness.stack.push_back(op_true);
+        uint256 witness_program;
+        CSHA256().Write(&op_true[0], op_true.size()).Finalize(witness_program.begin());
+        const CScript script_pub{CScript(OP_0) << std::vector<unsigned char>{witness_program.begin(), witness_program.end()}};
+
+        const int maturity = chainparams.GetConsensus().coinMaturity;
+        std::vector<uint256> coinbases;
+        for (int b = 0; b < 2 * maturity; ++b) {
+            if (b >= maturity) {
+                CMutableTransaction tx;
+                tx.vin.emplace_back(coinbases[b - maturity], 0);
+                tx.vin.back().scriptWitness = witness;
+                tx.vout.emplace_back(1337, script_pub);
+                LOCK(::cs_main);
+                CValidationState tx_state;
+                bool ret{::AcceptToMemoryPool(::mempool, tx_state, MakeTransactionRef(tx), nullptr /* pfMissingInputs */,
+                                              nullptr /* plTxnReplaced */, false /* bypass_limits */, /* nAbsurdFee */ 0)};
+                assert(ret);
+            }
+            coinbases.push_back(MineBlock(script_pub));
+        }
+    }
+
+    ~RegtestBenchChain()
+    {
+        m_threads.interrupt_all();
+        m_threads.join_all();
+        GetMainSignals().FlushBackgroundCallbacks();
+        GetMainSignals().UnregisterBackgroundSignalScheduler();
+        ::mempool.clear();
+        UnloadBlockIndex();
+        ::pcoinsTip.reset();
+        ::pcoinsdbview.reset();
+        ::pblocktree.reset();
+    }
+
+private:
+    static uint256 MineBlock(const CScript& coinbase_scriptPubKey)
+    {
+        auto block = std::make_shared<CBlock>(BlockAssembler{Params()}.CreateNewBlock(coinbase_scriptPubKey)->block);
+        block->nTime = ::chainActive.Tip()->GetMedianTimePast() + 1;
+        block->hashMerkleRoot = BlockMerkleRoot(*block);
+        while (!CheckProofOfWork(block->GetHash(), block->nBits, Params().GetConsensus())) {
+            ++block->nNonce;
+            assert(block->nNonce);
+        }
+        bool processed{ProcessNewBlock(Params(), block, true, nullptr)};
+        assert(processed);
+        return block->vtx[0]->GetHash();
+    }
+
+    boost::thread_group m_threads;
+    CScheduler m_scheduler;
+};
+
+#endif // BITCOIN_BENCH_CHAIN_SETUP_H
@@ -0,0 +1,41 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/chain_setup.h>
+#include <index/addressindex.h>
+#include <util/system.h>
+#include <util/time.h>
+
+// Build an address index (in memory) from scratch with the given number of
+// sync threads reading and preparing blocks ahead of the commits.
+static void BuildAddressIndex(benchmark::State& state, int n_threads)
+{
+    RegtestBenchChain chain;
+    gArgs.ForceSetArg("-indexsyncthreads", std::to_string(n_threads));
+
+    while (state.KeepRunning()) {
+        AddressIndex index(1 << 20, true, true);
+        index.Start();
+        while (!index.BlockUntilSyncedToCurrentChain()) {
+            MilliSleep(1);
+        }
+        index.Stop();
+    }
+
+    gArgs.ForceSetArg("-indexsyncthreads", std::to_string(DEFAULT_INDEX_SYNC_THREADS));
+}
+
+static void IndexSyncSingleThread(benchmark::State& state)
+{
+    BuildAddressIndex(state, 1);
+}
+
+static void IndexSyncPipelined(benchmark::State& state)
+{
+    BuildAddressIndex(state, 4);
+}
+
+BENCHMARK(IndexSyncSingleThread, 10);
+BENCHMARK(IndexSyncPipelined, 10);
@@ -0,0 +1,105 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/chain_setup.h>
+#include <arith_uint256.h>
+#include <key.h>
+#include <keystore.h>
+#include <policy/policy.h>
+#include <script/sigcache.h>
+#include <script/sign.h>
+#include <util/system.h>
+
+#include <boost/thread.hpp>
+
+/** Number of transactions accepted per iteration */
+static constexpr int NUM_TXS{500};
+
+static void ResetScriptCaches()
+{
+    // Shrinking the caches drops their entries, each iteration verifies all
+    // signatures like a burst of new transactions
+    gArgs.ForceSetArg("-maxsigcachesize", "0");
+    InitSignatureCache();
+    InitScriptExecutionCache();
+    gArgs.ForceSetArg("-maxsigcachesize", "8");
+    InitSignatureCache();
+    InitScriptExecutionCache();
+}
+
+// Accept a burst of independent P2WPKH spends to an empty mempool, one
+// transaction at a time or as a batch whose scripts are checked on the
+// script check threads.
+static void MempoolAccept(benchmark::State& state, bool batch)
+{
+    RegtestBenchChain chain;
+
+    CKey key;
+    key.MakeNewKey(true);
+    CBasicKeyStore keystore;
+    keystore.AddKey(key);
+    const CScript script_pub = GetScriptForDestination(WitnessV0KeyHash(key.GetPubKey().GetID()));
+
+    std::vector<CTransactionRef> txs;
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < NUM_TXS; ++i) {
+            CMutableTransaction tx;
+            tx.vin.emplace_back(COutPoint(ArithToUint256(arith_uint256(i + 1)), 0));
+            tx.vout.emplace_back(COIN - 10000, script_pub);
+            ::pcoinsTip->AddCoin(tx.vin[0].prevout, Coin(CTxOut(COIN, script_pub), 1, false), false);
+            bool signed_ok = SignSignature(keystore, script_pub, tx, 0, COIN, SIGHASH_ALL);
+            assert(signed_ok);
+            txs.push_back(MakeTransactionRef(tx));
+        }
+    }
+
+    boost::thread_group script_threads;
+    nScriptCheckThreads = std::max(GetNumCores(), 2);
+    for (int i = 0; i < nScriptCheckThreads - 1; ++i) {
+        script_threads.create_thread(&ThreadScriptCheck);
+    }
+
+    while (state.KeepRunning()) {
+        ResetScriptCaches();
+        LOCK(cs_main);
+        if (batch) {
+            std::vector<MempoolAcceptResult> results;
+            AcceptToMemoryPoolBatch(::mempool, txs, results, false /* bypass_limits */);
+            for (const MempoolAcceptResult& result : results) {
+                assert(result.accepted);
+            }
+        } else {
+            for (const CTransactionRef& tx : txs) {
+                CValidationState tx_state;
+                bool ret{::AcceptToMemoryPool(::mempool, tx_state, tx, nullptr /* pfMissingInputs */,
+                                              nullptr /* plTxnReplaced */, false /* bypass_limits */, /* nAbsurdFee */ 0)};
+                assert(ret);
+            }
+        }
+        LOCK(::mempool.cs);
+        ::mempool.clear();
+    }
+
+    script_threads.interrupt_all();
+    script_threads.join_all();
+    nScriptCheckThreads = 0;
+    gArgs.ForceSetArg("-maxsigcachesize", std::to_string(DEFAULT_MAX_SIG_CACHE_SIZE));
+    InitSignatureCache();
+    InitScriptExecutionCache();
+}
+
+static void MempoolAcceptSerial(benchmark::State& state)
+{
+    MempoolAccept(state, false);
+}
+
+static void MempoolAcceptBatch(benchmark::State& state)
+{
+    MempoolAccept(state, true);
+}
+
+BENCHMARK(MempoolAcceptSerial, 2);
+BENCHMARK(MempoolAcceptBatch, 2);
@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <txmempool.h>
 
 #include <list>
@@ -131,4 +132,49 @@ static void MempoolEviction(benchmark::State& state)
     }
 }
 
+// Fills a mempool with a thousand transactions, two thirds of which spend
+// outputs of earlier ones, so that entries have in-mempool parents and
+// children, then evicts half of the mempool by feerate and clears it.
+static void MempoolEvictionLinked(benchmark::State& state)
+{
+    FastRandomContext det_rand(true);
+    std::vector<CTransactionRef> txs;
+    std::vector<CAmount> fees;
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i < 1000; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        if (i % 3 != 0 && !outpoints.empty()) {
+            const size_t n = det_rand.randrange(outpoints.size());
+            tx.vin[0].prevout = outpoints[n];
+            outpoints[n] = outpoints.back();
+            outpoints.pop_back();
+        } else {
+            tx.vin[0].prevout = COutPoint(det_rand.rand256(), 0);
+        }
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(2);
+        for (CTxOut& txout : tx.vout) {
+            txout.scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            txout.nValue = 10 * COIN;
+        }
+        txs.push_back(MakeTransactionRef(tx));
+        fees.push_back(1000 + det_rand.randrange(10000));
+        outpoints.emplace_back(txs.back()->GetHash(), 0);
+        outpoints.emplace_back(txs.back()->GetHash(), 1);
+    }
+
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < txs.size(); ++i) {
+            AddTx(txs[i], fees[i], pool);
+        }
+        pool.TrimToSize(pool.DynamicMemoryUsage() / 2);
+        pool.TrimToSize(0);
+        assert(pool.size() == 0);
+    }
+}
+
 BENCHMARK(MempoolEviction, 41000);
+BENCHMARK(MempoolEvictionLinked, 20);
@@ -0,0 +1,156 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+#include <net.h>
+#include <util/system.h>
+
+#ifdef USE_EPOLL
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+/** Connections of a busy service node, most of them idle */
+static const int NUM_SOCKETS = 1000;
+
+static std::vector<SOCKET> OpenIdleSockets(std::vector<SOCKET>& peers)
+{
+    // Both ends of the socket pairs count against the descriptor limit
+    const int n_sockets = std::min(NUM_SOCKETS, (RaiseFileDescriptorLimit(2 * NUM_SOCKETS + 64) - 64) / 2);
+    std::vector<SOCKET> sockets;
+    for (int i = 0; i < n_sockets; ++i) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) break;
+        sockets.push_back(fds[0]);
+        peers.push_back(fds[1]);
+    }
+    return sockets;
+}
+
+static void CloseSockets(const std::vector<SOCKET>& sockets)
+{
+    for (SOCKET s : sockets) {
+        close(s);
+    }
+}
+
+// One round of the poll socket handler: the descriptor set is rebuilt and
+// every socket is checked by the kernel
+static void SocketEventsPoll(benchmark::State& state)
+{
+    std::vector<SOCKET> peers;
+    const std::vector<SOCKET> sockets = OpenIdleSockets(peers);
+
+    while (state.KeepRunning()) {
+        std::unordered_map<SOCKET, struct pollfd> pollfds;
+        for (SOCKET s : sockets) {
+            pollfds[s].fd = s;
+            pollfds[s].events |= POLLIN;
+            pollfds[s].events |= POLLERR|POLLHUP;
+        }
+        std::vector<struct pollfd> vpollfds;
+        vpollfds.reserve(pollfds.size());
+        for (auto it : pollfds) {
+            vpollfds.push_back(std::move(it.second));
+        }
+        int ret = poll(vpollfds.data(), vpollfds.size(), 0);
+        assert(ret == 0);
+    }
+
+    CloseSockets(sockets);
+    CloseSockets(peers);
+}
+
+// One round of the epoll socket handler: the sockets are registered once and
+// only ready sockets are returned
+static void SocketEventsEPoll(benchmark::State& state)
+{
+    std::vector<SOCKET> peers;
+    const std::vector<SOCKET> sockets = OpenIdleSockets(peers);
+
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    assert(epoll_fd != -1);
+    for (SOCKET s : sockets) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        event.data.fd = s;
+        int ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s, &event);
+        assert(ret == 0);
+    }
+
+    struct epoll_event events[1024];
+    while (state.KeepRunning()) {
+        int ret = epoll_wait(epoll_fd, events, 1024, 0);
+        assert(ret == 0);
+    }
+
+    close(epoll_fd);
+    CloseSockets(sockets);
+    CloseSockets(peers);
+}
+
+/** Socket handler of a node that is not started, net.h grants CConnmanTest access */
+struct CConnmanTest : public CConnman {
+    using CConnman::CConnman;
+
+    void AddNodes(const std::vector<SOCKET>& sockets)
+    {
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        assert(m_epoll_fd != -1);
+        LOCK(cs_vNodes);
+        for (SOCKET s : sockets) {
+            CNode* pnode = new CNode(GetNewNodeId(), NODE_NETWORK, 0, s, CAddress(), 0, 0, CAddress(), "", true);
+            pnode->AddRef();
+            RegisterSocketEvents(pnode);
+            vNodes.push_back(pnode);
+        }
+    }
+
+    void Round()
+    {
+        // Don't wait for events
+        m_epoll_more = true;
+        SocketHandler();
+    }
+
+    void ClearNodes()
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes) {
+            delete pnode;
+        }
+        vNodes.clear();
+        m_epoll_nodes.clear();
+    }
+};
+
+// One round of the epoll socket handler thread over idle connections, the
+// nodes of sockets without events are not visited
+static void SocketHandlerEPoll(benchmark::State& state)
+{
+    std::vector<SOCKET> peers;
+    const std::vector<SOCKET> sockets = OpenIdleSockets(peers);
+
+    CConnmanTest connman(0x1337, 0x1337);
+    connman.AddNodes(sockets);
+    while (state.KeepRunning()) {
+        connman.Round();
+    }
+
+    // The nodes close their sockets
+    connman.ClearNodes();
+    CloseSockets(peers);
+}
+
+BENCHMARK(SocketEventsPoll, 2000);
+BENCHMARK(SocketEventsEPoll, 2000);
+BENCHMARK(SocketHandlerEPoll, 2000);
+
+#endif // USE_EPOLL
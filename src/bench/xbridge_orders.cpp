@@ -0,0 +1,99 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <sync.h>
+#include <xbridge/util/shardedmap.h>
+#include <xbridge/xbridgetransactiondescr.h>
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+static const size_t ORDERS = 5000;
+static const int READERS = 2;
+
+static std::vector<uint256> OrderIds()
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> ids;
+    for (size_t i = 0; i < ORDERS; ++i)
+        ids.push_back(rng.rand256());
+    return ids;
+}
+
+// Order updates (packet processing) while rpc readers continuously copy the
+// complete order map under the same lock (previous xbridge::App behaviour).
+static void XBridgeOrdersLockedMap(benchmark::State& state)
+{
+    CCriticalSection cs;
+    std::map<uint256, xbridge::TransactionDescrPtr> orders;
+    const auto ids = OrderIds();
+    for (const auto & id : ids)
+        orders[id] = xbridge::TransactionDescrPtr(new xbridge::TransactionDescr);
+
+    std::atomic<bool> stop{false};
+    boost::thread_group readers;
+    for (int i = 0; i < READERS; ++i) {
+        readers.create_thread([&] {
+            while (!stop) {
+                std::map<uint256, xbridge::TransactionDescrPtr> copy;
+                {
+                    LOCK(cs);
+                    copy = orders;
+                }
+            }
+        });
+    }
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        const uint256 & id = ids[n++ % ids.size()];
+        LOCK(cs);
+        auto ptr = orders[id];
+        orders.erase(id);
+        orders[id] = ptr;
+    }
+    stop = true;
+    readers.join_all();
+}
+
+// Same workload against the sharded copy-on-write order map, readers take snapshots.
+static void XBridgeOrdersShardedMap(benchmark::State& state)
+{
+    xbridge::ShardedMap<xbridge::TransactionDescrPtr> orders;
+    const auto ids = OrderIds();
+    for (const auto & id : ids)
+        orders.set(id, xbridge::TransactionDescrPtr(new xbridge::TransactionDescr));
+
+    std::atomic<bool> stop{false};
+    boost::thread_group readers;
+    for (int i = 0; i < READERS; ++i) {
+        readers.create_thread([&] {
+            while (!stop) {
+                std::vector<xbridge::TransactionDescrPtr> list;
+                list.reserve(ORDERS);
+                const auto snapshot = orders.snapshot();
+                for (const auto & item : snapshot)
+                    list.push_back(item.second);
+            }
+        });
+    }
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        const uint256 & id = ids[n++ % ids.size()];
+        xbridge::TransactionDescrPtr ptr;
+        orders.extract(id, ptr);
+        orders.set(id, ptr);
+    }
+    stop = true;
+    readers.join_all();
+}
+
+BENCHMARK(XBridgeOrdersLockedMap, 2000);
+BENCHMARK(XBridgeOrdersShardedMap, 20000);
@@ -6,6 +6,7 @@
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <chainparams.h>
+#include <core_memusage.h>
 #include <crypto/sha256.h>
 #include <crypto/siphash.h>
 #include <random.h>
@@ -16,15 +17,24 @@
 
 #include <unordered_map>
 
+// The coinbase and the coinstake of a proof of stake block are created by the
+// block producer, no peer has them yet.
+static size_t PrefilledTxCount(const CBlock& block) {
+    return block.IsProofOfStake() ? 2 : 1;
+}
+
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
-        shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
+        shorttxids(block.vtx.size() - PrefilledTxCount(block)), prefilledtxn(PrefilledTxCount(block)), header(block) {
     FillShortTxIDSelector();
-    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
-    prefilledtxn[0] = {0, block.vtx[0]};
-    for (size_t i = 1; i < block.vtx.size(); i++) {
+    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase and coinstake
+    for (size_t i = 0; i < prefilledtxn.size(); i++) {
+        // Indexes are differentially encoded
+        prefilledtxn[i] = {0, block.vtx[i]};
+    }
+    for (size_t i = prefilledtxn.size(); i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        shorttxids[i - 1] = GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
+        shorttxids[i - prefilledtxn.size()] = GetShortID(fUseWTXID ? tx.GetWitnessHash() : tx.GetHash());
     }
 }
 
@@ -133,6 +143,8 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     }
 
     for (size_t i = 0; i < extra_txn.size(); i++) {
+        if (!extra_txn[i].second)
+            continue;
         uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
         std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
         if (idit != shorttxids.end()) {
@@ -168,6 +180,40 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     return READ_STATUS_OK;
 }
 
+void ExtraTxnPool::RemoveOldest() {
+    std::pair<uint256, CTransactionRef>& entry = m_txn[m_oldest];
+    m_wtxids.erase(entry.first);
+    m_bytes -= RecursiveDynamicUsage(entry.second);
+    entry = std::make_pair(uint256(), CTransactionRef());
+    m_oldest = (m_oldest + 1) % m_max_count;
+    m_count--;
+}
+
+void ExtraTxnPool::Add(const CTransactionRef& tx) {
+    if (m_max_count == 0)
+        return;
+    const size_t tx_bytes = RecursiveDynamicUsage(tx);
+    if (tx_bytes > m_max_bytes || !m_wtxids.insert(tx->GetWitnessHash()).second)
+        return;
+    if (m_txn.empty())
+        m_txn.resize(m_max_count);
+
+    // Drop the oldest transactions to make room
+    while (m_count > 0 && (m_count == m_max_count || m_bytes + tx_bytes > m_max_bytes))
+        RemoveOldest();
+
+    m_txn[(m_oldest + m_count) % m_max_count] = std::make_pair(tx->GetWitnessHash(), tx);
+    m_count++;
+    m_bytes += tx_bytes;
+}
+
+void ExtraTxnPool::RecordBlock(size_t txn_hit) {
+    m_blocks++;
+    if (txn_hit > 0)
+        m_blocks_hit++;
+    m_txn_hit += txn_hit;
+}
+
 bool PartiallyDownloadedBlock::IsTxAvailable(size_t index) const {
     assert(!header.IsNull());
     assert(index < txn_available.size());
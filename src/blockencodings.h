@@ -8,6 +8,7 @@
 #include <primitives/block.h>
 
 #include <memory>
+#include <set>
 
 class CTxMemPool;
 
@@ -194,6 +195,43 @@ public:
     }
 };
 
+/**
+ * Transactions that are not in the mempool but may be in upcoming blocks,
+ * e.g. orphans and transactions that were rejected by policy, replaced or
+ * evicted from the mempool, in <witness hash, reference> form. Compact
+ * blocks look them up to avoid a getblocktxn round trip. A transaction is
+ * kept once, the oldest transactions are dropped first when the pool holds
+ * max_count transactions or more than max_bytes of them.
+ */
+class ExtraTxnPool {
+private:
+    const size_t m_max_count;
+    const size_t m_max_bytes;
+    //! Ring buffer of max_count slots, the slots of dropped transactions are null
+    std::vector<std::pair<uint256, CTransactionRef>> m_txn;
+    size_t m_oldest = 0;
+    size_t m_count = 0;
+    size_t m_bytes = 0;
+    std::set<uint256> m_wtxids;
+
+    uint64_t m_blocks = 0, m_blocks_hit = 0, m_txn_hit = 0;
+
+    void RemoveOldest();
+public:
+    ExtraTxnPool(size_t max_count, size_t max_bytes) : m_max_count(max_count), m_max_bytes(max_bytes) {}
+
+    void Add(const CTransactionRef& tx);
+    const std::vector<std::pair<uint256, CTransactionRef>>& Get() const { return m_txn; }
+    size_t Count() const { return m_count; }
+    size_t Bytes() const { return m_bytes; }
+
+    //! Count a compact block and the transactions it found in the pool.
+    void RecordBlock(size_t txn_hit);
+    uint64_t Blocks() const { return m_blocks; }
+    uint64_t BlocksHit() const { return m_blocks_hit; }
+    uint64_t TxnHit() const { return m_txn_hit; }
+};
+
 class PartiallyDownloadedBlock {
 protected:
     std::vector<CTransactionRef> txn_available;
@@ -203,9 +241,12 @@ public:
     CBlockHeader header;
     explicit PartiallyDownloadedBlock(CTxMemPool* poolIn) : pool(poolIn) {}
 
-    // extra_txn is a list of extra transactions to look at, in <witness hash, reference> form
+    // extra_txn is a list of extra transactions to look at, in <witness hash, reference> form,
+    // null entries are skipped
     ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn);
     bool IsTxAvailable(size_t index) const;
+    // Number of transactions InitData found in extra_txn
+    size_t ExtraTxnCount() const { return extra_count; }
     ReadStatus FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing);
 };
 
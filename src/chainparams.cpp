@@ -177,6 +177,10 @@ public:
             /* dTxRate  */ 0.03586100549040774
         };
 
+        m_assumeutxo_data = {
+            // Snapshots from rpc: dumptxoutset, none published yet
+        };
+
         /* disable fallback fee on mainnet */
         m_fallback_fee_enabled = false;
 
@@ -324,6 +328,10 @@ public:
             /* dTxRate  */ 0.03213750146763548
         };
 
+        m_assumeutxo_data = {
+            // Snapshots from rpc: dumptxoutset, none published yet
+        };
+
         /* enable fallback fee on testnet */
         m_fallback_fee_enabled = true;
 
@@ -426,6 +434,8 @@ public:
             0
         };
 
+        m_assumeutxo_data = {};
+
         base58Prefixes[PUBKEY_ADDRESS] = std::vector<unsigned char>(1,139);
         base58Prefixes[SCRIPT_ADDRESS] = std::vector<unsigned char>(1,19);
         base58Prefixes[SECRET_KEY] =     std::vector<unsigned char>(1,239);
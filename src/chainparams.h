@@ -25,6 +25,17 @@ struct CCheckpointData {
     MapCheckpoints mapCheckpoints;
 };
 
+/**
+ * UTXO set snapshot pinned for -loadutxosnapshot, as reported by the
+ * dumptxoutset rpc.
+ */
+struct AssumeutxoData {
+    uint256 blockhash;       //!< hash of the block the snapshot was taken at
+    uint256 hash_serialized; //!< content hash of the snapshot coins
+};
+
+typedef std::map<int, AssumeutxoData> MapAssumeutxo;
+
 /**
  * Holds various statistics on transactions within a chain. Used to estimate
  * verification progress during chain sync.
@@ -84,6 +95,8 @@ public:
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
     const ChainTxData& TxData() const { return chainTxData; }
+    /** UTXO set snapshots that may be loaded with -loadutxosnapshot, by height */
+    const MapAssumeutxo& Assumeutxo() const { return m_assumeutxo_data; }
 protected:
     CChainParams() {}
 
@@ -104,6 +117,7 @@ protected:
     bool fMineBlocksOnDemand;
     CCheckpointData checkpointData;
     ChainTxData chainTxData;
+    MapAssumeutxo m_assumeutxo_data;
     bool m_fallback_fee_enabled;
 };
 
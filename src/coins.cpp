@@ -208,6 +208,31 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+void CCoinsViewCache::MoveDirtyCoins(CCoinsMap &mapCoins, bool fErase) {
+    if (fErase) {
+        for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); ++it) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY)
+                mapCoins.emplace(it->first, std::move(it->second));
+        }
+        cacheCoins.clear();
+        cachedCoinsUsage = 0;
+        return;
+    }
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            ++it;
+        } else if (it->second.coin.IsSpent()) {
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            mapCoins.emplace(it->first, std::move(it->second));
+            it = cacheCoins.erase(it);
+        } else {
+            mapCoins.emplace(it->first, it->second);
+            it->second.flags = 0;
+            ++it;
+        }
+    }
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -6,10 +6,15 @@
 #ifndef BITCOIN_COINS_H
 #define BITCOIN_COINS_H
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <primitives/transaction.h>
 #include <compressor.h>
 #include <core_memusage.h>
 #include <crypto/siphash.h>
+#include <flatmap.h>
 #include <memusage.h>
 #include <serialize.h>
 #include <uint256.h>
@@ -119,7 +124,12 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
+#ifdef ENABLE_FLAT_COINS_MAP
+/** Open addressing map with entries stored inline, see flatmap.h (--enable-flat-coins-map) */
+typedef flatmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+#else
 typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+#endif
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -268,6 +278,15 @@ public:
      */
     bool Flush();
 
+    /**
+     * Move the modifications applied to this cache into mapCoins, to be written
+     * to the base by the caller (see CCoinsViewDB::BatchWriteAsync). Unspent
+     * coins stay cached as clean entries, unless fErase is set which empties the
+     * cache like Flush(). The base must answer lookups from mapCoins until they
+     * are written.
+     */
+    void MoveDirtyCoins(CCoinsMap &mapCoins, bool fErase);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
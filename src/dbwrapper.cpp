@@ -97,13 +97,39 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+const std::vector<DBProfile>& GetDBProfiles()
+{
+    static const std::vector<DBProfile> profiles{
+        {"default", "balanced settings for any disk", 0.5, 0.25, 4 << 10, 2 << 20, false, 10},
+        // Random reads are cheap, larger write buffers and table files mean
+        // fewer, larger compactions.
+        {"ssd", "larger write buffers and table files, fewer compactions", 0.25, 0.375, 4 << 10, 32 << 20, false, 10},
+        // Seeks are expensive, larger blocks and table files keep more data
+        // per seek and compressed blocks mean fewer bytes to read.
+        {"hdd", "larger compressed blocks and table files, fewer seeks", 0.5, 0.25, 32 << 10, 64 << 20, true, 10},
+        // Half of the cache size is left unused by the database.
+        {"lowmem", "smaller block cache and write buffers, compressed blocks", 0.25, 0.125, 4 << 10, 2 << 20, true, 10},
+    };
+    return profiles;
+}
+
+const DBProfile* FindDBProfile(const std::string& name)
+{
+    for (const DBProfile& profile : GetDBProfiles()) {
+        if (name == profile.name) return &profile;
+    }
+    return nullptr;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const DBProfile& profile)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    options.block_cache = leveldb::NewLRUCache(static_cast<size_t>(nCacheSize * profile.block_cache_share));
+    options.write_buffer_size = static_cast<size_t>(nCacheSize * profile.write_buffer_share); // up to two write buffers may be held in memory simultaneously
+    options.block_size = profile.block_size;
+    options.max_file_size = profile.max_file_size;
+    options.filter_policy = leveldb::NewBloomFilterPolicy(profile.bloom_bits);
+    options.compression = profile.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -117,12 +143,15 @@ static leveldb::Options GetOptions(size_t nCacheSize)
 CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
     : m_name(fs::basename(path))
 {
+    // Unknown profile names are rejected at startup
+    m_profile = FindDBProfile(gArgs.GetArg("-dbprofile", DEFAULT_DB_PROFILE));
+    if (!m_profile) m_profile = &GetDBProfiles().front();
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, *m_profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -134,7 +163,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
             dbwrapper_private::HandleError(result);
         }
         TryCreateDirectories(path);
-        LogPrintf("Opening LevelDB in %s\n", path.string());
+        LogPrintf("Opening LevelDB in %s with profile %s\n", path.string(), m_profile->name);
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
@@ -233,6 +262,96 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+//! One past the last key of the database, empty if it has no entries
+static std::string KeyLimit(leveldb::DB* pdb)
+{
+    std::unique_ptr<leveldb::Iterator> it(pdb->NewIterator(leveldb::ReadOptions()));
+    it->SeekToLast();
+    if (!it->Valid()) return std::string();
+    return it->key().ToString() + '\0';
+}
+
+size_t CDBWrapper::EstimateTotalSize() const
+{
+    const std::string limit = KeyLimit(pdb);
+    if (limit.empty()) return 0;
+    uint64_t size = 0;
+    leveldb::Range range(leveldb::Slice(), limit);
+    pdb->GetApproximateSizes(&range, 1, &size);
+    return size;
+}
+
+namespace {
+struct CompactionRange
+{
+    std::string start;
+    std::string limit;
+    uint64_t size;
+};
+} // namespace
+
+//! Split [start, limit) into ranges by the byte following prefix, where all
+//! keys in the range but start itself begin with prefix
+static std::vector<CompactionRange> SplitRange(leveldb::DB* pdb, const std::string& prefix, const std::string& start, const std::string& limit)
+{
+    std::vector<CompactionRange> ranges(256);
+    for (int i = 0; i < 256; ++i) {
+        ranges[i].start = i == 0 ? start : prefix + static_cast<char>(i);
+        ranges[i].limit = i == 255 ? limit : prefix + static_cast<char>(i + 1);
+    }
+    std::vector<leveldb::Range> db_ranges;
+    for (const CompactionRange& range : ranges) {
+        db_ranges.emplace_back(range.start, range.limit);
+    }
+    std::vector<uint64_t> sizes(ranges.size());
+    pdb->GetApproximateSizes(db_ranges.data(), db_ranges.size(), sizes.data());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        ranges[i].size = sizes[i];
+    }
+    return ranges;
+}
+
+bool CDBWrapper::Compact(const std::function<bool(double)>& progress)
+{
+    // Flush the memtable, so that all data is in the table files and counted
+    // by the size estimates. No table overlaps the empty key range.
+    const leveldb::Slice empty;
+    pdb->CompactRange(&empty, &empty);
+
+    const std::string limit = KeyLimit(pdb);
+    if (limit.empty()) return progress(1.0);
+
+    // Most databases keep their records under a few one byte key prefixes,
+    // the large ranges are split again by the second byte of the keys.
+    std::vector<CompactionRange> top = SplitRange(pdb, std::string(), std::string(), limit);
+    uint64_t total = 0;
+    for (const CompactionRange& range : top) {
+        total += range.size;
+    }
+    std::vector<CompactionRange> ranges;
+    for (size_t i = 0; i < top.size(); ++i) {
+        CompactionRange& range = top[i];
+        if (range.size > total / 16) {
+            for (CompactionRange& sub : SplitRange(pdb, std::string(1, static_cast<char>(i)), range.start, range.limit)) {
+                ranges.push_back(std::move(sub));
+            }
+        } else {
+            ranges.push_back(std::move(range));
+        }
+    }
+
+    LogPrint(BCLog::LEVELDB, "Compacting %s in %u ranges, %d MiB\n", m_name, ranges.size(), total >> 20);
+    uint64_t done = 0;
+    for (const CompactionRange& range : ranges) {
+        if (range.size == 0) continue;
+        const leveldb::Slice start(range.start), end(range.limit);
+        pdb->CompactRange(&start, &end);
+        done += range.size;
+        if (!progress(total > 0 ? std::min(1.0, static_cast<double>(done) / total) : 1.0)) return false;
+    }
+    return progress(1.0);
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() const { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
@@ -16,9 +16,43 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <functional>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+/** Default for -dbprofile */
+static const char* const DEFAULT_DB_PROFILE = "default";
+
+/**
+ * LevelDB tuning profile, selected with -dbprofile. The cache size passed to
+ * a CDBWrapper is split between the block cache and the write buffers, up to
+ * two of which may be held in memory at the same time.
+ */
+struct DBProfile
+{
+    const char* name;
+    const char* description;
+    //! Share of the cache size used by the block cache
+    double block_cache_share;
+    //! Share of the cache size used by each write buffer
+    double write_buffer_share;
+    //! Approximate size of the user data packed per block
+    size_t block_size;
+    //! Size of the table files written by compactions
+    size_t max_file_size;
+    //! Compress blocks with snappy, if LevelDB was built with it
+    bool compression;
+    //! Bits per key of the bloom filter
+    int bloom_bits;
+};
+
+/** The known profiles, the first one is the default. */
+const std::vector<DBProfile>& GetDBProfiles();
+
+/** Look up a profile by name, returns null if it is unknown. */
+const DBProfile* FindDBProfile(const std::string& name);
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -201,6 +235,9 @@ private:
     //! the name of this database
     std::string m_name;
 
+    //! the tuning profile the database was opened with
+    const DBProfile* m_profile;
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -315,6 +352,23 @@ public:
      */
     bool IsEmpty();
 
+    const std::string& GetName() const { return m_name; }
+    const DBProfile& GetProfile() const { return *m_profile; }
+
+    /**
+     * Get an estimate of the size of the table files of the whole database.
+     */
+    size_t EstimateTotalSize() const;
+
+    /**
+     * Compact the whole database one key range at a time. The ranges are split
+     * by the first bytes of the keys and sized from the table files, so that a
+     * large database is not locked in a single CompactRange call. The progress
+     * callback is invoked with the compacted fraction of the data after each
+     * range; the compaction stops early and returns false if it returns false.
+     */
+    bool Compact(const std::function<bool(double)>& progress);
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
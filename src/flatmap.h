@@ -0,0 +1,347 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FLATMAP_H
+#define BITCOIN_FLATMAP_H
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Open addressing hash map implementing the part of the std::unordered_map
+ * interface used by the coins cache.
+ *
+ * The table is a flat array of 8 byte slots, each holding a fragment of the
+ * hash of a key and the index of its entry, and is probed linearly. A lookup
+ * reads a run of adjacent slots and only touches the entry whose hash
+ * fragment matches. Entries are stored inline in fixed size chunks that are
+ * never moved, so references to elements stay valid until the element is
+ * erased, like with std::unordered_map. The entries of erased elements are
+ * reused by later inserts.
+ *
+ * Erasing an element leaves a tombstone slot and does not invalidate other
+ * iterators. Inserting may rehash the table, which invalidates iterators, and
+ * shrinks it once erases left it mostly empty. The pool chunks are only
+ * released by clear(), which is how the coins cache returns its memory.
+ */
+template <typename K, typename T, typename Hash>
+class flatmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    struct Slot {
+        uint32_t tag;
+        uint32_t index;
+    };
+
+    static const uint32_t SLOT_EMPTY = 0xffffffff;
+    static const uint32_t SLOT_DELETED = 0xfffffffe;
+    //! Entries per pool chunk
+    static const size_t CHUNK_SIZE = 256;
+    static const size_t MIN_SLOTS = 16;
+
+    typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type Storage;
+    struct Chunk {
+        Storage entries[CHUNK_SIZE];
+    };
+
+    Hash m_hash;
+    //! The number of slots is zero or a power of two
+    std::vector<Slot> m_slots;
+    size_t m_size{0};
+    size_t m_deleted{0};
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    //! Number of entries handed out from the chunks
+    uint32_t m_used{0};
+    //! Entries of erased elements
+    std::vector<uint32_t> m_free;
+
+    value_type* entry(uint32_t index) const
+    {
+        return reinterpret_cast<value_type*>(&m_chunks[index / CHUNK_SIZE]->entries[index % CHUNK_SIZE]);
+    }
+
+    static uint32_t tag(size_t hash)
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(hash) >> 32) ^ static_cast<uint32_t>(hash);
+    }
+
+    size_t next_used(size_t pos) const
+    {
+        while (pos < m_slots.size() && m_slots[pos].index >= SLOT_DELETED) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    size_t find_slot(const K& key) const
+    {
+        if (m_size == 0) return m_slots.size();
+        const size_t hash = m_hash(key);
+        const uint32_t key_tag = tag(hash);
+        const size_t mask = m_slots.size() - 1;
+        for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+            const Slot& slot = m_slots[pos];
+            if (slot.index == SLOT_EMPTY) return m_slots.size();
+            if (slot.index != SLOT_DELETED && slot.tag == key_tag && entry(slot.index)->first == key) return pos;
+        }
+    }
+
+    uint32_t allocate()
+    {
+        if (!m_free.empty()) {
+            const uint32_t index = m_free.back();
+            m_free.pop_back();
+            return index;
+        }
+        assert(m_used < SLOT_DELETED);
+        if (m_used == m_chunks.size() * CHUNK_SIZE) {
+            m_chunks.emplace_back(new Chunk);
+        }
+        return m_used++;
+    }
+
+    void destroy(uint32_t index)
+    {
+        entry(index)->~value_type();
+        m_free.push_back(index);
+    }
+
+    void rehash(size_t n_slots)
+    {
+        std::vector<Slot> slots(n_slots, Slot{0, SLOT_EMPTY});
+        const size_t mask = n_slots - 1;
+        for (const Slot& slot : m_slots) {
+            if (slot.index >= SLOT_DELETED) continue;
+            size_t pos = m_hash(entry(slot.index)->first) & mask;
+            while (slots[pos].index != SLOT_EMPTY) {
+                pos = (pos + 1) & mask;
+            }
+            slots[pos] = slot;
+        }
+        m_slots.swap(slots);
+        m_deleted = 0;
+    }
+
+    //! Make room for one more element, keeping the table at most 7/8 full
+    //! including tombstones. A table that erases left at most 1/8 full is
+    //! shrunk back to between 1/4 and 1/2 full.
+    void reserve_one()
+    {
+        const bool full = (m_size + m_deleted + 1) * 8 > m_slots.size() * 7;
+        const bool sparse = m_slots.size() > MIN_SLOTS && (m_size + 1) * 8 <= m_slots.size();
+        if (!full && !sparse) return;
+        size_t n_slots = MIN_SLOTS;
+        while ((m_size + 1) * 2 > n_slots) {
+            n_slots *= 2;
+        }
+        rehash(n_slots);
+    }
+
+    //! Insert the constructed entry at index unless its key is present.
+    std::pair<size_t, bool> insert_entry(uint32_t index)
+    {
+        reserve_one();
+        const K& key = entry(index)->first;
+        const size_t hash = m_hash(key);
+        const uint32_t key_tag = tag(hash);
+        const size_t mask = m_slots.size() - 1;
+        size_t pos = hash & mask;
+        size_t pos_deleted = m_slots.size();
+        for (;; pos = (pos + 1) & mask) {
+            const Slot& slot = m_slots[pos];
+            if (slot.index == SLOT_EMPTY) break;
+            if (slot.index == SLOT_DELETED) {
+                if (pos_deleted == m_slots.size()) pos_deleted = pos;
+                continue;
+            }
+            if (slot.tag == key_tag && entry(slot.index)->first == key) {
+                destroy(index);
+                return std::make_pair(pos, false);
+            }
+        }
+        if (pos_deleted != m_slots.size()) {
+            pos = pos_deleted;
+            --m_deleted;
+        }
+        m_slots[pos] = Slot{key_tag, index};
+        ++m_size;
+        return std::make_pair(pos, true);
+    }
+
+    template <bool Const>
+    class iter_base
+    {
+        typedef typename std::conditional<Const, const flatmap, flatmap>::type map_type;
+
+        map_type* m_map{nullptr};
+        size_t m_pos{0};
+
+        template <bool> friend class iter_base;
+        friend class flatmap;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename flatmap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<Const, const value_type*, value_type*>::type pointer;
+        typedef typename std::conditional<Const, const value_type&, value_type&>::type reference;
+
+        iter_base() {}
+        iter_base(map_type* map, size_t pos) : m_map(map), m_pos(pos) {}
+        template <bool C = Const, typename = typename std::enable_if<C>::type>
+        iter_base(const iter_base<false>& other) : m_map(other.m_map), m_pos(other.m_pos) {}
+
+        reference operator*() const { return *m_map->entry(m_map->m_slots[m_pos].index); }
+        pointer operator->() const { return m_map->entry(m_map->m_slots[m_pos].index); }
+
+        iter_base& operator++()
+        {
+            m_pos = m_map->next_used(m_pos + 1);
+            return *this;
+        }
+        iter_base operator++(int)
+        {
+            iter_base copy(*this);
+            ++*this;
+            return copy;
+        }
+
+        template <bool C>
+        bool operator==(const iter_base<C>& other) const { return m_pos == other.m_pos; }
+        template <bool C>
+        bool operator!=(const iter_base<C>& other) const { return m_pos != other.m_pos; }
+    };
+
+public:
+    typedef iter_base<false> iterator;
+    typedef iter_base<true> const_iterator;
+
+    explicit flatmap(const Hash& hash = Hash()) : m_hash(hash) {}
+
+    flatmap(const flatmap& other) : m_hash(other.m_hash)
+    {
+        for (const value_type& value : other) {
+            emplace(value);
+        }
+    }
+
+    flatmap(flatmap&& other) : m_hash(other.m_hash)
+    {
+        m_slots.swap(other.m_slots);
+        m_chunks.swap(other.m_chunks);
+        m_free.swap(other.m_free);
+        std::swap(m_size, other.m_size);
+        std::swap(m_deleted, other.m_deleted);
+        std::swap(m_used, other.m_used);
+    }
+
+    // The hasher may not be assignable (e.g. salted hashers)
+    flatmap& operator=(const flatmap&) = delete;
+    flatmap& operator=(flatmap&&) = delete;
+
+    ~flatmap() { clear(); }
+
+    iterator begin() { return iterator(this, next_used(0)); }
+    const_iterator begin() const { return const_iterator(this, next_used(0)); }
+    iterator end() { return iterator(this, m_slots.size()); }
+    const_iterator end() const { return const_iterator(this, m_slots.size()); }
+
+    size_type size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    iterator find(const K& key) { return iterator(this, find_slot(key)); }
+    const_iterator find(const K& key) const { return const_iterator(this, find_slot(key)); }
+    size_type count(const K& key) const { return find_slot(key) != m_slots.size() ? 1 : 0; }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        const uint32_t index = allocate();
+        try {
+            new (entry(index)) value_type(std::forward<Args>(args)...);
+        } catch (...) {
+            m_free.push_back(index);
+            throw;
+        }
+        const std::pair<size_t, bool> result = insert_entry(index);
+        return std::make_pair(iterator(this, result.first), result.second);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) { return emplace(value); }
+
+    T& operator[](const K& key)
+    {
+        const size_t pos = find_slot(key);
+        if (pos != m_slots.size()) {
+            return entry(m_slots[pos].index)->second;
+        }
+        return emplace(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>()).first->second;
+    }
+
+    iterator erase(const_iterator it)
+    {
+        const size_t pos = it.m_pos;
+        destroy(m_slots[pos].index);
+        m_slots[pos].index = SLOT_DELETED;
+        --m_size;
+        ++m_deleted;
+
+        // Tombstones followed by an empty slot end no probe sequence
+        const size_t mask = m_slots.size() - 1;
+        if (m_slots[(pos + 1) & mask].index == SLOT_EMPTY) {
+            for (size_t p = pos; m_slots[p].index == SLOT_DELETED; p = (p - 1) & mask) {
+                m_slots[p].index = SLOT_EMPTY;
+                --m_deleted;
+            }
+        }
+        return iterator(this, next_used(pos + 1));
+    }
+
+    size_type erase(const K& key)
+    {
+        const size_t pos = find_slot(key);
+        if (pos == m_slots.size()) return 0;
+        erase(const_iterator(this, pos));
+        return 1;
+    }
+
+    //! Remove all elements and release the memory of the table and the pool.
+    void clear()
+    {
+        for (const Slot& slot : m_slots) {
+            if (slot.index < SLOT_DELETED) {
+                entry(slot.index)->~value_type();
+            }
+        }
+        std::vector<Slot>().swap(m_slots);
+        std::vector<std::unique_ptr<Chunk>>().swap(m_chunks);
+        std::vector<uint32_t>().swap(m_free);
+        m_size = 0;
+        m_deleted = 0;
+        m_used = 0;
+    }
+
+    //! Sizes of the allocations of the table, the pool chunks and the pool bookkeeping.
+    size_t slot_bytes() const { return m_slots.capacity() * sizeof(Slot); }
+    size_t chunk_count() const { return m_chunks.size(); }
+    static constexpr size_t chunk_bytes() { return sizeof(Chunk); }
+    size_t chunk_list_bytes() const { return m_chunks.capacity() * sizeof(std::unique_ptr<Chunk>); }
+    size_t free_list_bytes() const { return m_free.capacity() * sizeof(uint32_t); }
+};
+
+#endif // BITCOIN_FLATMAP_H
@@ -9,6 +9,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <hash.h>
+#include <index/spentindex.h>
 #include <key_io.h>
 #include <net.h>
 #include <policy/policy.h>
@@ -790,6 +791,14 @@ public:
         const auto cores = GetNumCores();
         std::map<COutPoint, std::pair<uint256, int>> spentPrevouts; // pair<txhash, blockheight>
         Mutex mut; // manage access to shared data
+        // Vote spends are looked up in the spent index if it has indexed
+        // every block being loaded, otherwise all block inputs are collected
+        // in memory. An index that is still catching up reports itself synced.
+        bool useSpentIndex{false};
+        if (g_spentindex) {
+            const IndexSummary summary = g_spentindex->GetSummary();
+            useSpentIndex = summary.synced && summary.best_block_height >= blockHeight;
+        }
 
         const int totalBlocks = blockHeight - consensus.governanceBlock;
         int slice = totalBlocks / cores;
@@ -798,7 +807,7 @@ public:
             const int start = consensus.governanceBlock + k*slice;
             const int end = k == cores-1 ? blockHeight+1 // check bounds, +1 due to "<" logic below, ensure inclusion of last block
                                          : start+slice;
-            tg.create_thread([start,end,&spentPrevouts,&failed,&failReasonRet,&chain,&chainMutex,&mut,this] {
+            tg.create_thread([start,end,useSpentIndex,&spentPrevouts,&failed,&failReasonRet,&chain,&chainMutex,&mut,this] {
                 RenameThread("blocknet-governance");
                 for (int blockNumber = start; blockNumber < end; ++blockNumber) {
                     if (ShutdownRequested()) { // don't hold up shutdown requests
@@ -826,10 +835,12 @@ public:
                         return;
                     }
                     // Store all vins in order to use as a lookup for spent votes
-                    for (const auto & tx : block.vtx) {
+                    if (!useSpentIndex) {
                         LOCK(mut);
-                        for (const auto & vin : tx->vin)
-                            spentPrevouts[vin.prevout] = {tx->GetHash(), blockIndex->nHeight};
+                        for (const auto & tx : block.vtx) {
+                            for (const auto & vin : tx->vin)
+                                spentPrevouts[vin.prevout] = {tx->GetHash(), blockIndex->nHeight};
+                        }
                     }
                     // Process block
                     processBlock(&block, blockIndex, Params().GetConsensus(), false);
@@ -861,7 +872,7 @@ public:
             const int end = k == cores-1 ? static_cast<int>(tmpvotes.size())
                                          : start+slice;
             try {
-                tg.create_thread([start,end,&tmpvotes,&spentPrevouts,&failed,&mut,this] {
+                tg.create_thread([start,end,useSpentIndex,&tmpvotes,&spentPrevouts,&failed,&mut,this] {
                     RenameThread("blocknet-governance");
                     for (int i = start; i < end; ++i) {
                         if (ShutdownRequested()) { // don't hold up shutdown requests
@@ -877,7 +888,11 @@ public:
                         if (hasProposal(vote.getProposal(), vote.getBlockNumber())) {
                             // Mark vote as spent if its utxo is spent before or on the
                             // associated proposal's superblock.
-                            {
+                            if (useSpentIndex) {
+                                SpentIndexValue spent;
+                                if (g_spentindex->FindSpend(vote.getUtxo(), spent) && spent.height <= getProposal(vote.getProposal()).getSuperblock())
+                                    vote.spend(spent.height, spent.txid);
+                            } else {
                                 LOCK(mut);
                                 if (spentPrevouts.count(vote.getUtxo()) && spentPrevouts[vote.getUtxo()].second <= getProposal(vote.getProposal()).getSuperblock())
                                     vote.spend(spentPrevouts[vote.getUtxo()].second, spentPrevouts[vote.getUtxo()].first);
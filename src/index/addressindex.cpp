@@ -0,0 +1,264 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <crypto/sha256.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+constexpr char DB_ADDRESS_HISTORY = 'h';
+constexpr char DB_ADDRESS_UNSPENT = 'u';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+namespace {
+
+/** History keys sort by script, then height (big endian), then position. */
+struct DBHistoryKey
+{
+    AddressHistoryKey key;
+
+    DBHistoryKey() = default;
+    explicit DBHistoryKey(const AddressHistoryKey& key) : key(key) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_HISTORY);
+        s << key.script_hash;
+        ser_writedata32be(s, key.height);
+        s << key.txid;
+        ser_writedata32be(s, key.index);
+        ser_writedata8(s, key.spending);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_ADDRESS_HISTORY) {
+            throw std::ios_base::failure("Invalid format for address history key");
+        }
+        s >> key.script_hash;
+        key.height = ser_readdata32be(s);
+        s >> key.txid;
+        key.index = ser_readdata32be(s);
+        key.spending = ser_readdata8(s) != 0;
+    }
+};
+
+struct DBUnspentKey
+{
+    uint256 script_hash;
+    COutPoint outpoint;
+
+    DBUnspentKey() = default;
+    DBUnspentKey(const uint256& script_hash, const COutPoint& outpoint)
+        : script_hash(script_hash), outpoint(outpoint) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_UNSPENT);
+        s << script_hash << outpoint.hash;
+        ser_writedata32be(s, outpoint.n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_ADDRESS_UNSPENT) {
+            throw std::ios_base::failure("Invalid format for address unspent key");
+        }
+        s >> script_hash >> outpoint.hash;
+        outpoint.n = ser_readdata32be(s);
+    }
+};
+
+struct DBUnspentValue
+{
+    CAmount amount{0};
+    int height{0};
+
+    DBUnspentValue() = default;
+    DBUnspentValue(CAmount amount, int height) : amount(amount), height(height) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(amount);
+        READWRITE(VARINT(height, VarIntMode::NONNEGATIVE_SIGNED));
+    }
+};
+
+} // namespace
+
+/**
+ * Access to the address index database (indexes/addressindex/)
+ *
+ * History entries: ('h', script hash, height, txid, index, spending) -> amount
+ * Unspent entries: ('u', script hash, txid, vout) -> (amount, height)
+ */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+uint256 AddressIndex::GetScriptHash(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+/** Outputs that can never be spent are not indexed (e.g. the empty coinstake marker). */
+static bool IsIndexed(const CTxOut& out)
+{
+    return !out.scriptPubKey.empty() && !out.scriptPubKey.IsUnspendable();
+}
+
+static bool ReadUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& block_undo)
+{
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return error("%s: Failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: Undo data of block %s does not match the block", __func__, pindex->GetBlockHash().ToString());
+    }
+    return true;
+}
+
+bool AddressIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) const
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo block_undo;
+    if (!ReadUndo(block, pindex, block_undo)) {
+        return false;
+    }
+
+    // Entries are applied in order, outputs created and spent in the same
+    // block end up in the history but not in the unspent set.
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+
+        if (i > 0) {
+            const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); ++j) {
+                const CTxOut& prev = tx_undo.vprevout[j].out;
+                if (!IsIndexed(prev)) continue;
+                const uint256 script_hash = GetScriptHash(prev.scriptPubKey);
+                batch.Write(DBHistoryKey({script_hash, pindex->nHeight, txid, static_cast<uint32_t>(j), true}), -prev.nValue);
+                batch.Erase(DBUnspentKey(script_hash, tx.vin[j].prevout));
+            }
+        }
+
+        for (size_t k = 0; k < tx.vout.size(); ++k) {
+            const CTxOut& out = tx.vout[k];
+            if (!IsIndexed(out)) continue;
+            const uint256 script_hash = GetScriptHash(out.scriptPubKey);
+            batch.Write(DBHistoryKey({script_hash, pindex->nHeight, txid, static_cast<uint32_t>(k), false}), out.nValue);
+            batch.Write(DBUnspentKey(script_hash, COutPoint(txid, k)), DBUnspentValue(out.nValue, pindex->nHeight));
+        }
+    }
+    return true;
+}
+
+bool AddressIndex::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo block_undo;
+    if (!ReadUndo(block, pindex, block_undo)) {
+        return false;
+    }
+
+    // Undo WriteBlock in reverse order
+    CDBBatch batch(*m_db);
+    for (size_t i = block.vtx.size(); i-- > 0;) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+
+        for (size_t k = tx.vout.size(); k-- > 0;) {
+            const CTxOut& out = tx.vout[k];
+            if (!IsIndexed(out)) continue;
+            const uint256 script_hash = GetScriptHash(out.scriptPubKey);
+            batch.Erase(DBUnspentKey(script_hash, COutPoint(txid, k)));
+            batch.Erase(DBHistoryKey({script_hash, pindex->nHeight, txid, static_cast<uint32_t>(k), false}));
+        }
+
+        if (i > 0) {
+            const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+            for (size_t j = tx.vin.size(); j-- > 0;) {
+                const Coin& prev = tx_undo.vprevout[j];
+                if (!IsIndexed(prev.out)) continue;
+                const uint256 script_hash = GetScriptHash(prev.out.scriptPubKey);
+                batch.Write(DBUnspentKey(script_hash, tx.vin[j].prevout), DBUnspentValue(prev.out.nValue, prev.nHeight));
+                batch.Erase(DBHistoryKey({script_hash, pindex->nHeight, txid, static_cast<uint32_t>(j), true}));
+            }
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::FindHistory(const uint256& script_hash, int start_height, int end_height,
+                               std::vector<AddressHistoryEntry>& entries) const
+{
+    std::unique_ptr<CDBIterator> it(m_db->NewIterator());
+    it->Seek(DBHistoryKey({script_hash, start_height, uint256(), 0, false}));
+
+    DBHistoryKey db_key;
+    for (; it->Valid(); it->Next()) {
+        if (!it->GetKey(db_key) || db_key.key.script_hash != script_hash || db_key.key.height > end_height) {
+            break;
+        }
+        AddressHistoryEntry entry;
+        entry.key = db_key.key;
+        if (!it->GetValue(entry.amount)) {
+            return error("%s: Failed to read address history entry", __func__);
+        }
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool AddressIndex::FindUnspent(const uint256& script_hash, std::vector<AddressUnspentEntry>& entries) const
+{
+    std::unique_ptr<CDBIterator> it(m_db->NewIterator());
+    it->Seek(DBUnspentKey(script_hash, COutPoint(uint256(), 0)));
+
+    DBUnspentKey db_key;
+    for (; it->Valid(); it->Next()) {
+        if (!it->GetKey(db_key) || db_key.script_hash != script_hash) {
+            break;
+        }
+        DBUnspentValue value;
+        if (!it->GetValue(value)) {
+            return error("%s: Failed to read address unspent entry", __func__);
+        }
+        AddressUnspentEntry entry;
+        entry.outpoint = db_key.outpoint;
+        entry.amount = value.amount;
+        entry.height = value.height;
+        entries.push_back(entry);
+    }
+    return true;
+}
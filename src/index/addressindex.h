@@ -0,0 +1,91 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <amount.h>
+#include <index/base.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <vector>
+
+static const bool DEFAULT_ADDRESSINDEX = false;
+
+/** Location of a received output or a spending input in the address history. */
+struct AddressHistoryKey
+{
+    uint256 script_hash;
+    int height{0};
+    uint256 txid;
+    uint32_t index{0}; //!< output index if received, input index if spent
+    bool spending{false};
+
+    AddressHistoryKey() = default;
+    AddressHistoryKey(const uint256& script_hash, int height, const uint256& txid, uint32_t index, bool spending)
+        : script_hash(script_hash), height(height), txid(txid), index(index), spending(spending) {}
+};
+
+struct AddressHistoryEntry
+{
+    AddressHistoryKey key;
+    CAmount amount{0}; //!< negative for spent outputs
+};
+
+/** Unspent output paying to an indexed script. */
+struct AddressUnspentEntry
+{
+    COutPoint outpoint;
+    CAmount amount{0};
+    int height{0};
+};
+
+/**
+ * AddressIndex looks up the transaction history and the unspent outputs of a
+ * script. Entries are keyed by the SHA256 of the scriptPubKey (the electrum
+ * "scripthash") and ordered by height, so a lookup is a single LevelDB range
+ * scan. Spent outputs are resolved from the block undo data, disconnected
+ * blocks are reverted so that the index follows reorgs.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool PrepareBlock(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) const override;
+
+    bool DisconnectBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Key of the script in the index.
+    static uint256 GetScriptHash(const CScript& script);
+
+    /// History of the script between start_height and end_height (inclusive), oldest first.
+    bool FindHistory(const uint256& script_hash, int start_height, int end_height,
+                     std::vector<AddressHistoryEntry>& entries) const;
+
+    /// Unspent outputs of the script.
+    bool FindUnspent(const uint256& script_hash, std::vector<AddressUnspentEntry>& entries) const;
+};
+
+/// The global address index. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
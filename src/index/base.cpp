@@ -7,10 +7,128 @@
 #include <tinyformat.h>
 #include <util/system.h>
 
+#include <condition_variable>
+#include <deque>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 10; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
+constexpr size_t SYNC_BLOCKS_PER_THREAD = 16; // blocks read ahead per worker
+
+namespace {
+
+/** Block prepared by the sync workers, committed by the sync thread. */
+struct SyncBlock
+{
+    const CBlockIndex* pindex;
+    CBlock block;
+    std::unique_ptr<CDBBatch> batch;
+    bool done{false};
+    bool ok{false};
+
+    explicit SyncBlock(const CBlockIndex* pindex) : pindex(pindex) {}
+};
+
+/**
+ * Pool of threads that read and prepare blocks for the sync thread. Blocks
+ * are picked up in the order they are pushed, the sync thread waits on each
+ * block in turn so that results are committed in chain order while the
+ * workers keep reading ahead.
+ */
+class SyncPipeline
+{
+public:
+    using Job = std::function<bool(SyncBlock&)>;
+
+    SyncPipeline(const char* name, int n_threads, Job job) : m_job(std::move(job))
+    {
+        for (int i = 0; i < n_threads; ++i) {
+            m_threads.emplace_back(&TraceThread<std::function<void()>>, name,
+                                   std::bind(&SyncPipeline::ThreadWorker, this));
+        }
+    }
+
+    ~SyncPipeline()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+            m_pending.clear();
+        }
+        m_cv_work.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    /// Queue a block to be prepared by the next idle worker.
+    std::shared_ptr<SyncBlock> Push(const CBlockIndex* pindex)
+    {
+        auto item = std::make_shared<SyncBlock>(pindex);
+        {
+            LOCK(m_mutex);
+            m_pending.push_back(item);
+        }
+        m_cv_work.notify_one();
+        return item;
+    }
+
+    /// Wait until a queued block is prepared.
+    void Wait(const SyncBlock& item)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv_done.wait(lock, [&item] { return item.done; });
+    }
+
+private:
+    void ThreadWorker()
+    {
+        while (true) {
+            std::shared_ptr<SyncBlock> item;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv_work.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+                if (m_stop) return;
+                item = std::move(m_pending.front());
+                m_pending.pop_front();
+            }
+
+            bool ok = false;
+            try {
+                ok = m_job(*item);
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+            }
+
+            {
+                LOCK(m_mutex);
+                item->ok = ok;
+                item->done = true;
+            }
+            m_cv_done.notify_all();
+        }
+    }
+
+    Mutex m_mutex;
+    std::condition_variable m_cv_work;
+    std::condition_variable m_cv_done;
+    std::deque<std::shared_ptr<SyncBlock>> m_pending GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+    const Job m_job;
+};
+
+int GetSyncThreads()
+{
+    int n_threads = gArgs.GetArg("-indexsyncthreads", DEFAULT_INDEX_SYNC_THREADS);
+    if (n_threads <= 0) {
+        n_threads = GetNumCores();
+    }
+    return std::max(1, std::min(n_threads, MAX_INDEX_SYNC_THREADS));
+}
+
+} // namespace
 
 BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
     CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate)
@@ -25,9 +143,9 @@ bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
     return success;
 }
 
-bool BaseIndex::DB::WriteBestBlock(const CBlockLocator& locator)
+void BaseIndex::DB::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator)
 {
-    return Write(DB_BEST_BLOCK, locator);
+    batch.Write(DB_BEST_BLOCK, locator);
 }
 
 BaseIndex::~BaseIndex()
@@ -75,30 +193,80 @@ void BaseIndex::ThreadSync()
     if (!m_synced) {
         auto& consensus_params = Params().GetConsensus();
 
+        const int n_threads = GetSyncThreads();
+        m_sync_threads = n_threads;
+        m_sync_blocks = 0;
+        m_sync_start_time = GetTimeMicros();
+        m_sync_end_time = 0;
+        LogPrintf("Syncing %s with %d thread%s\n", GetName(), n_threads, n_threads > 1 ? "s" : "");
+
+        SyncPipeline pipeline("idxsync", n_threads, [this, &consensus_params](SyncBlock& item) {
+            if (!ReadBlockFromDisk(item.block, item.pindex, consensus_params)) {
+                return error("%s: Failed to read block %s from disk",
+                             __func__, item.pindex->GetBlockHash().ToString());
+            }
+            item.batch = MakeUnique<CDBBatch>(GetDB());
+            return PrepareBlock(item.block, item.pindex, *item.batch);
+        });
+        const size_t max_queued = n_threads * SYNC_BLOCKS_PER_THREAD;
+        std::deque<std::shared_ptr<SyncBlock>> queue;
+        const CBlockIndex* pindex_queued = pindex;
+
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
+        int last_progress = -1;
+        int tip_height = 0;
         while (true) {
-            if (m_interrupt) {
+            if (m_interrupt || ShutdownRequested()) {
                 WriteBestBlock(pindex);
+                m_sync_end_time = GetTimeMicros();
                 return;
             }
 
             {
                 LOCK(cs_main);
-                const CBlockIndex* pindex_next = NextSyncBlock(pindex);
-                if (!pindex_next) {
+                // Keep the workers busy with the blocks following the last
+                // queued one. Queueing pauses when the chain switched to
+                // another branch, which is rewound once the queue drained.
+                while (queue.size() < max_queued) {
+                    const CBlockIndex* pindex_next = NextSyncBlock(pindex_queued);
+                    if (!pindex_next || (!queue.empty() && pindex_next->pprev != pindex_queued)) {
+                        break;
+                    }
+                    queue.push_back(pipeline.Push(pindex_next));
+                    pindex_queued = pindex_next;
+                }
+                if (queue.empty()) {
                     WriteBestBlock(pindex);
                     m_best_block_index = pindex;
                     m_synced = true;
                     break;
                 }
-                pindex = pindex_next;
+                tip_height = chainActive.Height();
+            }
+
+            const std::shared_ptr<SyncBlock> item = std::move(queue.front());
+            queue.pop_front();
+            pipeline.Wait(*item);
+            if (!item->ok) {
+                FatalError("%s: Failed to prepare block %s for index %s",
+                           __func__, item->pindex->GetBlockHash().ToString(), GetName());
+                return;
+            }
+
+            // The best block is on a stale branch, revert it down to the fork point.
+            if (pindex && item->pindex->pprev != pindex && !Rewind(pindex, item->pindex->pprev)) {
+                FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                           __func__, GetName());
+                return;
             }
+            pindex = item->pindex;
 
             int64_t current_time = GetTime();
             if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
-                LogPrintf("Syncing %s with block chain from height %d\n",
-                          GetName(), pindex->nHeight);
+                const double elapsed = (GetTimeMicros() - m_sync_start_time) / 1000000.0;
+                LogPrintf("Syncing %s with block chain from height %d (%.1f blocks/s)\n",
+                          GetName(), pindex->nHeight, elapsed > 0 ? m_sync_blocks / elapsed : 0.0);
                 last_log_time = current_time;
             }
 
@@ -107,18 +275,25 @@ void BaseIndex::ThreadSync()
                 last_locator_write_time = current_time;
             }
 
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk",
+            if (item->batch->SizeEstimate() > 0 && !GetDB().WriteBatch(*item->batch)) {
+                FatalError("%s: Failed to write block %s to index database",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             }
-            if (!WriteBlock(block, pindex)) {
+            if (!WriteBlock(item->block, pindex)) {
                 FatalError("%s: Failed to write block %s to index database",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             }
+            ++m_sync_blocks;
+
+            const int progress = tip_height > 0 ? static_cast<int>(pindex->nHeight * 100LL / tip_height) : 100;
+            if (progress != last_progress) {
+                SyncProgress(progress);
+                last_progress = progress;
+            }
         }
+        m_sync_end_time = GetTimeMicros();
     }
 
     if (pindex) {
@@ -128,15 +303,61 @@ void BaseIndex::ThreadSync()
     }
 }
 
+bool BaseIndex::IndexBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(GetDB());
+    if (!PrepareBlock(block, pindex, batch)) {
+        return false;
+    }
+    if (batch.SizeEstimate() > 0 && !GetDB().WriteBatch(batch)) {
+        return false;
+    }
+    return WriteBlock(block, pindex);
+}
+
 bool BaseIndex::WriteBestBlock(const CBlockIndex* block_index)
 {
-    LOCK(cs_main);
-    if (!GetDB().WriteBestBlock(chainActive.GetLocator(block_index))) {
+    CBlockLocator locator;
+    {
+        LOCK(cs_main);
+        locator = chainActive.GetLocator(block_index);
+    }
+    return Commit(locator);
+}
+
+bool BaseIndex::Commit(const CBlockLocator& locator)
+{
+    CDBBatch batch(GetDB());
+    if (!CommitInternal(batch)) {
+        return error("%s: Failed to commit latest %s state", __func__, GetName());
+    }
+    GetDB().WriteBestBlock(batch, locator);
+    if (!GetDB().WriteBatch(batch)) {
         return error("%s: Failed to write locator to disk", __func__);
     }
     return true;
 }
 
+bool BaseIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    const auto& consensus_params = Params().GetConsensus();
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        if (!DisconnectBlock(block, pindex)) {
+            return error("%s: Failed to disconnect block %s from index",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        m_best_block_index = pindex->pprev;
+    }
+    return WriteBestBlock(new_tip);
+}
+
 void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
                                const std::vector<CTransactionRef>& txn_conflicted)
 {
@@ -166,7 +387,7 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
         }
     }
 
-    if (WriteBlock(*block, pindex)) {
+    if (IndexBlock(*block, pindex)) {
         m_best_block_index = pindex;
     } else {
         FatalError("%s: Failed to write block %s to index",
@@ -175,6 +396,35 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
     }
 }
 
+void BaseIndex::BlockDisconnected(const std::shared_ptr<const CBlock>& block)
+{
+    if (!m_synced) {
+        return;
+    }
+
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = LookupBlockIndex(block->GetHash());
+    }
+
+    // Blocks are disconnected from the tip, anything else was never indexed
+    // (e.g. notifications queued before the sync thread caught up).
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    if (!pindex || pindex != best_block_index) {
+        LogPrintf("%s: WARNING: Disconnected block %s is not the best block of %s; not updating index\n",
+                  __func__, block->GetHash().ToString(), GetName());
+        return;
+    }
+
+    if (DisconnectBlock(*block, pindex)) {
+        m_best_block_index = pindex->pprev;
+    } else {
+        FatalError("%s: Failed to disconnect block %s from index",
+                   __func__, pindex->GetBlockHash().ToString());
+    }
+}
+
 void BaseIndex::ChainStateFlushed(const CBlockLocator& locator)
 {
     if (!m_synced) {
@@ -208,9 +458,7 @@ void BaseIndex::ChainStateFlushed(const CBlockLocator& locator)
         return;
     }
 
-    if (!GetDB().WriteBestBlock(locator)) {
-        error("%s: Failed to write locator to disk", __func__);
-    }
+    Commit(locator);
 }
 
 bool BaseIndex::BlockUntilSyncedToCurrentChain()
@@ -245,6 +493,7 @@ void BaseIndex::Start()
 {
     // Need to register this ValidationInterface before running Init(), so that
     // callbacks are not missed if Init sets m_synced to true.
+    RegisterValidationInterface(this);
     if (!Init()) {
         FatalError("%s: %s failed to initialize", __func__, GetName());
         return;
@@ -256,7 +505,27 @@ void BaseIndex::Start()
 
 void BaseIndex::Stop()
 {
+    UnregisterValidationInterface(this);
+
     if (m_thread_sync.joinable()) {
         m_thread_sync.join();
     }
 }
+
+IndexSummary BaseIndex::GetSummary() const
+{
+    IndexSummary summary;
+    summary.name = GetName();
+    summary.synced = m_synced;
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    summary.best_block_height = best_block_index ? best_block_index->nHeight : -1;
+    summary.sync_threads = m_sync_threads;
+    summary.blocks_synced = m_sync_blocks;
+
+    const int64_t start_time = m_sync_start_time;
+    const int64_t end_time = m_sync_end_time ? m_sync_end_time.load() : GetTimeMicros();
+    if (start_time > 0 && end_time > start_time) {
+        summary.blocks_per_second = summary.blocks_synced / ((end_time - start_time) / 1000000.0);
+    }
+    return summary;
+}
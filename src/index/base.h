@@ -20,6 +20,22 @@
 
 class CBlockIndex;
 
+/** Default for -indexsyncthreads, 0 = one per core */
+static const int DEFAULT_INDEX_SYNC_THREADS = 0;
+/** Maximum number of threads reading and preparing blocks ahead of an index sync */
+static const int MAX_INDEX_SYNC_THREADS = 16;
+
+/** Sync state and throughput of an index, see BaseIndex::GetSummary. */
+struct IndexSummary
+{
+    std::string name;
+    bool synced{false};
+    int best_block_height{-1};
+    int sync_threads{0};           //!< worker threads used by the last sync
+    uint64_t blocks_synced{0};     //!< blocks indexed by the last sync
+    double blocks_per_second{0.0}; //!< throughput of the last sync
+};
+
 template<typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
 {
@@ -50,7 +66,7 @@ protected:
         bool ReadBestBlock(CBlockLocator& locator) const;
 
         /// Write block locator of the chain that the txindex is in sync with.
-        bool WriteBestBlock(const CBlockLocator& locator);
+        void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
     };
 
 protected:
@@ -65,28 +81,66 @@ protected:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    /// Sync metrics, see GetSummary.
+    std::atomic<int> m_sync_threads{0};
+    std::atomic<uint64_t> m_sync_blocks{0};
+    std::atomic<int64_t> m_sync_start_time{0};
+    std::atomic<int64_t> m_sync_end_time{0};
+
     /// Sync the index with the block index starting from the current best block.
     /// Intended to be run in its own thread, m_thread_sync, and can be
     /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
     /// flag is set and the BlockConnected ValidationInterface callback takes
     /// over and the sync thread exits.
+    ///
+    /// Blocks are read from disk and prepared (see PrepareBlock) by a pool of
+    /// worker threads ahead of the sync thread, which commits them in chain
+    /// order.
     void ThreadSync();
 
+    /// Prepare and write the index entries of a connected block.
+    bool IndexBlock(const CBlock& block, const CBlockIndex* pindex);
+
     /// Write the current chain block locator to the DB.
     bool WriteBestBlock(const CBlockIndex* block_index);
 
+    /// Write the locator together with the state committed by CommitInternal.
+    bool Commit(const CBlockLocator& locator);
+
+    /// Disconnect the blocks from current_tip down to (excluding) new_tip, which
+    /// must be an ancestor of current_tip. Used to leave a stale branch during sync.
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip);
+
 protected:
     void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
                         const std::vector<CTransactionRef>& txn_conflicted) override;
 
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override;
+
     void ChainStateFlushed(const CBlockLocator& locator) override;
 
     /// Initialize internal state from the database and block index.
     virtual bool Init();
 
+    /// Add the index entries of a block that don't depend on any other block
+    /// to the batch. May be called out of chain order from the sync worker
+    /// threads, the batches are written in chain order before WriteBlock.
+    virtual bool PrepareBlock(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) const { return true; }
+
     /// Write update index entries for a newly connected block.
     virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
 
+    /// Called while syncing whenever the progress (in percent) changes.
+    virtual void SyncProgress(int progress) {}
+
+    /// Revert the index entries of a block that is disconnected from the chain.
+    /// Indices that only add entries keyed by content (e.g. txindex) don't need to.
+    virtual bool DisconnectBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
+
+    /// Flush index data that lives outside of the database and add the state
+    /// that must be persisted along with the best block locator to the batch.
+    virtual bool CommitInternal(CDBBatch& batch) { return true; }
+
     virtual DB& GetDB() const = 0;
 
     /// Get the name of the index for display in logs.
@@ -111,6 +165,9 @@ public:
 
     /// Stops the instance from staying in sync with blockchain updates.
     void Stop();
+
+    /// Get the sync state and throughput of the index.
+    IndexSummary GetSummary() const;
 };
 
 #endif // BITCOIN_INDEX_BASE_H
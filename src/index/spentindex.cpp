@@ -0,0 +1,72 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+
+#include <util/system.h>
+
+constexpr char DB_SPENT = 's';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+/**
+ * Access to the spent index database (indexes/spentindex/)
+ *
+ * Entries: ('s', spent outpoint) -> (spending txid, input index, height)
+ */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Read the spend of an outpoint. Returns false if the outpoint is not spent.
+    bool ReadSpend(const COutPoint& outpoint, SpentIndexValue& value) const;
+};
+
+SpentIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool SpentIndex::DB::ReadSpend(const COutPoint& outpoint, SpentIndexValue& value) const
+{
+    return Read(std::make_pair(DB_SPENT, outpoint), value);
+}
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<SpentIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+bool SpentIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) const
+{
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        const uint256& txid = tx->GetHash();
+        for (size_t i = 0; i < tx->vin.size(); ++i) {
+            batch.Write(std::make_pair(DB_SPENT, tx->vin[i].prevout),
+                        SpentIndexValue(txid, static_cast<uint32_t>(i), pindex->nHeight));
+        }
+    }
+    return true;
+}
+
+bool SpentIndex::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const auto& txin : tx->vin) {
+            batch.Erase(std::make_pair(DB_SPENT, txin.prevout));
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+bool SpentIndex::FindSpend(const COutPoint& outpoint, SpentIndexValue& value) const
+{
+    return m_db->ReadSpend(outpoint, value);
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SPENTINDEX_H
+#define BITCOIN_INDEX_SPENTINDEX_H
+
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+static const bool DEFAULT_SPENTINDEX = false;
+
+/** Input that spent an outpoint in the best chain. */
+struct SpentIndexValue
+{
+    uint256 txid;      //!< spending transaction
+    uint32_t vin{0};   //!< input index in the spending transaction
+    int height{0};     //!< height of the block containing the spending transaction
+
+    SpentIndexValue() = default;
+    SpentIndexValue(const uint256& txid, uint32_t vin, int height) : txid(txid), vin(vin), height(height) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(VARINT(vin));
+        READWRITE(VARINT(height, VarIntMode::NONNEGATIVE_SIGNED));
+    }
+};
+
+/**
+ * SpentIndex looks up the transaction that spent an outpoint. The index is
+ * written to a LevelDB database keyed by outpoint and follows reorgs by
+ * erasing the spends of disconnected blocks.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool PrepareBlock(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) const override;
+
+    bool DisconnectBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Look up the input that spent an outpoint.
+    ///
+    /// @param[in]   outpoint  The spent outpoint.
+    /// @param[out]  value  The spending transaction, input index and block height.
+    /// @return  true if the outpoint was spent in the indexed chain, false otherwise
+    bool FindSpend(const COutPoint& outpoint, SpentIndexValue& value) const;
+};
+
+/// The global spent index. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BITCOIN_INDEX_SPENTINDEX_H
@@ -0,0 +1,178 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/timestampindex.h>
+
+#include <util/system.h>
+
+#include <algorithm>
+
+constexpr char DB_BLOCK_HEIGHT = 't';
+
+std::unique_ptr<TimestampIndex> g_timestampindex;
+
+namespace {
+
+/** Height keys are big endian so that entries are iterated in chain order. */
+struct DBHeightKey
+{
+    int height{0};
+
+    DBHeightKey() = default;
+    explicit DBHeightKey(int height) : height(height) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_BLOCK_HEIGHT);
+        ser_writedata32be(s, height);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_BLOCK_HEIGHT) {
+            throw std::ios_base::failure("Invalid format for timestamp index height key");
+        }
+        height = ser_readdata32be(s);
+    }
+};
+
+struct DBVal
+{
+    uint256 hash;
+    int64_t time_max{0};
+
+    DBVal() = default;
+    DBVal(const uint256& hash, int64_t time_max) : hash(hash), time_max(time_max) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hash);
+        READWRITE(time_max);
+    }
+};
+
+} // namespace
+
+/**
+ * Access to the timestamp index database (indexes/timestampindex/)
+ *
+ * Entries: ('t', height) -> (block hash, maximum block time up to the block)
+ */
+class TimestampIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+TimestampIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "timestampindex", n_cache_size, f_memory, f_wipe)
+{}
+
+TimestampIndex::TimestampIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<TimestampIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+TimestampIndex::~TimestampIndex() {}
+
+bool TimestampIndex::Init()
+{
+    if (!BaseIndex::Init()) {
+        return false;
+    }
+
+    // Entries above the best block may be left over from an unclean shutdown,
+    // they are overwritten when the index syncs.
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    const size_t n_entries = best_block_index ? best_block_index->nHeight + 1 : 0;
+
+    std::vector<int64_t> time_max;
+    time_max.reserve(n_entries);
+
+    std::unique_ptr<CDBIterator> it(m_db->NewIterator());
+    it->Seek(DBHeightKey(0));
+
+    DBHeightKey key;
+    DBVal value;
+    for (; it->Valid() && time_max.size() < n_entries; it->Next()) {
+        if (!it->GetKey(key) || key.height != static_cast<int>(time_max.size())) {
+            break;
+        }
+        if (!it->GetValue(value)) {
+            return error("%s: Failed to read timestamp index entry at height %d", __func__, key.height);
+        }
+        time_max.push_back(value.time_max);
+    }
+    if (time_max.size() != n_entries) {
+        return error("%s: Timestamp index is missing the entry at height %u", __func__, time_max.size());
+    }
+
+    LOCK(m_mutex);
+    m_time_max.swap(time_max);
+    return true;
+}
+
+bool TimestampIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    const int64_t time_max = pindex->GetBlockTimeMax();
+    if (!m_db->Write(DBHeightKey(pindex->nHeight), DBVal(pindex->GetBlockHash(), time_max))) {
+        return error("%s: Failed to write timestamp index entry at height %d", __func__, pindex->nHeight);
+    }
+
+    LOCK(m_mutex);
+    if (m_time_max.size() < static_cast<size_t>(pindex->nHeight)) {
+        return error("%s: Block %s is not connected to the indexed chain", __func__, pindex->GetBlockHash().ToString());
+    }
+    m_time_max.resize(pindex->nHeight);
+    m_time_max.push_back(time_max);
+    return true;
+}
+
+bool TimestampIndex::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    {
+        LOCK(m_mutex);
+        if (m_time_max.size() > static_cast<size_t>(pindex->nHeight)) {
+            m_time_max.resize(pindex->nHeight);
+        }
+    }
+    return m_db->Erase(DBHeightKey(pindex->nHeight));
+}
+
+BaseIndex::DB& TimestampIndex::GetDB() const { return *m_db; }
+
+bool TimestampIndex::FindBlockAtTime(int64_t timestamp, int& height) const
+{
+    LOCK(m_mutex);
+    const auto it = std::upper_bound(m_time_max.begin(), m_time_max.end(), timestamp);
+    if (it == m_time_max.begin()) {
+        return false;
+    }
+    height = static_cast<int>(std::distance(m_time_max.begin(), it)) - 1;
+    return true;
+}
+
+bool TimestampIndex::FindEarliestAtLeast(int64_t timestamp, int& height) const
+{
+    LOCK(m_mutex);
+    const auto it = std::lower_bound(m_time_max.begin(), m_time_max.end(), timestamp);
+    if (it == m_time_max.end()) {
+        return false;
+    }
+    height = static_cast<int>(std::distance(m_time_max.begin(), it));
+    return true;
+}
+
+bool TimestampIndex::LookupBlockHash(int height, uint256& hash) const
+{
+    DBVal value;
+    if (!m_db->Read(DBHeightKey(height), value)) {
+        return false;
+    }
+    hash = value.hash;
+    return true;
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_TIMESTAMPINDEX_H
+#define BITCOIN_INDEX_TIMESTAMPINDEX_H
+
+#include <index/base.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <vector>
+
+static const bool DEFAULT_TIMESTAMPINDEX = false;
+
+/**
+ * TimestampIndex relates block times and heights of the active chain. Block
+ * times are not monotonic, so the index keeps the maximum block time up to
+ * each height (CBlockIndex::nTimeMax) in a flat in-memory vector, which
+ * allows binary searching a timestamp without holding cs_main. Entries are
+ * persisted to a LevelDB database keyed by height and loaded on startup.
+ */
+class TimestampIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    mutable Mutex m_mutex;
+    /// Maximum block time up to each height, indexed by height.
+    std::vector<int64_t> m_time_max GUARDED_BY(m_mutex);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool DisconnectBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "timestampindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit TimestampIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~TimestampIndex() override;
+
+    /// Find the block that was the chain tip at the given time, i.e. the
+    /// highest block whose maximum block time is not after the timestamp.
+    /// Returns false if the timestamp is before the genesis block.
+    bool FindBlockAtTime(int64_t timestamp, int& height) const;
+
+    /// Find the first block whose maximum block time is at or after the
+    /// timestamp. Returns false if no such block is indexed.
+    bool FindEarliestAtLeast(int64_t timestamp, int& height) const;
+
+    /// Look up the hash of the indexed block at a height.
+    bool LookupBlockHash(int height, uint256& hash) const;
+};
+
+/// The global timestamp index. May be null.
+extern std::unique_ptr<TimestampIndex> g_timestampindex;
+
+#endif // BITCOIN_INDEX_TIMESTAMPINDEX_H
@@ -60,8 +60,8 @@ public:
     /// transaction hash is not indexed.
     bool ReadTxPos(const uint256& txid, CDiskTxPos& pos) const;
 
-    /// Write a batch of transaction positions to the DB.
-    bool WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos);
+    /// Add a batch of transaction positions to a DB batch.
+    void WriteTxs(CDBBatch& batch, const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos) const;
 
     /// Migrate txindex data from the block tree DB, where it may be for older nodes that have not
     /// been upgraded yet to the new database.
@@ -77,13 +77,11 @@ bool TxIndex::DB::ReadTxPos(const uint256 &txid, CDiskTxPos& pos) const
     return Read(std::make_pair(DB_TXINDEX, txid), pos);
 }
 
-bool TxIndex::DB::WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos)
+void TxIndex::DB::WriteTxs(CDBBatch& batch, const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos) const
 {
-    CDBBatch batch(*this);
     for (const auto& tuple : v_pos) {
         batch.Write(std::make_pair(DB_TXINDEX, tuple.first), tuple.second);
     }
-    return WriteBatch(batch);
 }
 
 /*
@@ -244,7 +242,7 @@ bool TxIndex::Init()
     return BaseIndex::Init();
 }
 
-bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+bool TxIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) const
 {
     // Exclude genesis block transaction because outputs are not spendable.
     if (pindex->nHeight == 0) return true;
@@ -256,7 +254,8 @@ bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
         vPos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
-    return m_db->WriteTxs(vPos);
+    m_db->WriteTxs(batch, vPos);
+    return true;
 }
 
 BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
@@ -289,155 +288,12 @@ bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRe
     return true;
 }
 
-/**
- * Helper that writes the best block index on the txindex.
- * @param height
- */
-void TxIndex::writeBestBlock(const int height) {
-    CBlockIndex *blockIndex = nullptr;
-    {
-        LOCK(cs_main);
-        blockIndex = chainActive[height];
-    }
-    if (blockIndex) {
-        WriteBestBlock(blockIndex);
-        m_best_block_index = blockIndex;
-        LogPrintf("%s is enabled at height %d\n", GetName(), blockIndex->nHeight);
-    } else {
-        LogPrintf("%s is enabled\n", GetName());
-    }
-}
-
-/**
- * Threaded txindex sync
- */
-void TxIndex::ThreadSync()
+void TxIndex::SyncProgress(int progress)
 {
-    const CBlockIndex *pindex = m_best_block_index.load();
-
-    // If txindex is already caught up
-    if (pindex == chainActive.Tip()) {
-        if (pindex) // make sure index is defined
-            writeBestBlock(pindex->nHeight);
-        m_synced = true;
-        return;
-    }
-
-    int totalBlocks{0};
-    int startingHeight{0};
-    {
-        LOCK(cs_main);
-        if (pindex) {
-            startingHeight = pindex->nHeight + 1;
-            totalBlocks = chainActive.Height() - startingHeight;
-        } else
-            totalBlocks = chainActive.Height();
+    // The txindex is synced during startup, report the progress like the
+    // other startup steps.
+    if (progress % 10 == 0) {
+        LogPrintf("Loading txindex [%u%%]\n", progress);
     }
-
-    const auto & consensus = Params().GetConsensus();
-    const auto cores = GetNumCores();
-    LogPrintf("Loading txindex with %u thread%s\n", cores, cores > 1 ? "s" : "");
-    LogPrintf("Loading txindex [0%%]\n");
-    uiInterface.ShowProgress(_("Loading transaction index"), 0, false);
-
-    // For small number of blocks use single thread
-    if (totalBlocks < 1440) {
-        for (int i = startingHeight; i < totalBlocks; ++i) {
-            CBlockIndex *blockIndex = nullptr;
-            {
-                LOCK(cs_main);
-                blockIndex = chainActive[i];
-            }
-            CBlock block;
-            if (!ReadBlockFromDisk(block, blockIndex, consensus)) {
-                FatalError("txindex failed to read block %s from disk", blockIndex->GetBlockHash().ToString());
-                return;
-            }
-            if (!WriteBlock(block, blockIndex)) {
-                FatalError("txindex failed to write block %s to index database", blockIndex->GetBlockHash().ToString());
-                return;
-            }
-        }
-        writeBestBlock(startingHeight + totalBlocks);
-        m_synced = true;
-        uiInterface.ShowProgress(_("Loading transaction index"), 100, false);
-        return;
-    }
-
-    // Use multiple threads to load the txindex. First the indices are sharded
-    // one for each cpu thread. SSDs will see the highest performance gain,
-    // older disks might not see any improvements. Each thread works on its
-    // own shard and loads transaction data from disk as needed. Threads sync
-    // on a counter to report progress. Threads will break on the shutdown
-    // request to prevent hangs during an abrupt shutdown. Caught exceptions
-    // will result in a graceful shutdown request if possible.
-
-    // Shard the block indices into 1 per cpu thread (or core depending on system)
-    struct range {
-        int begin{0};
-        int end{0};
-        explicit range(int begin, int end) : begin(begin), end(end) {}
-    };
-    std::vector<std::shared_ptr<CBlock>> blocks;
-    std::vector<range> slices;
-    const auto allIndices = static_cast<int>(totalBlocks);
-    const auto shardSize = static_cast<int>(totalBlocks/cores);
-    for (int i = 0; i < cores; ++i) {
-        const int startH = startingHeight + shardSize * i;
-        const int endH = startH + shardSize - 1;
-        slices.emplace_back(startH, endH);
-    }
-    slices[cores-1].end += totalBlocks % cores + 1; // add remainder to last shard, plus the last block
-
-    // Init txindex db with multiple threads
-    boost::thread_group tg;
-    unsigned int counter{0};
-    Mutex mu;
-    for (const auto & shard : slices) {
-        try {
-            tg.create_thread([&shard,&mu,&allIndices,&counter,consensus,this] {
-                RenameThread("blocknet-txindex");
-                for (int i = shard.begin; i <= shard.end; ++i) {
-                    if (ShutdownRequested())
-                        break;
-
-                    CBlockIndex *pindex = nullptr;
-                    {
-                        LOCK(cs_main);
-                        pindex = chainActive[i];
-                    }
-
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, pindex, consensus)) {
-                        FatalError("txindex failed to read block %s from disk", pindex->GetBlockHash().ToString());
-                        return;
-                    }
-                    if (!WriteBlock(block, pindex)) {
-                        FatalError("txindex failed to write block %s to index database", pindex->GetBlockHash().ToString());
-                        return;
-                    }
-
-                    {
-                        LOCK(mu);
-                        ++counter;
-                        const int perticks = 10;
-                        const int shardpos = allIndices < perticks ? 1 : static_cast<int>((double)allIndices/(double)perticks);
-                        if (counter % shardpos == 0) {
-                            int p = static_cast<int>((double)counter/(double)allIndices*100.0);
-                            LogPrintf("Loading txindex [%u%%]\n", p);
-                            uiInterface.ShowProgress(_("Loading transaction index"), p, false);
-                        }
-                    }
-
-                }
-            });
-        } catch (...) {
-            FatalError("txindex failed to create init thread");
-            return;
-        }
-    }
-    tg.join_all();
-
-    writeBestBlock(startingHeight + totalBlocks);
-    m_synced = true;
+    uiInterface.ShowProgress(_("Loading transaction index"), progress, false);
 }
@@ -27,13 +27,13 @@ protected:
     /// Override base class init to migrate from old database.
     bool Init() override;
 
-    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    bool PrepareBlock(const CBlock& block, const CBlockIndex* pindex, CDBBatch& batch) const override;
 
     BaseIndex::DB& GetDB() const override;
 
     const char* GetName() const override { return "txindex"; }
 
-    void ThreadSync();
+    void SyncProgress(int progress) override;
 
 public:
     /// Constructs the index, which becomes available to be queried.
@@ -58,7 +58,7 @@ public:
         }
     }
 
-    /// Sync up to the current tip.
+    /// Sync up to the current tip on the calling thread.
     void Sync() {
         CBlockLocator locator;
         if (!GetDB().ReadBestBlock(locator)) {
@@ -76,6 +76,7 @@ public:
         }
 
         ThreadSync();
+        uiInterface.ShowProgress("", 100, false);
     }
 
     /// Connect block to the index
@@ -93,9 +94,6 @@ public:
     const CBlockIndex* BestBlockIndex() {
         return m_best_block_index;
     }
-
-private:
-    void writeBestBlock(const int height);
 };
 
 /// The global transaction index, used in GetTransaction. May be null.
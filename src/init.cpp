@@ -24,6 +24,10 @@
 #include <httpserver.h>
 #include <httprpc.h>
 #include <interfaces/chain.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
 #include <index/txindex.h>
 #include <kernel.h>
 #include <key.h>
@@ -32,6 +36,10 @@
 #include <netbase.h>
 #include <net.h>
 #include <net_processing.h>
+#include <node/blockcache.h>
+#include <node/blockprefetch.h>
+#include <node/dbcompaction.h>
+#include <node/utxo_snapshot.h>
 #include <policy/feerate.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -197,6 +205,24 @@ void Interrupt()
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_addressindex) {
+        g_addressindex->Interrupt();
+    }
+    if (g_spentindex) {
+        g_spentindex->Interrupt();
+    }
+    if (g_blockfilterindex) {
+        g_blockfilterindex->Interrupt();
+    }
+    if (g_timestampindex) {
+        g_timestampindex->Interrupt();
+    }
+    if (g_utxo_snapshot) {
+        g_utxo_snapshot->Interrupt();
+    }
+    if (g_db_compactor) {
+        g_db_compactor->Interrupt();
+    }
 }
 
 void Shutdown(InitInterfaces& interfaces)
@@ -236,6 +262,13 @@ void Shutdown(InitInterfaces& interfaces)
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
+    if (g_addressindex) g_addressindex->Stop();
+    if (g_spentindex) g_spentindex->Stop();
+    if (g_blockfilterindex) g_blockfilterindex->Stop();
+    if (g_timestampindex) g_timestampindex->Stop();
+    if (g_utxo_snapshot) g_utxo_snapshot->Stop();
+    if (g_block_prefetcher) g_block_prefetcher->Stop();
+    if (g_db_compactor) g_db_compactor->Stop();
 
     StopTorControl();
 
@@ -250,6 +283,14 @@ void Shutdown(InitInterfaces& interfaces)
     g_connman.reset();
     g_banman.reset();
     g_txindex.reset();
+    g_addressindex.reset();
+    g_spentindex.reset();
+    g_blockfilterindex.reset();
+    g_timestampindex.reset();
+    g_utxo_snapshot.reset();
+    g_block_prefetcher.reset();
+    g_block_cache.reset();
+    g_db_compactor.reset();
 
     if (g_is_mempool_loaded && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
@@ -380,6 +421,11 @@ void SetupServerArgs()
     const auto testnetChainParams = CreateChainParams(CBaseChainParams::TESTNET);
     const auto regtestChainParams = CreateChainParams(CBaseChainParams::REGTEST);
 
+    std::string db_profiles;
+    for (const DBProfile& profile : GetDBProfiles()) {
+        db_profiles += (db_profiles.empty() ? "" : ", ") + std::string(profile.name);
+    }
+
     // Hidden Options
     std::vector<std::string> hidden_args = {
         "-dbcrashratio", "-forcecompactdb",
@@ -391,16 +437,22 @@ void SetupServerArgs()
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify blocks directory (default: <datadir>/blocks)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockcachesize=<n>", strprintf("Maximum memory of the cache of serialized blocks served to peers and REST clients in MiB (0 to disable, default: %u)", DEFAULT_BLOCK_CACHE_SIZE), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockprefetch=<n>", strprintf("Number of blocks on the best chain read ahead of their validation on %u threads (0 to disable, max: %d, default: %d)", BLOCK_PREFETCH_THREADS, MAX_BLOCK_PREFETCH, DEFAULT_BLOCK_PREFETCH), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockreconstructionextratxnsize=<n>", strprintf("Maximum memory of the extra transactions kept for compact block reconstructions in megabytes (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to operate in a blocks only mode (default: %u)", DEFAULT_BLOCKSONLY), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-dbcompactidle=<n>", strprintf("Compact the chain state and block index databases in the background when the node is idle, at most every <n> hours (0 to disable, default: %u)", DEFAULT_DB_COMPACT_IDLE), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-dbprofile=<profile>", strprintf("Tune the databases for the disk and memory of the node, one of: %s (default: %s)", db_profiles, DEFAULT_DB_PROFILE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-loadutxosnapshot=<file>", "Load a UTXO set snapshot pinned in the chain parameters (see the dumptxoutset rpc) on startup. Service node collateral is validated against the snapshot until the chain reaches its block, at which point the snapshot is compared with the chain state", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), false, OptionsCategory::OPTIONS);
@@ -420,6 +472,11 @@ void SetupServerArgs()
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", "Blocknet requires txindex to support the Proof of Stake protocol.", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-addressindex", strprintf("Maintain an index of the transactions and unspent outputs of each address, used by the getaddress* rpc calls and the /rest/address endpoints (default: %u)", DEFAULT_ADDRESSINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-spentindex", strprintf("Maintain an index of the inputs spending each output, used by the getspentinfo rpc call (default: %u)", DEFAULT_SPENTINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockfilterindex", strprintf("Maintain an index of BIP 158 basic compact block filters, used by the getblockfilter rpc call and -peerblockfilters (default: %u)", DEFAULT_BLOCKFILTERINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-timestampindex", strprintf("Maintain an index of the block times of the active chain, used by the getblockattime rpc call and the xrGetBlockAtTime xrouter call (default: %u)", DEFAULT_TIMESTAMPINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-indexsyncthreads=<n>", strprintf("Set the number of threads reading blocks ahead while building the indexes (1 to %d, 0 = one per core, default: %d)", MAX_INDEX_SYNC_THREADS, DEFAULT_INDEX_SYNC_THREADS), false, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-addnode=<ip>", "Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info). This option can be specified multiple times to add multiple nodes.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-banscore=<n>", strprintf("Threshold for disconnecting misbehaving peers (default: %u)", DEFAULT_BANSCORE_THRESHOLD), false, OptionsCategory::CONNECTION);
@@ -439,13 +496,20 @@ void SetupServerArgs()
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msghandlerthreads=<n>", strprintf("Number of threads processing service node, XBridge and XRouter messages, 0 processes them on the message handler thread (0 to %d, default: %d)", MAX_MSGHANDLER_THREADS, DEFAULT_MSGHANDLER_THREADS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-peerblockfilters", strprintf("Serve compact block filters to peers per BIP 157 (default: %u)", DEFAULT_PEERBLOCKFILTERS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-permitbaremultisig", strprintf("Relay non-P2SH multisig (default: %u)", DEFAULT_PERMIT_BAREMULTISIG), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-port=<port>", strprintf("Listen for connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultChainParams->GetDefaultPort(), testnetChainParams->GetDefaultPort(), regtestChainParams->GetDefaultPort()), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), false, OptionsCategory::CONNECTION);
+#ifdef USE_EPOLL
+    gArgs.AddArg("-socketevents=<mode>", strprintf("Wait for socket events with '%s' or '%s' (default: %s)", SOCKETEVENTS_EPOLL, SOCKETEVENTS_WAIT, DEFAULT_SOCKETEVENTS), false, OptionsCategory::CONNECTION);
+#else
+    gArgs.AddArg("-socketevents=<mode>", strprintf("Wait for socket events with '%s' (default: %s)", SOCKETEVENTS_WAIT, DEFAULT_SOCKETEVENTS), false, OptionsCategory::CONNECTION);
+#endif
     gArgs.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), true, OptionsCategory::CONNECTION);
@@ -475,6 +539,12 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxborder=<address>", "Enable publish new xbridge orders in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxborderstate=<address>", "Enable publish xbridge order state changes in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxbtrade=<address>", "Enable publish completed xbridge trades in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxborderhwm=<n>", strprintf("Set publish xbridge order outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxborderstatehwm=<n>", strprintf("Set publish xbridge order state outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubxbtradehwm=<n>", strprintf("Set publish xbridge trade outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
@@ -484,6 +554,12 @@ void SetupServerArgs()
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
+    hidden_args.emplace_back("-zmqpubxborder=<address>");
+    hidden_args.emplace_back("-zmqpubxborderstate=<address>");
+    hidden_args.emplace_back("-zmqpubxbtrade=<address>");
+    hidden_args.emplace_back("-zmqpubxborderhwm=<n>");
+    hidden_args.emplace_back("-zmqpubxborderstatehwm=<n>");
+    hidden_args.emplace_back("-zmqpubxbtradehwm=<n>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), true, OptionsCategory::DEBUG_TEST);
@@ -927,6 +1003,7 @@ int nUserMaxConnections;
 int nFD;
 ServiceFlags nLocalServices = ServiceFlags(NODE_NETWORK | NODE_NETWORK_LIMITED);
 int64_t peer_connect_timeout;
+bool use_epoll = false;
 
 } // namespace
 
@@ -1079,6 +1156,10 @@ bool AppInitParameterInteraction()
         LogPrintf("Warning: nMinimumChainWork set below default value of %s\n", chainparams.GetConsensus().nMinimumChainWork.GetHex());
     }
 
+    if (!FindDBProfile(gArgs.GetArg("-dbprofile", DEFAULT_DB_PROFILE))) {
+        return InitError(strprintf(_("Unknown database profile specified in -dbprofile: '%s'"), gArgs.GetArg("-dbprofile", DEFAULT_DB_PROFILE)));
+    }
+
     // mempool limits
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nMempoolSizeMin = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000 * 40;
@@ -1131,6 +1212,14 @@ bool AppInitParameterInteraction()
         return InitError("peertimeout cannot be configured with a negative value.");
     }
 
+    const std::string socket_events = gArgs.GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+#ifdef USE_EPOLL
+    use_epoll = socket_events == SOCKETEVENTS_EPOLL;
+#endif
+    if (!use_epoll && socket_events != SOCKETEVENTS_WAIT) {
+        return InitError(strprintf(_("Unsupported -socketevents mode: '%s'"), socket_events));
+    }
+
     if (gArgs.IsArgSet("-minrelaytxfee")) {
         CAmount n = 0;
         if (!ParseMoney(gArgs.GetArg("-minrelaytxfee", ""), n)) {
@@ -1196,6 +1285,13 @@ bool AppInitParameterInteraction()
     if (gArgs.GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    if (gArgs.GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (!gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+            return InitError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+        }
+        nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
+    }
+
     if (gArgs.GetArg("-rpcserialversion", DEFAULT_RPC_SERIALIZE_VERSION) < 0)
         return InitError("rpcserialversion must be non-negative.");
 
@@ -1496,6 +1592,26 @@ bool AppInitMain(InitInterfaces& interfaces)
     nTotalCache -= nBlockTreeDBCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 8, nMaxTxIndexCache << 20); // Blocknet PoS requires txindex
     nTotalCache -= nTxIndexCache;
+    int64_t nAddressIndexCache = 0;
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        nAddressIndexCache = std::min(nTotalCache / 8, nMaxAddressIndexCache << 20);
+        nTotalCache -= nAddressIndexCache;
+    }
+    int64_t nSpentIndexCache = 0;
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        nSpentIndexCache = std::min(nTotalCache / 8, nMaxSpentIndexCache << 20);
+        nTotalCache -= nSpentIndexCache;
+    }
+    int64_t nBlockFilterIndexCache = 0;
+    if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        nBlockFilterIndexCache = std::min(nTotalCache / 8, nMaxBlockFilterIndexCache << 20);
+        nTotalCache -= nBlockFilterIndexCache;
+    }
+    int64_t nTimestampIndexCache = 0;
+    if (gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
+        nTimestampIndexCache = std::min(nTotalCache / 8, nMaxTimestampIndexCache << 20);
+        nTotalCache -= nTimestampIndexCache;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1505,6 +1621,14 @@ bool AppInitMain(InitInterfaces& interfaces)
     LogPrintf("* Using %.1f MiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     // Blocknet PoS requires txindex
         LogPrintf("* Using %.1f MiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
+    if (nAddressIndexCache > 0)
+        LogPrintf("* Using %.1f MiB for address index database\n", nAddressIndexCache * (1.0 / 1024 / 1024));
+    if (nSpentIndexCache > 0)
+        LogPrintf("* Using %.1f MiB for spent index database\n", nSpentIndexCache * (1.0 / 1024 / 1024));
+    if (nBlockFilterIndexCache > 0)
+        LogPrintf("* Using %.1f MiB for block filter index database\n", nBlockFilterIndexCache * (1.0 / 1024 / 1024));
+    if (nTimestampIndexCache > 0)
+        LogPrintf("* Using %.1f MiB for timestamp index database\n", nTimestampIndexCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1693,8 +1817,49 @@ bool AppInitMain(InitInterfaces& interfaces)
         ::feeEstimator.Read(est_filein);
     fFeeEstimatesInitialized = true;
 
+    if (gArgs.IsArgSet("-loadutxosnapshot")) {
+        const fs::path snapshot_path = AbsPathForConfigVal(gArgs.GetArg("-loadutxosnapshot", ""), false);
+        SnapshotMetadata metadata;
+        std::string error;
+        if (!ReadSnapshotMetadata(snapshot_path, metadata, error)) {
+            return InitError(error);
+        }
+        bool fPastSnapshot;
+        {
+            LOCK(cs_main);
+            fPastSnapshot = chainActive.Height() >= metadata.m_base_height;
+        }
+        if (fPastSnapshot) {
+            LogPrintf("Not loading the UTXO snapshot of block %s, the chain is past height %d\n",
+                      metadata.m_base_blockhash.ToString(), metadata.m_base_height);
+        } else {
+            uiInterface.InitMessage(_("Loading UTXO snapshot..."));
+            g_utxo_snapshot = MakeUnique<UTXOSnapshot>(nCoinDBCache);
+            if (!g_utxo_snapshot->Load(snapshot_path, error)) {
+                g_utxo_snapshot.reset();
+                return InitError(error);
+            }
+        }
+    }
+
     // ********************************************************* Step 8: start indexers
     // Blocknet PoS requires indexer to be started before chain load
+    if (nAddressIndexCache > 0) {
+        g_addressindex = MakeUnique<AddressIndex>(nAddressIndexCache, false, fReindex);
+        g_addressindex->Start();
+    }
+    if (nSpentIndexCache > 0) {
+        g_spentindex = MakeUnique<SpentIndex>(nSpentIndexCache, false, fReindex);
+        g_spentindex->Start();
+    }
+    if (nBlockFilterIndexCache > 0) {
+        g_blockfilterindex = MakeUnique<BlockFilterIndex>(BlockFilterType::BASIC, nBlockFilterIndexCache, false, fReindex);
+        g_blockfilterindex->Start();
+    }
+    if (nTimestampIndexCache > 0) {
+        g_timestampindex = MakeUnique<TimestampIndex>(nTimestampIndexCache, false, fReindex);
+        g_timestampindex->Start();
+    }
 
     // ********************************************************* Step 9: load wallet
     for (const auto& client : interfaces.chain_clients) {
@@ -1752,6 +1917,19 @@ bool AppInitMain(InitInterfaces& interfaces)
         vImportFiles.push_back(strFile);
     }
 
+    const int nBlockPrefetch = std::min<int>(gArgs.GetArg("-blockprefetch", DEFAULT_BLOCK_PREFETCH), MAX_BLOCK_PREFETCH);
+    if (nBlockPrefetch > 0) {
+        g_block_prefetcher = MakeUnique<BlockPrefetcher>(chainparams.GetConsensus(), BLOCK_PREFETCH_THREADS, nBlockPrefetch);
+    }
+
+    const int64_t nBlockCacheSize = gArgs.GetArg("-blockcachesize", DEFAULT_BLOCK_CACHE_SIZE);
+    if (nBlockCacheSize > 0) {
+        g_block_cache = MakeUnique<BlockCache>(nBlockCacheSize << 20);
+    }
+
+    const int64_t nDBCompactIdle = gArgs.GetArg("-dbcompactidle", DEFAULT_DB_COMPACT_IDLE);
+    g_db_compactor = MakeUnique<DBCompactor>(std::max<int64_t>(nDBCompactIdle, 0) * 60 * 60);
+
     threadGroup.create_thread(std::bind(&ThreadImport, vImportFiles));
 
     // Wait for txindex
@@ -1825,6 +2003,8 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.m_use_epoll = use_epoll;
+    connOptions.nMsgHandlerThreads = std::max(0, std::min<int>(gArgs.GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS), MAX_MSGHANDLER_THREADS));
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
@@ -1933,5 +2113,11 @@ bool AppInitMain(InitInterfaces& interfaces)
         g_banman->DumpBanlist();
     }, DUMP_BANS_INTERVAL * 1000);
 
+    if (nDBCompactIdle > 0) {
+        scheduler.scheduleEvery([]{
+            g_db_compactor->CompactIfIdle();
+        }, DB_COMPACT_IDLE_CHECK_INTERVAL * 1000);
+    }
+
     return true;
 }
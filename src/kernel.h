@@ -318,8 +318,12 @@ public:
         }
         bool fNewBlock = false;
         try {
-            auto pblocktemplate = BlockAssembler(chainparams).CreateNewBlockPoS(*stakeCoin.coin, stakeCoin.hashBlock,
-                    stakeCoin.time, stakeCoin.wallet.get());
+            std::unique_ptr<CBlockTemplate> pblocktemplate;
+            if (templateCache) // use the block prepared on the tip if there is one
+                pblocktemplate = templateCache->CreateBlock(*stakeCoin.coin, stakeCoin.hashBlock, stakeCoin.time, stakeCoin.wallet.get());
+            if (!pblocktemplate)
+                pblocktemplate = BlockAssembler(chainparams).CreateNewBlockPoS(*stakeCoin.coin, stakeCoin.hashBlock,
+                        stakeCoin.time, stakeCoin.wallet.get());
             if (!pblocktemplate)
                 return false;
             auto pblock = std::make_shared<const CBlock>(pblocktemplate->block);
@@ -337,6 +341,10 @@ public:
         return lastUpdateTime;
     }
 
+    void SetTemplateCache(std::shared_ptr<StakeTemplateCache> cache) {
+        templateCache = cache;
+    }
+
     const StakeCoin & GetStake() {
         if (!stakeTimes.empty())
             return *stakeTimes.begin()->second.begin();
@@ -359,6 +367,7 @@ private:
     std::map<uint256, uint64_t> stakeModifiers;
     std::atomic<int64_t> lastUpdateTime{0};
     std::atomic<int> lastBlockHeight{0};
+    std::shared_ptr<StakeTemplateCache> templateCache;
 };
 
 
@@ -366,6 +375,13 @@ void static ThreadStakeMinter() {
     RenameThread("blocknet-staker");
     LogPrintf("Staker has started\n");
     StakeMgr staker;
+    auto templateCache = std::make_shared<StakeTemplateCache>(Params());
+    RegisterValidationInterface(templateCache.get());
+    struct Unregister { // also when the thread is interrupted
+        CValidationInterface *p;
+        ~Unregister() { UnregisterValidationInterface(p); }
+    } unregister{templateCache.get()};
+    staker.SetTemplateCache(templateCache);
     while (!ShutdownRequested()) {
         const int sleepTimeSeconds{1};
         if (IsInitialBlockDownload()) { // do not stake during initial download
@@ -379,6 +395,7 @@ void static ThreadStakeMinter() {
                 LOCK(cs_main);
                 pindex = chainActive.Tip();
             }
+            templateCache->Refresh(); // pick up new mempool transactions
             if (pindex && staker.Update(wallets, pindex, Params().GetConsensus())) {
                 boost::this_thread::interruption_point();
                 staker.TryStake(pindex, Params());
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include <flatmap.h>
 #include <indirectmap.h>
 
 #include <stdlib.h>
@@ -165,6 +166,15 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+// flatmap allocates its table, the pool chunks holding the entries, and the
+// lists of chunks and of erased entries
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const flatmap<X, Y, Z>& m)
+{
+    return MallocUsage(m.slot_bytes()) + MallocUsage(flatmap<X, Y, Z>::chunk_bytes()) * m.chunk_count() +
+           MallocUsage(m.chunk_list_bytes()) + MallocUsage(m.free_list_bytes());
+}
+
 }
 
 #endif // BITCOIN_MEMUSAGE_H
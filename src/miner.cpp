@@ -184,40 +184,42 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCoin & stakeInput, const uint256 & stakeBlockHash,
                                                                   const int64_t & stakeTime, CWallet *keystore,
                                                                   const bool & disableValidationChecks)
+{
+    PrepareBlockPoS();
+    return FinishBlockPoS(stakeInput, stakeBlockHash, stakeTime, keystore, disableValidationChecks);
+}
+
+void BlockAssembler::PrepareBlockPoS()
 {
     int64_t nTimeStart = GetTimeMicros();
 
     resetBlock();
 
     pblocktemplate.reset(new CBlockTemplate());
-
-    if(!pblocktemplate.get())
-        return nullptr;
     pblock = &pblocktemplate->block; // pointer for convenience
 
     pblock->vtx.resize(2); // Support coinbase and coinstake txs
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOpsCost.push_back(-1); // updated at end
 
-    CBlockIndex* pindexPrev = nullptr;
     int64_t nMedianTimePast;
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
 
     {
         LOCK2(cs_main, mempool.cs);
-        pindexPrev = chainActive.Tip();
-        assert(pindexPrev != nullptr);
-        nHeight = pindexPrev->nHeight + 1;
+        pindexPrevPoS = chainActive.Tip();
+        assert(pindexPrevPoS != nullptr);
+        nHeight = pindexPrevPoS->nHeight + 1;
 
-        pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
+        pblock->nVersion = ComputeBlockVersion(pindexPrevPoS, chainparams.GetConsensus());
         // -regtest only: allow overriding block.nVersion with
         // -blockversion=N to test forking scenarios
         if (chainparams.MineBlocksOnDemand())
             pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
 
         pblock->nTime = GetAdjustedTime();
-        nMedianTimePast = pindexPrev->GetMedianTimePast();
+        nMedianTimePast = pindexPrevPoS->GetMedianTimePast();
 
         nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
                            ? nMedianTimePast
@@ -232,13 +234,11 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCo
         // not activated.
         // TODO: replace this with a call to main to assess validity of a mempool
         // transaction (which in most cases can be a no-op).
-        fIncludeWitness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus());
+        fIncludeWitness = IsWitnessEnabled(pindexPrevPoS, chainparams.GetConsensus());
 
         addPackageTxs(nPackagesSelected, nDescendantsUpdated);
     }
 
-    int64_t nTime1 = GetTimeMicros();
-
     m_last_block_num_txs = nBlockTx;
     m_last_block_weight = nBlockWeight;
 
@@ -252,25 +252,47 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCo
     coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
     pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
 
-    // Create coinstake transaction
-    CMutableTransaction coinstakeTx;
-    coinstakeTx.vin.resize(1);
-    coinstakeTx.vin[0] = CTxIn(stakeInput.outpoint);
-    coinstakeTx.vout.resize(2); // coinstake + stake payment
-    coinstakeTx.vout[0].SetNull(); // coinstake
-    coinstakeTx.vout[0].nValue = 0;
+    // Superblock payees are paid by the coinstake
+    superblockPayees.clear();
     if (gov::Governance::isSuperblock(nHeight, chainparams.GetConsensus())) {
         const auto & results = gov::Governance::instance().getSuperblockResults(nHeight, chainparams.GetConsensus());
         if (!results.empty()) {
-            const auto &payees = gov::Governance::getSuperblockPayees(nHeight, results, chainparams.GetConsensus());
-            if (payees.empty())
+            superblockPayees = gov::Governance::getSuperblockPayees(nHeight, results, chainparams.GetConsensus());
+            if (superblockPayees.empty())
                 throw std::runtime_error(strprintf("%s: Bad superblock payees, failed to stake", __func__));
-            coinstakeTx.vout.resize(2 + payees.size()); // coinstake + stake payment + payees
-            for (int i = 0; i < static_cast<int>(payees.size()); ++i)
-                coinstakeTx.vout[2 + i] = payees[i];
         }
     }
 
+    pblock->hashPrevBlock  = pindexPrevPoS->GetBlockHash();
+    pblock->nNonce         = 0;
+
+    int64_t nTime1 = GetTimeMicros();
+
+    LogPrint(BCLog::BENCH, "Staking - packages: %.2fms (%d packages, %d updated descendants)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated);
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::FinishBlockPoS(const CInputCoin & stakeInput, const uint256 & stakeBlockHash,
+                                                               const int64_t & stakeTime, CWallet *keystore,
+                                                               const bool & disableValidationChecks) const
+{
+    assert(pblocktemplate && pindexPrevPoS);
+    int64_t nTimeStart = GetTimeMicros();
+
+    // The prepared block is kept for the next stake
+    std::unique_ptr<CBlockTemplate> blocktemplate(new CBlockTemplate(*pblocktemplate));
+    CBlock & block = blocktemplate->block;
+    CBlockIndex* pindexPrev = pindexPrevPoS;
+
+    // Create coinstake transaction
+    CMutableTransaction coinstakeTx;
+    coinstakeTx.vin.resize(1);
+    coinstakeTx.vin[0] = CTxIn(stakeInput.outpoint);
+    coinstakeTx.vout.resize(2 + superblockPayees.size()); // coinstake + stake payment + payees
+    coinstakeTx.vout[0].SetNull(); // coinstake
+    coinstakeTx.vout[0].nValue = 0;
+    for (int i = 0; i < static_cast<int>(superblockPayees.size()); ++i)
+        coinstakeTx.vout[2 + i] = superblockPayees[i];
+
     const bool feesEnabled = IsNetworkFeesEnabled(pindexPrev, chainparams.GetConsensus());
     // Can't claim any part of the superblock amount as stake reward
     const auto stakeSubsidy = GetBlockSubsidy(nHeight, chainparams.GetConsensus()) -
@@ -311,49 +333,49 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockPoS(const CInputCo
 
     // Calculate network fee for coinbase/coinstake txs
     signInput(coinstakeTx, keystore); // add signature
-    const auto coinbaseBytes = ::GetSerializeSize(coinbaseTx, PROTOCOL_VERSION);
+    const auto coinbaseBytes = ::GetSerializeSize(*block.vtx[0], PROTOCOL_VERSION);
     const auto coinstakeBytes = ::GetSerializeSize(coinstakeTx, PROTOCOL_VERSION);
     CAmount estimatedNetworkFee = static_cast<CAmount>(::minRelayTxFee.GetFee(coinbaseBytes) + ::minRelayTxFee.GetFee(coinstakeBytes));
     coinstakeTx.vout[1] = CTxOut(stakeInput.txout.nValue + stakeAmount - estimatedNetworkFee, paymentScript); // staker payment w/ network fee taken out
     signInput(coinstakeTx, keystore); // resign with correct fee estimation
 
     // Assign coinstake tx
-    pblock->vtx[1] = MakeTransactionRef(std::move(coinstakeTx));
+    block.vtx[1] = MakeTransactionRef(std::move(coinstakeTx));
 
     // Coinbase commitment
-    pblocktemplate->vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, chainparams.GetConsensus()); // TODO Blocknet PoS handle coinbase commitment
-    pblocktemplate->vTxFees[0] = -nFees;
+    blocktemplate->vchCoinbaseCommitment = GenerateCoinbaseCommitment(block, pindexPrev, chainparams.GetConsensus()); // TODO Blocknet PoS handle coinbase commitment
+    blocktemplate->vTxFees[0] = -nFees;
 
-    LogPrintf("Staking - block weight: %u txs: %u fees: %ld sigops %d\n", GetBlockWeight(*pblock), nBlockTx, nFees, nBlockSigOpsCost);
+    LogPrintf("Staking - block weight: %u txs: %u fees: %ld sigops %d\n", GetBlockWeight(block), nBlockTx, nFees, nBlockSigOpsCost);
 
     // Fill in header
-    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
-    pblock->nTime          = static_cast<uint32_t>(stakeTime);
-    pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
-    pblock->nNonce         = 0;
-    pblock->hashStake      = stakeInput.outpoint.hash;
-    pblock->nStakeIndex    = stakeInput.outpoint.n;
-    pblock->nStakeAmount   = stakeInput.txout.nValue;
-    pblock->hashStakeBlock = stakeBlockHash;
+    block.nTime          = static_cast<uint32_t>(stakeTime);
+    block.nBits          = GetNextWorkRequired(pindexPrev, &block, chainparams.GetConsensus());
+    block.hashStake      = stakeInput.outpoint.hash;
+    block.nStakeIndex    = stakeInput.outpoint.n;
+    block.nStakeAmount   = stakeInput.txout.nValue;
+    block.hashStakeBlock = stakeBlockHash;
 
-    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
-    pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    blocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*block.vtx[0]);
 
-    SignBlock(*pblock, stakeInput.txout.scriptPubKey, *keystore); // required to pass PoS checks
+    SignBlock(block, stakeInput.txout.scriptPubKey, *keystore); // required to pass PoS checks
+
+    int64_t nTime1 = GetTimeMicros();
 
     if (!disableValidationChecks) {
         LOCK(cs_main);
         if (pindexPrev != chainActive.Tip())
             return nullptr;
         CValidationState state;
-        if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false))
+        if (!TestBlockValidity(state, chainparams, block, pindexPrev, false, false))
             throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
     }
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCH, "Staking - packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    LogPrint(BCLog::BENCH, "Staking - coinstake: %.2fms, validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
-    return std::move(pblocktemplate);
+    return blocktemplate;
 }
 
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
@@ -466,6 +488,16 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, std::ve
     std::sort(sortedEntries.begin(), sortedEntries.end(), CompareTxIterByAncestorCount());
 }
 
+static CTxMemPool::txiter ToTxIter(CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator it) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs)
+{
+    return mempool.mapTx.project<0>(it);
+}
+
+static CTxMemPool::txiter ToTxIter(std::vector<CTxMemPool::txiter>::const_iterator it)
+{
+    return *it;
+}
+
 // This transaction selection algorithm orders the mempool based
 // on feerate of a transaction including all unconfirmed ancestors.
 // Since we don't remove transactions from the mempool as we select them
@@ -476,20 +508,100 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, std::ve
 // Each time through the loop, we compare the best transaction in
 // mapModifiedTxs with the next transaction in the mempool to decide what
 // transaction package to work on next.
+//
+// The selection is kept in the mempool's block candidate. If the block was not
+// full, the next template on the same tip starts with the transactions still
+// selected and only walks the transactions added to the mempool since,
+// instead of the whole mempool.
 void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated)
 {
     // mapModifiedTx will store sorted packages after they are modified
     // because some of their txs are already in the block
     indexed_modified_transaction_set mapModifiedTx;
-    // Keep track of entries that failed inclusion, to avoid duplicate work
-    CTxMemPool::setEntries failedTx;
 
-    // Start by adding all descendants of previously added txs to mapModifiedTx
-    // and modifying them for their already included ancestors
-    UpdatePackagesForAdded(inBlock, mapModifiedTx);
+    CTxMemPool::BlockCandidate& candidate = mempool.blockCandidate;
+    const uint256 hashPrevBlock = chainActive.Tip()->GetBlockHash();
+    bool fFull;
+    if (candidate.fValid && inBlock.empty() && candidate.hashPrevBlock == hashPrevBlock &&
+            candidate.nBlockMaxWeight == nBlockMaxWeight && candidate.blockMinFeeRate == blockMinFeeRate &&
+            candidate.fIncludeWitness == fIncludeWitness && (!candidate.fFull || candidate.vAdded.empty())) {
+        // A full block is selected again when transactions were added, they
+        // may displace selected ones
+        std::vector<CTxMemPool::txiter> added;
+        addCandidateTxs(candidate, added, mapModifiedTx);
+        fFull = !selectPackages(added.cbegin(), added.cend(), mapModifiedTx, nPackagesSelected, nDescendantsUpdated) || candidate.fFull;
+    } else {
+        // Start by adding all descendants of previously added txs to mapModifiedTx
+        // and modifying them for their already included ancestors
+        UpdatePackagesForAdded(inBlock, mapModifiedTx);
 
-    CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi = mempool.mapTx.get<ancestor_score>().begin();
-    CTxMemPool::txiter iter;
+        fFull = !selectPackages(mempool.mapTx.get<ancestor_score>().begin(), mempool.mapTx.get<ancestor_score>().end(),
+                                mapModifiedTx, nPackagesSelected, nDescendantsUpdated);
+    }
+
+    // The selected transactions are the last ones of the block
+    candidate.fValid = true;
+    candidate.hashPrevBlock = hashPrevBlock;
+    candidate.nBlockMaxWeight = nBlockMaxWeight;
+    candidate.blockMinFeeRate = blockMinFeeRate;
+    candidate.fIncludeWitness = fIncludeWitness;
+    candidate.fFull = fFull;
+    candidate.vSelected.clear();
+    for (auto it = pblock->vtx.end() - nBlockTx; it != pblock->vtx.end(); ++it) {
+        candidate.vSelected.push_back((*it)->GetHash());
+    }
+    candidate.vAdded.clear();
+}
+
+void BlockAssembler::addCandidateTxs(const CTxMemPool::BlockCandidate& candidate, std::vector<CTxMemPool::txiter>& added,
+                                     indexed_modified_transaction_set &mapModifiedTx)
+{
+    // The transactions still selected fit, and their in-mempool ancestors
+    // precede them: removing a transaction removes its descendants.
+    for (const uint256& hash : candidate.vSelected) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it != mempool.mapTx.end()) {
+            AddToBlock(it);
+        }
+    }
+
+    // The ancestor state of the added transactions is modified for their
+    // ancestors in the block, like UpdatePackagesForAdded does
+    uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::string dummy;
+    for (const uint256& hash : candidate.vAdded) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end() || inBlock.count(it) || mapModifiedTx.count(it))
+            continue;
+        CTxMemPool::setEntries ancestors;
+        mempool.CalculateMemPoolAncestors(*it, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+        CTxMemPoolModifiedEntry modEntry(it);
+        bool fModified = false;
+        for (CTxMemPool::txiter ancestor : ancestors) {
+            if (!inBlock.count(ancestor))
+                continue;
+            modEntry.nSizeWithAncestors -= ancestor->GetTxSize();
+            modEntry.nModFeesWithAncestors -= ancestor->GetModifiedFee();
+            modEntry.nSigOpCostWithAncestors -= ancestor->GetSigOpCost();
+            fModified = true;
+        }
+        if (fModified) {
+            mapModifiedTx.insert(modEntry);
+        } else {
+            added.push_back(it);
+        }
+    }
+    std::sort(added.begin(), added.end(), [](CTxMemPool::txiter a, CTxMemPool::txiter b) {
+        return CompareTxMemPoolEntryByAncestorFee()(*a, *b);
+    });
+}
+
+template <typename Iterator>
+bool BlockAssembler::selectPackages(Iterator mi, Iterator end, indexed_modified_transaction_set &mapModifiedTx,
+                                    int &nPackagesSelected, int &nDescendantsUpdated)
+{
+    // Keep track of entries that failed inclusion, to avoid duplicate work
+    CTxMemPool::setEntries failedTx;
 
     // Limit the number of attempts to add transactions to the block when it is
     // close to full; this is just a simple heuristic to finish quickly if the
@@ -497,11 +609,13 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
     int64_t nConsecutiveFailed = 0;
 
-    while (mi != mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty())
+    CTxMemPool::txiter iter;
+    bool fAllFit = true;
+
+    while (mi != end || !mapModifiedTx.empty())
     {
         // First try to find a new transaction in mapTx to evaluate.
-        if (mi != mempool.mapTx.get<ancestor_score>().end() &&
-                SkipMapTxEntry(mempool.mapTx.project<0>(mi), mapModifiedTx, failedTx)) {
+        if (mi != end && SkipMapTxEntry(ToTxIter(mi), mapModifiedTx, failedTx)) {
             ++mi;
             continue;
         }
@@ -511,13 +625,13 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         bool fUsingModified = false;
 
         modtxscoreiter modit = mapModifiedTx.get<ancestor_score>().begin();
-        if (mi == mempool.mapTx.get<ancestor_score>().end()) {
+        if (mi == end) {
             // We're out of entries in mapTx; use the entry from mapModifiedTx
             iter = modit->iter;
             fUsingModified = true;
         } else {
             // Try to compare the mapTx entry to the mapModifiedTx entry
-            iter = mempool.mapTx.project<0>(mi);
+            iter = ToTxIter(mi);
             if (modit != mapModifiedTx.get<ancestor_score>().end() &&
                     CompareTxMemPoolEntryByAncestorFee()(*modit, CTxMemPoolModifiedEntry(iter))) {
                 // The best entry in mapModifiedTx has higher score
@@ -547,10 +661,11 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
 
         if (packageFees < blockMinFeeRate.GetFee(packageSize)) {
             // Everything else we might consider has a lower fee rate
-            return;
+            return fAllFit;
         }
 
         if (!TestPackage(packageSize, packageSigOpsCost)) {
+            fAllFit = false;
             if (fUsingModified) {
                 // Since we always look at the best entry in mapModifiedTx,
                 // we must erase failed entries so that we can consider the
@@ -604,6 +719,7 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         // Update transactions that depend on each of these
         nDescendantsUpdated += UpdatePackagesForAdded(ancestors, mapModifiedTx);
     }
+    return fAllFit;
 }
 
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
@@ -624,3 +740,70 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
+
+void StakeTemplateCache::Refresh()
+{
+    const CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    if (!tip)
+        return;
+
+    LOCK(mu);
+    if (assembler && assembler->PreparedTipPoS() == tip && !stale && !outdated)
+        return;
+    // Changes from here on are picked up by the next refresh
+    stale = false;
+    outdated = false;
+    try {
+        std::unique_ptr<BlockAssembler> next(new BlockAssembler(chainparams));
+        next->PrepareBlockPoS();
+        assembler = std::move(next);
+    } catch (std::exception & e) {
+        LogPrintf("%s: Failed to prepare a stake block: %s\n", __func__, e.what());
+        assembler.reset();
+    }
+}
+
+std::unique_ptr<CBlockTemplate> StakeTemplateCache::CreateBlock(const CInputCoin & stakeInput, const uint256 & stakeBlockHash,
+                                                                const int64_t & stakeTime, CWallet *keystore)
+{
+    LOCK(mu);
+    if (!assembler || stale)
+        return nullptr;
+    {
+        LOCK(cs_main);
+        if (assembler->PreparedTipPoS() != chainActive.Tip())
+            return nullptr;
+    }
+    try {
+        return assembler->FinishBlockPoS(stakeInput, stakeBlockHash, stakeTime, keystore);
+    } catch (std::exception & e) {
+        // The mempool notifications are queued, a transaction of the block
+        // may have been removed from the mempool in the meantime
+        LogPrint(BCLog::BENCH, "%s: Prepared stake block is invalid: %s\n", __func__, e.what());
+        stale = true;
+        return nullptr;
+    }
+}
+
+void StakeTemplateCache::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    stale = true;
+    // Prepare the block on the new tip right away, the staker looks for a
+    // stake on it next
+    if (!fInitialDownload)
+        Refresh();
+}
+
+void StakeTemplateCache::TransactionAddedToMempool(const CTransactionRef &ptxn)
+{
+    outdated = true;
+}
+
+void StakeTemplateCache::TransactionRemovedFromMempool(const CTransactionRef &ptx)
+{
+    stale = true;
+}
@@ -8,10 +8,13 @@
 
 #include <optional.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
 #include <validation.h>
+#include <validationinterface.h>
 #include <wallet/wallet.h>
 
+#include <atomic>
 #include <memory>
 #include <stdint.h>
 
@@ -149,6 +152,10 @@ private:
     int64_t nLockTimeCutoff;
     const CChainParams& chainparams;
 
+    // The PoS block prepared by PrepareBlockPoS
+    CBlockIndex* pindexPrevPoS{nullptr};
+    std::vector<CTxOut> superblockPayees;
+
 public:
     struct Options {
         Options();
@@ -166,6 +173,18 @@ public:
                                                       const int64_t & stakeTime, CWallet *keystore,
                                                       const bool & disableValidationChecks = false);
 
+    /** Select the transactions and superblock payees of a PoS block on the tip.
+     *  The block is completed with a coinstake by FinishBlockPoS. */
+    void PrepareBlockPoS();
+    /** Complete a copy of the prepared PoS block with the coinstake of the stake
+     *  input and sign it. The prepared block can be completed again with another
+     *  stake. Returns null if the tip changed since the block was prepared. */
+    std::unique_ptr<CBlockTemplate> FinishBlockPoS(const CInputCoin & stakeInput, const uint256 & stakeBlockHash,
+                                                   const int64_t & stakeTime, CWallet *keystore,
+                                                   const bool & disableValidationChecks = false) const;
+    /** The tip the PoS block was prepared on, null if none was prepared */
+    const CBlockIndex* PreparedTipPoS() const { return pindexPrevPoS; }
+
     static Optional<int64_t> m_last_block_num_txs;
     static Optional<int64_t> m_last_block_weight;
 
@@ -179,10 +198,24 @@ private:
     // Methods for how to add transactions to a block.
     /** Add transactions based on feerate including unconfirmed ancestors
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
-      * statistics from the package selection (for logging statistics). */
-    void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+      * statistics from the package selection (for logging statistics).
+      * Reuses the mempool's block candidate when it was selected on the same
+      * tip with the same options, and stores the selection in it. */
+    void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(cs_main, mempool.cs);
 
     // helper functions for addPackageTxs()
+    /** Add the transactions of the block candidate still in the mempool to the
+      * block, and collect the transactions added to the mempool since in
+      * ancestor feerate order, or in mapModifiedTx if they have ancestors in
+      * the block */
+    void addCandidateTxs(const CTxMemPool::BlockCandidate& candidate, std::vector<CTxMemPool::txiter>& added,
+                         indexed_modified_transaction_set &mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** Select packages from the entries in [mi, end), sorted by ancestor
+      * feerate, and from mapModifiedTx. Returns false if a package did not fit
+      * in the block */
+    template <typename Iterator>
+    bool selectPackages(Iterator mi, Iterator end, indexed_modified_transaction_set &mapModifiedTx,
+                        int &nPackagesSelected, int &nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
     /** Remove confirmed (inBlock) entries from given set */
     void onlyUnconfirmed(CTxMemPool::setEntries& testSet);
     /** Test if a new package would "fit" in the block */
@@ -203,6 +236,40 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
 };
 
+/**
+ * Keeps a PoS block prepared on the tip so that the staker only adds the
+ * coinstake and signs the block when it finds a stake. The block is prepared
+ * again when the tip changes and, at most once per Refresh call, when the
+ * mempool changes.
+ */
+class StakeTemplateCache final : public CValidationInterface
+{
+private:
+    const CChainParams& chainparams;
+    Mutex mu;
+    std::unique_ptr<BlockAssembler> assembler GUARDED_BY(mu);
+    //! Transactions were added to the mempool since the block was prepared
+    std::atomic<bool> outdated{true};
+    //! The block may spend transactions that left the mempool, or build on an old tip
+    std::atomic<bool> stale{true};
+
+public:
+    explicit StakeTemplateCache(const CChainParams& params) : chainparams(params) {}
+
+    /** Prepare the block again if the tip or the mempool changed. */
+    void Refresh();
+
+    /** Complete the prepared block with a stake. Returns null if there is no
+     *  valid block prepared on the tip, the caller then assembles the block. */
+    std::unique_ptr<CBlockTemplate> CreateBlock(const CInputCoin & stakeInput, const uint256 & stakeBlockHash,
+                                                const int64_t & stakeTime, CWallet *keystore);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    void TransactionAddedToMempool(const CTransactionRef &ptxn) override;
+    void TransactionRemovedFromMempool(const CTransactionRef &ptx) override;
+};
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
@@ -17,6 +17,7 @@
 #include <crypto/sha256.h>
 #include <primitives/transaction.h>
 #include <netbase.h>
+#include <peertaskqueue.h>
 #include <scheduler.h>
 #include <ui_interface.h>
 #include <util/strencodings.h>
@@ -31,6 +32,11 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -70,6 +76,19 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+#ifndef WIN32
+/** Maximum number of buffers sent with one sendmsg */
+static const int MAX_SEND_IOV = 64;
+#endif
+
+#ifdef USE_EPOLL
+/** Maximum number of socket events returned by one epoll_wait */
+static const int MAX_EPOLL_EVENTS = 1024;
+/** Maximum time the epoll socket handler waits for events. Disconnects and
+ *  the inactivity check of all nodes wait for the next round. */
+static const int EPOLL_TIMEOUT_MILLISECONDS = 1000;
+#endif
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -694,27 +713,57 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
         int nBytes = 0;
+        size_t nRequested = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            const auto &data = **it;
+            nRequested = data.size() - pnode->nSendOffset;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, nRequested, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Send the queued buffers with one call, the headers and payloads
+            // of the messages are not copied together
+            struct iovec iov[MAX_SEND_IOV];
+            int nIov = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto it_iov = it; it_iov != pnode->vSendMsg.end() && nIov < MAX_SEND_IOV; ++it_iov) {
+                const auto &data = **it_iov;
+                iov[nIov].iov_base = const_cast<unsigned char*>(data.data()) + nOffset;
+                iov[nIov].iov_len = data.size() - nOffset;
+                nRequested += iov[nIov].iov_len;
+                nOffset = 0;
+                nIov++;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Drop the buffers that were sent
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                const size_t nSize = (*it)->size();
+                if (nLeft < nSize - pnode->nSendOffset) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nSize - pnode->nSendOffset;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                pnode->nSendSize -= nSize;
                 pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            if ((size_t)nBytes < nRequested) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -970,6 +1019,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     {
         LOCK(cs_vNodes);
+        RegisterSocketEvents(pnode);
         vNodes.push_back(pnode);
     }
 }
@@ -997,6 +1047,7 @@ void CConnman::DisconnectNodes()
             {
                 // remove from vNodes
                 vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+                UnregisterSocketEvents(pnode);
 
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
@@ -1247,9 +1298,101 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    // Don't wait if a socket that was not drained can be read. Reads that
+    // were deferred for a full receive queue get no event when it empties.
+    int timeout = EPOLL_TIMEOUT_MILLISECONDS;
+    if (m_epoll_more)
+        timeout = 0;
+    else if (!m_epoll_recv_ready.empty())
+        timeout = SELECT_TIMEOUT_MILLISECONDS;
+    m_epoll_more = false;
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    const int nEvents = epoll_wait(m_epoll_fd, events, MAX_EPOLL_EVENTS, timeout);
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        if (errno != EINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        const SOCKET hSocket = events[i].data.fd;
+        const uint32_t flags = events[i].events;
+        if (events[i].data.fd == m_epoll_wakeup_fd) {
+            uint64_t count;
+            if (read(m_epoll_wakeup_fd, &count, sizeof(count)) != sizeof(count)) {
+                LogPrint(BCLog::NET, "socket handler wakeup read error %s\n", NetworkErrorString(errno));
+            }
+            continue;
+        }
+        if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+            recv_set.insert(hSocket);
+            // Listening sockets are level-triggered
+            if (std::none_of(vhListenSocket.begin(), vhListenSocket.end(),
+                             [hSocket](const ListenSocket& l) { return l.socket == hSocket; })) {
+                m_epoll_recv_ready.insert(hSocket);
+            }
+        }
+        if (flags & EPOLLOUT) send_set.insert(hSocket);
+        if (flags & (EPOLLERR | EPOLLHUP)) error_set.insert(hSocket);
+    }
+
+    // Node sockets that were not drained are read again, pending data is
+    // sent again. Sends queued by other threads start with an optimistic
+    // send, whatever it leaves raises an event once the socket is writable.
+    recv_set.insert(m_epoll_recv_ready.begin(), m_epoll_recv_ready.end());
+    send_set.insert(m_epoll_send_pending.begin(), m_epoll_send_pending.end());
+}
+#endif
+
+void CConnman::RegisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    if (m_epoll_fd == -1) return;
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET) return;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = pnode->hSocket;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("Failed to register socket of peer=%d for events: %s\n", pnode->GetId(), NetworkErrorString(errno));
+        pnode->fDisconnect = true;
+        return;
+    }
+    // The descriptor of a closed socket may have been reused
+    m_epoll_nodes[pnode->hSocket] = pnode;
+#endif
+}
+
+void CConnman::UnregisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    // The socket is closed already, its registration went with it
+    for (auto it = m_epoll_nodes.begin(); it != m_epoll_nodes.end(); ) {
+        if (it->second == pnode)
+            it = m_epoll_nodes.erase(it);
+        else
+            ++it;
+    }
+#endif
+}
+
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
+#ifdef USE_EPOLL
+    if (m_epoll_fd != -1) {
+        SocketEventsEPoll(recv_set, send_set, error_set);
+    } else
+#endif
     SocketEvents(recv_set, send_set, error_set);
 
     if (interruptNet) return;
@@ -1271,10 +1414,31 @@ void CConnman::SocketHandler()
     std::vector<CNode*> vNodesCopy;
     {
         LOCK(cs_vNodes);
+#ifdef USE_EPOLL
+        // Only the nodes of sockets with events are serviced, all nodes are
+        // visited for the inactivity check once per epoll timeout
+        const int64_t nNow = GetTimeMillis();
+        if (m_epoll_fd != -1 && nNow - m_epoll_inactivity_check < EPOLL_TIMEOUT_MILLISECONDS) {
+            std::set<SOCKET> sockets(recv_set);
+            sockets.insert(send_set.begin(), send_set.end());
+            sockets.insert(error_set.begin(), error_set.end());
+            for (SOCKET hSocket : sockets) {
+                const auto it = m_epoll_nodes.find(hSocket);
+                if (it != m_epoll_nodes.end())
+                    vNodesCopy.push_back(it->second);
+            }
+        } else {
+            m_epoll_inactivity_check = nNow;
+            vNodesCopy = vNodes;
+        }
+#else
         vNodesCopy = vNodes;
+#endif
         for (CNode* pnode : vNodesCopy)
             pnode->AddRef();
     }
+    // Edge-triggered sockets that stay readable or have data to send after this round
+    std::set<SOCKET> recv_ready, send_pending;
     for (CNode* pnode : vNodesCopy)
     {
         if (interruptNet)
@@ -1286,13 +1450,31 @@ void CConnman::SocketHandler()
         bool recvSet = false;
         bool sendSet = false;
         bool errorSet = false;
+        SOCKET hSocket;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            recvSet = recv_set.count(pnode->hSocket) > 0;
-            sendSet = send_set.count(pnode->hSocket) > 0;
-            errorSet = error_set.count(pnode->hSocket) > 0;
+            hSocket = pnode->hSocket;
+            recvSet = recv_set.count(hSocket) > 0;
+            sendSet = send_set.count(hSocket) > 0;
+            errorSet = error_set.count(hSocket) > 0;
+        }
+        // A readable edge-triggered socket is read when the select set
+        // would include it: the send buffer is drained first, and the
+        // receive queue must have room. It stays ready until drained.
+        bool fRecvDeferred = false;
+        if (m_epoll_fd != -1 && recvSet && !errorSet) {
+            bool fSendPending;
+            {
+                LOCK(pnode->cs_vSend);
+                fSendPending = !pnode->vSendMsg.empty();
+            }
+            if (fSendPending || pnode->fPauseRecv) {
+                recvSet = false;
+                fRecvDeferred = true;
+                recv_ready.insert(hSocket);
+            }
         }
         if (recvSet || errorSet)
         {
@@ -1305,6 +1487,11 @@ void CConnman::SocketHandler()
                     continue;
                 nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
             }
+            if (m_epoll_fd != -1 && nBytes == (int)sizeof(pchBuf)) {
+                // The socket may have more data
+                recv_ready.insert(hSocket);
+                m_epoll_more = true;
+            }
             if (nBytes > 0)
             {
                 bool notify = false;
@@ -1359,10 +1546,20 @@ void CConnman::SocketHandler()
             if (nBytes) {
                 RecordBytesSent(nBytes);
             }
+            // Receive next round without waiting for events
+            if (fRecvDeferred && pnode->vSendMsg.empty() && !pnode->fPauseRecv) {
+                m_epoll_more = true;
+            }
+            if (m_epoll_fd != -1 && !pnode->vSendMsg.empty()) {
+                send_pending.insert(hSocket);
+            }
         }
 
         InactivityCheck(pnode);
     }
+    // Sockets of disconnected nodes are dropped, their descriptors may be reused
+    m_epoll_recv_ready.swap(recv_ready);
+    m_epoll_send_pending.swap(send_pending);
     {
         LOCK(cs_vNodes);
         for (CNode* pnode : vNodesCopy)
@@ -1942,6 +2139,7 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     m_msgproc->InitializeNode(pnode);
     {
         LOCK(cs_vNodes);
+        RegisterSocketEvents(pnode);
         vNodes.push_back(pnode);
     }
 }
@@ -2202,6 +2400,37 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (m_use_epoll) {
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll_fd == -1) {
+            LogPrintf("Failed to create epoll instance, polling sockets instead: %s\n", NetworkErrorString(errno));
+        }
+        if (m_epoll_fd != -1) {
+            m_epoll_wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = m_epoll_wakeup_fd;
+            if (m_epoll_wakeup_fd == -1 || epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_epoll_wakeup_fd, &event) != 0) {
+                LogPrintf("Failed to create socket handler wakeup event, polling sockets instead: %s\n", NetworkErrorString(errno));
+                close(m_epoll_fd);
+                m_epoll_fd = -1;
+            }
+        }
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (m_epoll_fd == -1) break;
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = hListenSocket.socket;
+            if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0) {
+                LogPrintf("Failed to register listening socket, polling sockets instead: %s\n", NetworkErrorString(errno));
+                close(m_epoll_fd);
+                m_epoll_fd = -1;
+            }
+        }
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2271,6 +2500,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this, connOptions.m_specified_outgoing)));
 
     // Process messages
+    if (nMsgHandlerThreads > 0) {
+        m_msg_workers = MakeUnique<PeerTaskQueue>(nMsgHandlerThreads, "msgworker");
+    }
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
     // Dump network addresses
@@ -2304,6 +2536,14 @@ void CConnman::Interrupt()
 
     interruptNet();
     InterruptSocks5(true);
+#ifdef USE_EPOLL
+    if (m_epoll_wakeup_fd != -1) {
+        const uint64_t count = 1;
+        if (write(m_epoll_wakeup_fd, &count, sizeof(count)) != sizeof(count)) {
+            LogPrint(BCLog::NET, "socket handler wakeup write error %s\n", NetworkErrorString(errno));
+        }
+    }
+#endif
 
     if (semOutbound) {
         for (int i=0; i<(nMaxOutbound + nMaxFeeler); i++) {
@@ -2322,6 +2562,11 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    // The queued tasks hold references to the nodes deleted below
+    if (m_msg_workers) {
+        m_msg_workers->Stop();
+        m_msg_workers.reset();
+    }
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2355,6 +2600,22 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+    if (m_epoll_wakeup_fd != -1) {
+        close(m_epoll_wakeup_fd);
+        m_epoll_wakeup_fd = -1;
+    }
+#endif
+    {
+        LOCK(cs_vNodes);
+        m_epoll_nodes.clear();
+    }
+    m_epoll_recv_ready.clear();
+    m_epoll_send_pending.clear();
     semOutbound.reset();
     semAddnode.reset();
 }
@@ -2691,11 +2952,9 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+CSharedNetMsg CConnman::ShareMessage(CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
+    const size_t nMessageSize = msg.data.size();
 
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
@@ -2705,6 +2964,24 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
 
+    CSharedNetMsg shared;
+    shared.header = std::make_shared<const std::vector<unsigned char>>(std::move(serializedHeader));
+    shared.data = std::make_shared<const std::vector<unsigned char>>(std::move(msg.data));
+    shared.command = std::move(msg.command);
+    return shared;
+}
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    PushMessage(pnode, ShareMessage(std::move(msg)));
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSharedNetMsg& msg)
+{
+    size_t nMessageSize = msg.data->size();
+    size_t nTotalSize = nMessageSize + msg.header->size();
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
+
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
@@ -2716,9 +2993,9 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
+        pnode->vSendMsg.push_back(msg.header);
         if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+            pnode->vSendMsg.push_back(msg.data);
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
@@ -2728,6 +3005,16 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         RecordBytesSent(nBytesSent);
 }
 
+bool CConnman::QueueMessageTask(CNode* pnode, std::function<void()> task)
+{
+    if (!m_msg_workers) {
+        return false;
+    }
+    // The node is not deleted while the task is queued or running
+    std::shared_ptr<CNode> node(pnode->AddRef(), [](CNode* p) { p->Release(); });
+    return m_msg_workers->Add(pnode->GetId(), [node, task] { task(); });
+}
+
 bool CConnman::ForNode(NodeId id, std::function<bool(CNode* pnode)> func)
 {
     CNode* found = nullptr;
@@ -2823,6 +3110,7 @@ CNode* CConnman::OpenXRouterConnection(const CAddress & addrConnect, const char
     m_msgproc->InitializeNode(pnode);
     {
         LOCK(cs_vNodes);
+        RegisterSocketEvents(pnode);
         vNodes.push_back(pnode);
     }
 
@@ -38,6 +38,7 @@
 class CScheduler;
 class CNode;
 class BanMan;
+class PeerTaskQueue;
 
 /** Time between pings automatically sent out for latency probing and keepalive (in seconds). */
 static const int PING_INTERVAL = 2 * 60;
@@ -82,6 +83,23 @@ static const bool DEFAULT_BLOCKSONLY = false;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 
+/** Default for -msghandlerthreads, the threads processing service node, XBridge and XRouter messages */
+static const int DEFAULT_MSGHANDLER_THREADS = 2;
+static const int MAX_MSGHANDLER_THREADS = 16;
+
+/** -socketevents modes: epoll where available, else poll or select */
+static const char* const SOCKETEVENTS_EPOLL = "epoll";
+#ifdef USE_POLL
+static const char* const SOCKETEVENTS_WAIT = "poll";
+#else
+static const char* const SOCKETEVENTS_WAIT = "select";
+#endif
+#ifdef USE_EPOLL
+static const char* const DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#else
+static const char* const DEFAULT_SOCKETEVENTS = SOCKETEVENTS_WAIT;
+#endif
+
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
@@ -112,6 +130,19 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/**
+ * A serialized message with its header, immutable and shared by the send
+ * queues of the peers it is pushed to. A message relayed to many peers is
+ * serialized and hashed once, and its buffers are not copied per peer.
+ */
+struct CSharedNetMsg
+{
+    std::shared_ptr<const std::vector<unsigned char>> header;
+    std::shared_ptr<const std::vector<unsigned char>> data;
+    std::string command;
+
+    bool IsNull() const { return !header; }
+};
 
 class NetEventsInterface;
 class CConnman
@@ -141,6 +172,8 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        int nMsgHandlerThreads = 0;
+        bool m_use_epoll = false;
         std::vector<std::string> vSeedNodes;
         std::vector<CSubNet> vWhitelistedRange;
         std::vector<CService> vBinds, vWhiteBinds;
@@ -163,6 +196,8 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        nMsgHandlerThreads = connOptions.nMsgHandlerThreads;
+        m_use_epoll = connOptions.m_use_epoll;
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -201,6 +236,16 @@ public:
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, const CSharedNetMsg& msg);
+
+    /** Add the header to a serialized message to push it to several peers */
+    static CSharedNetMsg ShareMessage(CSerializedNetMsg&& msg);
+
+    /** Run a message processing task of a node on the message handler
+     *  workers instead of the message handler thread. The tasks of a node run
+     *  in the order they were queued and hold a reference to it. Returns
+     *  false if there are no workers. */
+    bool QueueMessageTask(CNode* pnode, std::function<void()> task);
 
     template<typename Callable>
     void ForEachNode(Callable&& func)
@@ -342,6 +387,14 @@ private:
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_EPOLL
+    void SocketEventsEPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
+    /** Register the socket of a new node for socket events, before adding
+     *  it to vNodes */
+    void RegisterSocketEvents(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
+    /** Forget the socket of a node removed from vNodes */
+    void UnregisterSocketEvents(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -440,6 +493,29 @@ private:
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
 
+    int nMsgHandlerThreads{0};
+    std::unique_ptr<PeerTaskQueue> m_msg_workers;
+
+    bool m_use_epoll{false};
+    /** The epoll instance of the socket handler, -1 if sockets are polled.
+     *  Sockets are registered once, edge-triggered. */
+    int m_epoll_fd{-1};
+    /** Event descriptor that wakes the epoll socket handler on interrupt */
+    int m_epoll_wakeup_fd{-1};
+    /** Nodes by the socket registered for them, the epoll socket handler
+     *  only services the nodes of sockets with events */
+    std::map<SOCKET, CNode*> m_epoll_nodes GUARDED_BY(cs_vNodes);
+    /** Node sockets that became readable and were not drained since, only
+     *  used by the socket handler thread */
+    std::set<SOCKET> m_epoll_recv_ready;
+    /** Node sockets the socket handler left data to send on, only used by
+     *  the socket handler thread */
+    std::set<SOCKET> m_epoll_send_pending;
+    /** Whether a ready socket can be read without waiting for events */
+    bool m_epoll_more{false};
+    /** Time of the last inactivity check of all nodes, in milliseconds */
+    int64_t m_epoll_inactivity_check{0};
+
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of nMaxOutbound
      *  This takes the place of a feeler connection */
@@ -639,7 +715,7 @@ public:
     size_t nSendSize{0}; // total size of all vSendMsg entries
     size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<std::shared_ptr<const std::vector<unsigned char>>> vSendMsg GUARDED_BY(cs_vSend);
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
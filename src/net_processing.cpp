@@ -12,9 +12,11 @@
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <hash.h>
+#include <index/blockfilterindex.h>
 #include <validation.h>
 #include <merkleblock.h>
 #include <netmessagemaker.h>
+#include <node/blockcache.h>
 #include <netbase.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -44,6 +46,8 @@
 static constexpr int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
 /** Minimum time between orphan transactions expire time checks in seconds */
 static constexpr int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
+/** Maximum number of orphan transactions accepted as one batch by ProcessOrphanTx */
+static constexpr size_t MAX_ORPHAN_TX_BATCH = 32;
 /** Headers download timeout expressed in microseconds
  *  Timeout = base + per_header * (expected number of headers) */
 static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_BASE = 15 * 60 * 1000000; // 15 minutes
@@ -95,6 +99,12 @@ static constexpr unsigned int INVENTORY_BROADCAST_MAX = 7 * INVENTORY_BROADCAST_
 static constexpr unsigned int AVG_FEEFILTER_BROADCAST_INTERVAL = 10 * 60;
 /** Maximum feefilter broadcast delay after significant change. */
 static constexpr unsigned int MAX_FEEFILTER_CHANGE_DELAY = 5 * 60;
+/** Maximum number of compact filters that may be requested with one getcfilters. See BIP 157. */
+static constexpr uint32_t MAX_GETCFILTERS_SIZE = 1000;
+/** Maximum number of cf hashes that may be requested with one getcfheaders. See BIP 157. */
+static constexpr uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+/** Interval between compact filter checkpoints. See BIP 157. */
+static constexpr int CFCHECKPT_INTERVAL = 1000;
 
 // Internal stuff
 namespace {
@@ -174,9 +184,6 @@ namespace {
     std::map<COutPoint, std::set<std::map<uint256, COrphanTx>::iterator, IteratorComparator>> mapOrphanTransactionsByPrev GUARDED_BY(g_cs_orphans);
 
     std::vector<std::map<uint256, COrphanTx>::iterator> g_orphan_list GUARDED_BY(g_cs_orphans); //! For random eviction
-
-    static size_t vExtraTxnForCompactIt GUARDED_BY(g_cs_orphans) = 0;
-    static std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(g_cs_orphans);
 } // namespace
 
 namespace {
@@ -682,15 +689,24 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
 // mapOrphanTransactions
 //
 
+static ExtraTxnPool& ExtraTxnForCompact() EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    static ExtraTxnPool pool(std::max<int64_t>(0, gArgs.GetArg("-blockreconstructionextratxn", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN)),
+                             std::max<int64_t>(0, gArgs.GetArg("-blockreconstructionextratxnsize", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN_SIZE)) * 1000000);
+    return pool;
+}
+
 static void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
-    size_t max_extra_txn = gArgs.GetArg("-blockreconstructionextratxn", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN);
-    if (max_extra_txn <= 0)
-        return;
-    if (!vExtraTxnForCompact.size())
-        vExtraTxnForCompact.resize(max_extra_txn);
-    vExtraTxnForCompact[vExtraTxnForCompactIt] = std::make_pair(tx->GetWitnessHash(), tx);
-    vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
+    ExtraTxnForCompact().Add(tx);
+}
+
+static void RecordCompactExtraTransactions(const uint256& hash, size_t txn_hit) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    ExtraTxnPool& pool = ExtraTxnForCompact();
+    pool.RecordBlock(txn_hit);
+    LogPrint(BCLog::CMPCTBLOCK, "Found %u txn of block %s in the extra pool of %u txn (%u bytes), %u of %u blocks used it\n",
+             txn_hit, hash.ToString(), pool.Count(), pool.Bytes(), pool.BlocksHit(), pool.Blocks());
 }
 
 bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
@@ -872,6 +888,18 @@ PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, BanMan* banman, CS
     scheduler.scheduleEvery(std::bind(&PeerLogicValidation::CheckForStaleTipAndEvictPeers, this, consensusParams), EXTRA_PEER_CHECK_INTERVAL * 1000);
 }
 
+/**
+ * Keep transactions evicted from the mempool or removed by a reorg for
+ * compact block reconstruction, other nodes may still mine them.
+ */
+void PeerLogicValidation::TransactionRemovedFromMempool(const CTransactionRef& ptx)
+{
+    if (RecursiveDynamicUsage(*ptx) < 100000) {
+        LOCK(g_cs_orphans);
+        AddToCompactExtraTransactions(ptx);
+    }
+}
+
 /**
  * Evict orphan txn pool entries (EraseOrphanTx) based on a newly connected
  * block. Also save the time of the last tip update.
@@ -915,6 +943,39 @@ static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_bloc
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
 
+/** The serializations of the most recent block that are shared between peers */
+enum RecentBlockMsg {
+    RECENT_BLOCK,
+    RECENT_BLOCK_NO_WITNESS,
+    RECENT_BLOCK_LEGACY,
+    RECENT_CMPCTBLOCK,
+    RECENT_CMPCTBLOCK_NO_WITNESS,
+    //! A compact block with short txids, for peers that don't want witnesses
+    RECENT_CMPCTBLOCK_TXID,
+    RECENT_BLOCK_MSG_COUNT
+};
+static CSharedNetMsg most_recent_block_msgs[RECENT_BLOCK_MSG_COUNT] GUARDED_BY(cs_most_recent_block);
+
+/**
+ * Return a message for the block with the given hash, serialized by make. If
+ * it is the most recent block the message is serialized once and the same
+ * buffers are sent to every peer that asks for it.
+ */
+static CSharedNetMsg GetRecentBlockMsg(const uint256& hash, RecentBlockMsg type, const std::function<CSerializedNetMsg()>& make)
+{
+    {
+        LOCK(cs_most_recent_block);
+        if (most_recent_block_hash == hash && !most_recent_block_msgs[type].IsNull())
+            return most_recent_block_msgs[type];
+    }
+    // Serialize without the lock, blocks can be large
+    CSharedNetMsg msg = CConnman::ShareMessage(make());
+    LOCK(cs_most_recent_block);
+    if (most_recent_block_hash == hash)
+        most_recent_block_msgs[type] = msg;
+    return msg;
+}
+
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
@@ -939,12 +1000,14 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         most_recent_block = pblock;
         most_recent_compact_block = pcmpctblock;
         fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
+        for (CSharedNetMsg& msg : most_recent_block_msgs)
+            msg = CSharedNetMsg();
     }
 
-    connman->ForEachNode([this, &pcmpctblock, &pblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
+    CSharedNetMsg cmpctblock_msg;
+    connman->ForEachNode([this, &pcmpctblock, &pblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock, &cmpctblock_msg](CNode* pnode) {
         AssertLockHeld(cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -956,7 +1019,12 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            if (cmpctblock_msg.IsNull()) {
+                cmpctblock_msg = GetRecentBlockMsg(hashBlock, RECENT_CMPCTBLOCK, [&] {
+                    return msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock);
+                });
+            }
+            connman->PushMessage(pnode, cmpctblock_msg);
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1195,14 +1263,15 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         std::shared_ptr<const CBlock> pblock;
         if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
-        } else if (inv.type == MSG_WITNESS_BLOCK) {
-            // Fast-path: in this case it is possible to serve the block directly from disk,
-            // as the network format matches the format on disk
-            std::vector<uint8_t> block_data;
-            if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
+        } else if (inv.type == MSG_WITNESS_BLOCK || (inv.type == MSG_BLOCK && pfrom->nVersion > LEGACY_PROTOCOL_VERSION)) {
+            // Fast-path: serve the serialized block from the block cache, a
+            // witness block is copied from disk as the network format matches
+            // the format on disk
+            const CSharedNetMsg msg = GetBlockMsg(pindex, inv.type == MSG_WITNESS_BLOCK, chainparams);
+            if (msg.IsNull()) {
                 assert(!"cannot load block from disk");
             }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
+            connman->PushMessage(pfrom, msg);
             // Don't set pblock as we've sent the block
         } else {
             // Send block from disk
@@ -1212,14 +1281,30 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
             pblock = pblockRead;
         }
         if (pblock) {
+            // The most recent block is serialized once for all peers
+            const bool fRecentBlock = pblock == a_recent_block;
             if (inv.type == MSG_BLOCK) {
-                if (pfrom->nVersion <= LEGACY_PROTOCOL_VERSION) // support legacy nodes
-                    connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, CBlockLegacy(*pblock)));
+                if (pfrom->nVersion <= LEGACY_PROTOCOL_VERSION) { // support legacy nodes
+                    auto make = [&] { return msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, CBlockLegacy(*pblock)); };
+                    if (fRecentBlock)
+                        connman->PushMessage(pfrom, GetRecentBlockMsg(pindex->GetBlockHash(), RECENT_BLOCK_LEGACY, make));
+                    else
+                        connman->PushMessage(pfrom, make());
+                } else {
+                    auto make = [&] { return msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock); };
+                    if (fRecentBlock)
+                        connman->PushMessage(pfrom, GetRecentBlockMsg(pindex->GetBlockHash(), RECENT_BLOCK_NO_WITNESS, make));
+                    else
+                        connman->PushMessage(pfrom, make());
+                }
+            }
+            else if (inv.type == MSG_WITNESS_BLOCK) {
+                auto make = [&] { return msgMaker.Make(NetMsgType::BLOCK, *pblock); };
+                if (fRecentBlock)
+                    connman->PushMessage(pfrom, GetRecentBlockMsg(pindex->GetBlockHash(), RECENT_BLOCK, make));
                 else
-                    connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
+                    connman->PushMessage(pfrom, make());
             }
-            else if (inv.type == MSG_WITNESS_BLOCK)
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
             else if (inv.type == MSG_FILTERED_BLOCK)
             {
                 bool sendMerkleBlock = false;
@@ -1256,7 +1341,14 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
                 int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
                 if (CanDirectFetch(consensusParams) && pindex->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
                     if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                        connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+                        connman->PushMessage(pfrom, GetRecentBlockMsg(pindex->GetBlockHash(), fPeerWantsWitness ? RECENT_CMPCTBLOCK : RECENT_CMPCTBLOCK_NO_WITNESS, [&] {
+                            return msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block);
+                        }));
+                    } else if (fRecentBlock) {
+                        connman->PushMessage(pfrom, GetRecentBlockMsg(pindex->GetBlockHash(), RECENT_CMPCTBLOCK_TXID, [&] {
+                            CBlockHeaderAndShortTxIDs cmpctblock(*pblock, fPeerWantsWitness);
+                            return msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock);
+                        }));
                     } else {
                         CBlockHeaderAndShortTxIDs cmpctblock(*pblock, fPeerWantsWitness);
                         connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
@@ -1369,6 +1461,201 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
     connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCKTXN, resp));
 }
 
+/**
+ * Validation logic for compact filters request handling.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ *
+ * @param[in]   pfrom           The peer that we received the request from
+ * @param[in]   chainparams     Chain parameters
+ * @param[in]   filter_type     The filter type the request is for. Must be basic filters.
+ * @param[in]   start_height    The start height for the request
+ * @param[in]   stop_hash       The stop_hash for the request
+ * @param[in]   max_height_diff The maximum number of items permitted to request, as specified in BIP 157
+ * @param[out]  stop_index      The CBlockIndex for the stop_hash block, if the request can be serviced.
+ * @param[out]  filter_index    The filter index, if the request can be serviced.
+ * @return                      True if the request can be serviced.
+ */
+static bool PrepareBlockFilterRequest(CNode* pfrom, const CChainParams& chainparams,
+                                      BlockFilterType filter_type, uint32_t start_height,
+                                      const uint256& stop_hash, uint32_t max_height_diff,
+                                      const CBlockIndex*& stop_index,
+                                      BlockFilterIndex*& filter_index)
+{
+    const bool supported_filter_type =
+        (filter_type == BlockFilterType::BASIC &&
+         (pfrom->GetLocalServices() & NODE_COMPACT_FILTERS));
+    if (!supported_filter_type) {
+        LogPrint(BCLog::NET, "peer %d requested unsupported block filter type: %d\n",
+                 pfrom->GetId(), static_cast<uint8_t>(filter_type));
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    {
+        LOCK(cs_main);
+        stop_index = LookupBlockIndex(stop_hash);
+
+        // Check that the stop block exists and the peer would be allowed to fetch it.
+        if (!stop_index || !BlockRequestAllowed(stop_index, chainparams.GetConsensus())) {
+            LogPrint(BCLog::NET, "peer %d requested invalid block hash: %s\n",
+                     pfrom->GetId(), stop_hash.ToString());
+            pfrom->fDisconnect = true;
+            return false;
+        }
+    }
+
+    uint32_t stop_height = stop_index->nHeight;
+    if (start_height > stop_height) {
+        LogPrint(BCLog::NET, "peer %d sent invalid getcfilters/getcfheaders with " /* Continued */
+                 "start height %d and stop height %d\n",
+                 pfrom->GetId(), start_height, stop_height);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (stop_height - start_height >= max_height_diff) {
+        LogPrint(BCLog::NET, "peer %d requested too many cfilters/cfheaders: %d / %d\n",
+                 pfrom->GetId(), stop_height - start_height + 1, max_height_diff);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    filter_index = g_blockfilterindex.get();
+    if (!filter_index || filter_index->GetFilterType() != filter_type) {
+        LogPrint(BCLog::NET, "Filter index for supported type %s not found\n", BlockFilterTypeName(filter_type));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Handle a cfilters request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFilters(CNode* pfrom, CDataStream& vRecv, const CChainParams& chainparams, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint32_t start_height;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> start_height >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, chainparams, filter_type, start_height, stop_hash,
+                                   MAX_GETCFILTERS_SIZE, stop_index, filter_index)) {
+        return;
+    }
+
+    std::vector<BlockFilter> filters;
+    if (!filter_index->LookupFilterRange(start_height, stop_index, filters)) {
+        LogPrint(BCLog::NET, "Failed to find block filter in index: filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filter_type), start_height, stop_hash.ToString());
+        return;
+    }
+
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    for (const auto& filter : filters) {
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CFILTER, filter));
+    }
+}
+
+/**
+ * Handle a cfheaders request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFHeaders(CNode* pfrom, CDataStream& vRecv, const CChainParams& chainparams, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint32_t start_height;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> start_height >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, chainparams, filter_type, start_height, stop_hash,
+                                   MAX_GETCFHEADERS_SIZE, stop_index, filter_index)) {
+        return;
+    }
+
+    uint256 prev_header;
+    if (start_height > 0) {
+        const CBlockIndex* const prev_block =
+            stop_index->GetAncestor(static_cast<int>(start_height - 1));
+        if (!filter_index->LookupFilterHeader(prev_block, prev_header)) {
+            LogPrint(BCLog::NET, "Failed to find block filter header in index: filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filter_type), prev_block->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    std::vector<uint256> filter_hashes;
+    if (!filter_index->LookupFilterHashRange(start_height, stop_index, filter_hashes)) {
+        LogPrint(BCLog::NET, "Failed to find block filter hashes in index: filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filter_type), start_height, stop_hash.ToString());
+        return;
+    }
+
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CFHEADERS,
+                                              filter_type_ser,
+                                              stop_index->GetBlockHash(),
+                                              prev_header,
+                                              filter_hashes));
+}
+
+/**
+ * Handle a getcfcheckpt request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFCheckPt(CNode* pfrom, CDataStream& vRecv, const CChainParams& chainparams, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, chainparams, filter_type, /*start_height=*/0, stop_hash,
+                                   /*max_height_diff=*/std::numeric_limits<uint32_t>::max(),
+                                   stop_index, filter_index)) {
+        return;
+    }
+
+    std::vector<uint256> headers(stop_index->nHeight / CFCHECKPT_INTERVAL);
+
+    // Populate headers.
+    const CBlockIndex* block_index = stop_index;
+    for (int i = headers.size() - 1; i >= 0; i--) {
+        int height = (i + 1) * CFCHECKPT_INTERVAL;
+        block_index = block_index->GetAncestor(height);
+
+        if (!filter_index->LookupFilterHeader(block_index, headers[i])) {
+            LogPrint(BCLog::NET, "Failed to find block filter header in index: filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filter_type), block_index->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CFCHECKPT,
+                                              filter_type_ser,
+                                              stop_index->GetBlockHash(),
+                                              headers));
+}
+
 bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::vector<CBlockHeader>& headers, const CChainParams& chainparams, bool punish_duplicate_invalid)
 {
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
@@ -1594,41 +1881,53 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
 {
     AssertLockHeld(cs_main);
     AssertLockHeld(g_cs_orphans);
-    std::set<NodeId> setMisbehaving;
-    bool done = false;
-    while (!done && !orphan_work_set.empty()) {
-        const uint256 orphanHash = *orphan_work_set.begin();
-        orphan_work_set.erase(orphan_work_set.begin());
 
-        auto orphan_it = mapOrphanTransactions.find(orphanHash);
+    // Up to MAX_ORPHAN_TX_BATCH orphans of the work set are accepted as one
+    // batch, so that their scripts are checked together while cs_main is held
+    // for a bounded time. The rest of the work set and the orphans the batch
+    // resolves are processed by the next calls.
+    std::vector<CTransactionRef> vOrphans;
+    std::vector<NodeId> vFromPeers;
+    auto work_it = orphan_work_set.begin();
+    while (work_it != orphan_work_set.end() && vOrphans.size() < MAX_ORPHAN_TX_BATCH) {
+        auto orphan_it = mapOrphanTransactions.find(*work_it);
+        work_it = orphan_work_set.erase(work_it);
         if (orphan_it == mapOrphanTransactions.end()) continue;
+        vOrphans.push_back(orphan_it->second.tx);
+        vFromPeers.push_back(orphan_it->second.fromPeer);
+    }
+    if (vOrphans.empty()) return;
+
+    // The states are not sent to the peers so someone can't setup nodes to counter-DoS based on orphan
+    // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
+    // anyone relaying LegitTxX banned)
+    std::vector<MempoolAcceptResult> results;
+    AcceptToMemoryPoolBatch(mempool, vOrphans, results, false /* bypass_limits */);
 
-        const CTransactionRef porphanTx = orphan_it->second.tx;
-        const CTransaction& orphanTx = *porphanTx;
-        NodeId fromPeer = orphan_it->second.fromPeer;
-        bool fMissingInputs2 = false;
-        // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
-        // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
-        // anyone relaying LegitTxX banned)
-        CValidationState stateDummy;
-
-        if (setMisbehaving.count(fromPeer)) continue;
-        if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, &fMissingInputs2, &removed_txn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
+    std::set<NodeId> setMisbehaving;
+    for (size_t i = 0; i < vOrphans.size(); ++i) {
+        const CTransaction& orphanTx = *vOrphans[i];
+        const uint256& orphanHash = orphanTx.GetHash();
+        const NodeId fromPeer = vFromPeers[i];
+        MempoolAcceptResult& result = results[i];
+        CValidationState& stateDummy = result.state;
+
+        if (result.accepted) {
             LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
             RelayTransaction(orphanTx, connman);
-            for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
-                auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(orphanHash, i));
+            for (unsigned int n = 0; n < orphanTx.vout.size(); n++) {
+                auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(orphanHash, n));
                 if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
                     for (const auto& elem : it_by_prev->second) {
                         orphan_work_set.insert(elem->first);
                     }
                 }
             }
+            removed_txn.splice(removed_txn.end(), result.replaced);
             EraseOrphanTx(orphanHash);
-            done = true;
-        } else if (!fMissingInputs2) {
+        } else if (!result.missing_inputs) {
             int nDos = 0;
-            if (stateDummy.IsInvalid(nDos) && nDos > 0) {
+            if (stateDummy.IsInvalid(nDos) && nDos > 0 && !setMisbehaving.count(fromPeer)) {
                 // Punish peer that gave us an invalid orphan tx
                 Misbehaving(fromPeer, nDos);
                 setMisbehaving.insert(fromPeer);
@@ -1645,10 +1944,9 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
                 recentRejects->insert(orphanHash);
             }
             EraseOrphanTx(orphanHash);
-            done = true;
         }
-        mempool.check(pcoinsTip.get());
     }
+    mempool.check(pcoinsTip.get());
 }
 
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61)
@@ -2221,6 +2519,21 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         return true;
     }
 
+    if (strCommand == NetMsgType::GETCFILTERS) {
+        ProcessGetCFilters(pfrom, vRecv, chainparams, connman);
+        return true;
+    }
+
+    if (strCommand == NetMsgType::GETCFHEADERS) {
+        ProcessGetCFHeaders(pfrom, vRecv, chainparams, connman);
+        return true;
+    }
+
+    if (strCommand == NetMsgType::GETCFCHECKPT) {
+        ProcessGetCFCheckPt(pfrom, vRecv, chainparams, connman);
+        return true;
+    }
+
     if (strCommand == NetMsgType::GETHEADERS) {
         CBlockLocator locator;
         uint256 hashStop;
@@ -2549,7 +2862,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 }
 
                 PartiallyDownloadedBlock& partialBlock = *(*queuedBlockIt)->partialBlock;
-                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = partialBlock.InitData(cmpctblock, ExtraTxnForCompact().Get());
+                if (status == READ_STATUS_OK) {
+                    RecordCompactExtraTransactions(pindex->GetBlockHash(), partialBlock.ExtraTxnCount());
+                }
                 if (status == READ_STATUS_INVALID) {
                     MarkBlockAsReceived(pindex->GetBlockHash()); // Reset in-flight state in case of whitelist
                     Misbehaving(pfrom->GetId(), 100, strprintf("Peer %d sent us invalid compact block\n", pfrom->GetId()));
@@ -2584,11 +2900,12 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // Optimistically try to reconstruct anyway since we might be
                 // able to without any round trips.
                 PartiallyDownloadedBlock tempBlock(&mempool);
-                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = tempBlock.InitData(cmpctblock, ExtraTxnForCompact().Get());
                 if (status != READ_STATUS_OK) {
                     // TODO: don't ignore failures
                     return true;
                 }
+                RecordCompactExtraTransactions(pindex->GetBlockHash(), tempBlock.ExtraTxnCount());
                 std::vector<CTransactionRef> dummy;
                 status = tempBlock.FillBlock(*pblock, dummy);
                 if (status == READ_STATUS_OK) {
@@ -3030,6 +3347,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     xapp.onBroadcastReceived(raw, state);
 
                 if (state.IsInvalid(dos)) {
+                    LOCK(cs_main);
                     LogPrint(BCLog::XBRIDGE, "invalid xbridge packet from peer=%d %s : %s\n", pfrom->GetId(),
                             pfrom->cleanSubVer, state.GetRejectReason());
                     if (dos > 0)
@@ -3047,10 +3365,12 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         // Relay xbridge packets only if state is good
         if (dos <= 0) {
+            // Serialize once, the buffers are shared by all peers
+            const CSharedNetMsg msg = CConnman::ShareMessage(msgMaker.Make(NetMsgType::XBRIDGE, rawcopy));
             connman->ForEachNode([&](CNode *pnode) {
                 if (!pnode->fSuccessfullyConnected)
                     return;
-                connman->PushMessage(pnode, msgMaker.Make(NetMsgType::XBRIDGE, rawcopy));
+                connman->PushMessage(pnode, msg);
             });
         }
 
@@ -3178,6 +3498,19 @@ bool PeerLogicValidation::SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_
     return false;
 }
 
+/**
+ * Service node, XBridge and XRouter messages do not affect validation. They
+ * are processed on the message handler workers, in order for each peer, so
+ * that a busy service node does not hold up block and transaction relay on
+ * the message handler thread. Address messages stay on the message handler
+ * thread, they are sent from SendMessages.
+ */
+static bool IsPeerLaneMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::XBRIDGE || strCommand == NetMsgType::XROUTER ||
+           strCommand == NetMsgType::SNREGISTER || strCommand == NetMsgType::SNPING;
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3259,15 +3592,47 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         return fMoreWork;
     }
 
-    // Process message
+    if (pfrom->fSuccessfullyConnected && IsPeerLaneMessage(strCommand)) {
+        // The message counts against the receive flood size until it is processed
+        const size_t nSize = vRecv.size() + CMessageHeader::HEADER_SIZE;
+        auto updateQueueSize = [this, pfrom](size_t nAdded, size_t nRemoved) {
+            LOCK(pfrom->cs_vProcessMsg);
+            pfrom->nProcessQueueSize += nAdded;
+            pfrom->nProcessQueueSize -= nRemoved;
+            pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+        };
+        updateQueueSize(nSize, 0);
+        auto pmsg = std::make_shared<CNetMessage>(std::move(msg));
+        if (connman->QueueMessageTask(pfrom, [this, pfrom, pmsg, strCommand, nSize, updateQueueSize, &interruptMsgProc] {
+                ProcessReceivedMessage(pfrom, strCommand, *pmsg, interruptMsgProc);
+                updateQueueSize(0, nSize);
+            })) {
+            return fMoreWork;
+        }
+        // No workers, the message is processed here
+        updateQueueSize(0, nSize);
+        msg = std::move(*pmsg);
+    }
+
+    if (!ProcessReceivedMessage(pfrom, strCommand, msg, interruptMsgProc))
+        return false;
+    if (!pfrom->vRecvGetData.empty())
+        fMoreWork = true;
+
+    return fMoreWork;
+}
+
+bool PeerLogicValidation::ProcessReceivedMessage(CNode* pfrom, const std::string& strCommand, CNetMessage& msg, std::atomic<bool>& interruptMsgProc)
+{
+    const CChainParams& chainparams = Params();
+    const unsigned int nMessageSize = msg.hdr.nMessageSize;
+
     bool fRet = false;
     try
     {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
+        fRet = ProcessMessage(pfrom, strCommand, msg.vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
         if (interruptMsgProc)
             return false;
-        if (!pfrom->vRecvGetData.empty())
-            fMoreWork = true;
     }
     catch (const std::ios_base::failure& e)
     {
@@ -3307,7 +3672,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     LOCK(cs_main);
     SendRejectsAndCheckIfBanned(pfrom, m_enable_bip61);
 
-    return fMoreWork;
+    return true;
 }
 
 void PeerLogicValidation::ConsiderEviction(CNode *pto, int64_t time_in_seconds)
@@ -3656,18 +4021,30 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                     int nSendFlags = state.fWantsCmpctWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
 
                     bool fGotBlockFromCache = false;
+                    std::shared_ptr<const CBlock> a_recent_block;
+                    std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
+                    bool fWitnessesPresentInARecentCompactBlock = false;
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            if (state.fWantsCmpctWitness || !fWitnessesPresentInMostRecentCompactBlock)
-                                connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
-                            else {
-                                CBlockHeaderAndShortTxIDs cmpctblock(*most_recent_block, state.fWantsCmpctWitness);
-                                connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
-                            }
+                            a_recent_block = most_recent_block;
+                            a_recent_compact_block = most_recent_compact_block;
+                            fWitnessesPresentInARecentCompactBlock = fWitnessesPresentInMostRecentCompactBlock;
                             fGotBlockFromCache = true;
                         }
                     }
+                    if (fGotBlockFromCache) {
+                        if (state.fWantsCmpctWitness || !fWitnessesPresentInARecentCompactBlock) {
+                            connman->PushMessage(pto, GetRecentBlockMsg(pBestIndex->GetBlockHash(), state.fWantsCmpctWitness ? RECENT_CMPCTBLOCK : RECENT_CMPCTBLOCK_NO_WITNESS, [&] {
+                                return msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block);
+                            }));
+                        } else {
+                            connman->PushMessage(pto, GetRecentBlockMsg(pBestIndex->GetBlockHash(), RECENT_CMPCTBLOCK_TXID, [&] {
+                                CBlockHeaderAndShortTxIDs cmpctblock(*a_recent_block, state.fWantsCmpctWitness);
+                                return msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock);
+                            }));
+                        }
+                    }
                     if (!fGotBlockFromCache) {
                         CBlock block;
                         bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
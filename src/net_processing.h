@@ -18,8 +18,10 @@ extern void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
-/** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
-static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Default number of orphan, rejected and recently replaced or evicted txn to keep around for block reconstruction */
+static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 1000;
+/** Default for -blockreconstructionextratxnsize, maximum memory of the txn kept for block reconstruction in MB */
+static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN_SIZE = 10;
 /** Default for BIP61 (sending reject messages) */
 static constexpr bool DEFAULT_ENABLE_BIP61{true};
 
@@ -29,6 +31,9 @@ private:
     BanMan* const m_banman;
 
     bool SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_bip61) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Process a received message and punish the peer if it misbehaved.
+     *  Returns false if processing was interrupted. */
+    bool ProcessReceivedMessage(CNode* pfrom, const std::string& strCommand, CNetMessage& msg, std::atomic<bool>& interruptMsgProc);
 public:
     PeerLogicValidation(CConnman* connman, BanMan* banman, CScheduler &scheduler, bool enable_bip61);
 
@@ -36,6 +41,10 @@ public:
      * Overridden from CValidationInterface.
      */
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted) override;
+    /**
+     * Overridden from CValidationInterface.
+     */
+    void TransactionRemovedFromMempool(const CTransactionRef& ptx) override;
     /**
      * Overridden from CValidationInterface.
      */
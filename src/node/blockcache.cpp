@@ -0,0 +1,112 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockcache.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <netmessagemaker.h>
+#include <primitives/block.h>
+#include <protocol.h>
+#include <validation.h>
+#include <version.h>
+
+std::unique_ptr<BlockCache> g_block_cache;
+
+/** Memory used by a cached message, including the list and map nodes */
+static size_t MessageBytes(const CSharedNetMsg& msg)
+{
+    return msg.header->capacity() + msg.data->capacity() + 256;
+}
+
+CSharedNetMsg ReadBlockMsg(const CBlockIndex* pindex, bool fWitness, const CChainParams& chainparams)
+{
+    CSerializedNetMsg msg;
+    msg.command = NetMsgType::BLOCK;
+    if (fWitness) {
+        if (!ReadRawBlockFromDisk(msg.data, pindex, chainparams.MessageStart()))
+            return CSharedNetMsg();
+    } else {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+            return CSharedNetMsg();
+        msg = CNetMsgMaker(PROTOCOL_VERSION).Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block);
+    }
+    return CConnman::ShareMessage(std::move(msg));
+}
+
+CSharedNetMsg GetBlockMsg(const CBlockIndex* pindex, bool fWitness, const CChainParams& chainparams)
+{
+    if (g_block_cache)
+        return g_block_cache->Get(pindex, fWitness, chainparams);
+    return ReadBlockMsg(pindex, fWitness, chainparams);
+}
+
+CSharedNetMsg BlockCache::Get(const CBlockIndex* pindex, bool fWitness, const CChainParams& chainparams)
+{
+    const Key key(pindex->GetBlockHash(), fWitness);
+    {
+        LOCK(m_mutex);
+        const auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            ++m_hits;
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            return it->second->second;
+        }
+        ++m_misses;
+    }
+
+    // Read without the lock, other blocks can be served meanwhile
+    CSharedNetMsg msg = ReadBlockMsg(pindex, fWitness, chainparams);
+    if (msg.IsNull())
+        return msg;
+    const size_t bytes = MessageBytes(msg);
+    if (bytes > m_max_bytes)
+        return msg;
+
+    LOCK(m_mutex);
+    if (m_entries.count(key))
+        return msg;
+    while (!m_lru.empty() && m_bytes + bytes > m_max_bytes) {
+        m_bytes -= MessageBytes(m_lru.back().second);
+        m_entries.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+    m_lru.emplace_front(key, msg);
+    m_entries.emplace(key, m_lru.begin());
+    m_bytes += bytes;
+    return msg;
+}
+
+void BlockCache::Clear()
+{
+    LOCK(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+size_t BlockCache::Count()
+{
+    LOCK(m_mutex);
+    return m_entries.size();
+}
+
+size_t BlockCache::Bytes()
+{
+    LOCK(m_mutex);
+    return m_bytes;
+}
+
+uint64_t BlockCache::Hits()
+{
+    LOCK(m_mutex);
+    return m_hits;
+}
+
+uint64_t BlockCache::Misses()
+{
+    LOCK(m_mutex);
+    return m_misses;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKCACHE_H
+#define BITCOIN_NODE_BLOCKCACHE_H
+
+#include <net.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <list>
+#include <map>
+#include <memory>
+
+class CBlockIndex;
+class CChainParams;
+
+/** Default for -blockcachesize, the memory of the serialized block cache in MiB */
+static const int64_t DEFAULT_BLOCK_CACHE_SIZE = 32;
+
+/**
+ * LRU cache of serialized blocks, ready to be pushed to peers as block
+ * messages. Blocks in the witness format are copied from the block files
+ * without deserializing them, as the network format matches the format on
+ * disk. The header and checksum of a message are computed once, and the
+ * buffers are shared by the peers the block is sent to and by REST replies.
+ */
+class BlockCache
+{
+private:
+    typedef std::pair<uint256, bool> Key;
+    typedef std::pair<Key, CSharedNetMsg> Entry;
+
+    const size_t m_max_bytes;
+
+    Mutex m_mutex;
+    //! Most recently used first
+    std::list<Entry> m_lru GUARDED_BY(m_mutex);
+    std::map<Key, std::list<Entry>::iterator> m_entries GUARDED_BY(m_mutex);
+    size_t m_bytes GUARDED_BY(m_mutex){0};
+    uint64_t m_hits GUARDED_BY(m_mutex){0};
+    uint64_t m_misses GUARDED_BY(m_mutex){0};
+
+public:
+    explicit BlockCache(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+    /// Return the block message of a block, reading it from disk if it is not
+    /// cached. With fWitness unset the block is serialized without witness
+    /// data. Returns a null message if the block could not be read.
+    CSharedNetMsg Get(const CBlockIndex* pindex, bool fWitness, const CChainParams& chainparams);
+
+    void Clear();
+
+    size_t Count();
+    size_t Bytes();
+    uint64_t Hits();
+    uint64_t Misses();
+};
+
+/// Read a block message from disk, not cached.
+CSharedNetMsg ReadBlockMsg(const CBlockIndex* pindex, bool fWitness, const CChainParams& chainparams);
+
+/// Return a block message from the block cache, or from disk if the cache is
+/// disabled.
+CSharedNetMsg GetBlockMsg(const CBlockIndex* pindex, bool fWitness, const CChainParams& chainparams);
+
+/// The serialized block cache sized by -blockcachesize. May be null.
+extern std::unique_ptr<BlockCache> g_block_cache;
+
+#endif // BITCOIN_NODE_BLOCKCACHE_H
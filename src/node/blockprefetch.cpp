@@ -0,0 +1,144 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockprefetch.h>
+
+#include <chain.h>
+#include <primitives/block.h>
+#include <util/system.h>
+#include <validation.h>
+
+std::unique_ptr<BlockPrefetcher> g_block_prefetcher;
+
+struct BlockPrefetcher::Entry
+{
+    const uint256 hash;
+    const CDiskBlockPos pos;
+    std::shared_ptr<CBlock> block;
+    bool done{false};
+    bool ok{false};
+    bool cancelled{false};
+
+    Entry(const uint256& hash, const CDiskBlockPos& pos) : hash(hash), pos(pos) {}
+};
+
+BlockPrefetcher::BlockPrefetcher(const Consensus::Params& consensus_params, int n_threads, int n_max_blocks)
+    : m_consensus_params(consensus_params), m_max_blocks(n_max_blocks)
+{
+    for (int i = 0; i < n_threads; ++i) {
+        m_threads.emplace_back(&TraceThread<std::function<void()>>, "prefetch",
+                               std::bind(&BlockPrefetcher::ThreadWorker, this));
+    }
+}
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+    Stop();
+}
+
+void BlockPrefetcher::ThreadWorker()
+{
+    while (true) {
+        std::shared_ptr<Entry> entry;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv_work.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+            if (m_stop) return;
+            entry = std::move(m_pending.front());
+            m_pending.pop_front();
+            if (entry->cancelled) continue;
+        }
+
+        // The header of a proof of work block is checked while reading it,
+        // the block hash is compared here and cached for the caller.
+        auto block = std::make_shared<CBlock>();
+        const bool ok = ReadBlockFromDisk(*block, entry->pos, m_consensus_params) && block->GetHash() == entry->hash;
+        if (!ok) {
+            LogPrint(BCLog::BENCH, "%s: Failed to read block %s ahead\n", __func__, entry->hash.ToString());
+        }
+
+        {
+            LOCK(m_mutex);
+            entry->block = std::move(block);
+            entry->ok = ok;
+            entry->done = true;
+        }
+        m_cv_done.notify_all();
+    }
+}
+
+void BlockPrefetcher::Prefetch(const CBlockIndex* pindex_tip, const CBlockIndex* pindex_target, bool skip_target)
+{
+    AssertLockHeld(cs_main);
+
+    const int tip_height = pindex_tip ? pindex_tip->nHeight : -1;
+    const int last_height = std::min(pindex_target->nHeight, tip_height + m_max_blocks);
+
+    // Blocks are queued in chain order, the lowest block is connected first
+    std::vector<const CBlockIndex*> to_fetch;
+    for (const CBlockIndex* pindex = pindex_target->GetAncestor(last_height); pindex && pindex->nHeight > tip_height; pindex = pindex->pprev) {
+        if (skip_target && pindex == pindex_target) continue;
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) continue;
+        to_fetch.push_back(pindex);
+    }
+
+    {
+        LOCK(m_mutex);
+        if (m_stop) return;
+
+        // Drop the blocks that were connected or are no longer on the way
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            const CBlockIndex* pindex = it->first;
+            if (pindex->nHeight <= tip_height || pindex->nHeight > last_height ||
+                pindex_target->GetAncestor(pindex->nHeight) != pindex) {
+                it->second->cancelled = true;
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        for (auto it = to_fetch.rbegin(); it != to_fetch.rend(); ++it) {
+            const CBlockIndex* pindex = *it;
+            if (m_entries.count(pindex)) continue;
+            auto entry = std::make_shared<Entry>(pindex->GetBlockHash(), pindex->GetBlockPos());
+            m_entries.emplace(pindex, entry);
+            m_pending.push_back(std::move(entry));
+        }
+    }
+    m_cv_work.notify_all();
+}
+
+std::shared_ptr<const CBlock> BlockPrefetcher::Take(const CBlockIndex* pindex)
+{
+    WAIT_LOCK(m_mutex, lock);
+    const auto it = m_entries.find(pindex);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+    const std::shared_ptr<Entry> entry = it->second;
+    m_cv_done.wait(lock, [this, &entry] { return m_stop || entry->done; });
+    if (!entry->done) {
+        return nullptr;
+    }
+    m_entries.erase(pindex);
+    return entry->ok ? entry->block : nullptr;
+}
+
+void BlockPrefetcher::Stop()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+        m_pending.clear();
+        m_entries.clear();
+    }
+    m_cv_work.notify_all();
+    m_cv_done.notify_all();
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
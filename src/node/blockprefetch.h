@@ -0,0 +1,81 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKPREFETCH_H
+#define BITCOIN_NODE_BLOCKPREFETCH_H
+
+#include <sync.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+namespace Consensus { struct Params; }
+
+extern CCriticalSection cs_main;
+
+/** Default for -blockprefetch, the number of blocks read ahead of the tip */
+static const int DEFAULT_BLOCK_PREFETCH = 32;
+static const int MAX_BLOCK_PREFETCH = 1024;
+/** Number of threads reading blocks ahead of the tip */
+static const int BLOCK_PREFETCH_THREADS = 4;
+
+/**
+ * Reads the blocks on the way to the best chain ahead of ConnectTip. Worker
+ * threads open, deserialize and hash the next blocks while the validation
+ * thread connects the current one, so that disk latency and block hashing
+ * overlap with script and stake validation.
+ *
+ * The block positions are captured under cs_main when the blocks are queued,
+ * the workers never take cs_main: the validation thread holds it while it
+ * waits on a block.
+ */
+class BlockPrefetcher
+{
+private:
+    struct Entry;
+
+    const Consensus::Params& m_consensus_params;
+    const int m_max_blocks;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv_work;
+    std::condition_variable m_cv_done;
+    std::map<const CBlockIndex*, std::shared_ptr<Entry>> m_entries GUARDED_BY(m_mutex);
+    std::deque<std::shared_ptr<Entry>> m_pending GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void ThreadWorker();
+
+public:
+    BlockPrefetcher(const Consensus::Params& consensus_params, int n_threads, int n_max_blocks);
+    ~BlockPrefetcher();
+
+    /// Queue the blocks after the tip on the way to the target, up to the
+    /// maximum number of blocks ahead. Blocks that are no longer on the way
+    /// are dropped. If skip_target is set the target block is already in
+    /// memory and not read.
+    void Prefetch(const CBlockIndex* pindex_tip, const CBlockIndex* pindex_target, bool skip_target)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /// Take a queued block, waiting for it to be read if necessary. Returns
+    /// null if the block was not queued or could not be read, in which case
+    /// the caller reads it itself. The proof of stake of a block is checked
+    /// by the caller, it needs the chain state.
+    std::shared_ptr<const CBlock> Take(const CBlockIndex* pindex);
+
+    /// Drop all queued blocks and stop the worker threads.
+    void Stop();
+};
+
+/// The block prefetcher started with -blockprefetch. May be null.
+extern std::unique_ptr<BlockPrefetcher> g_block_prefetcher;
+
+#endif // BITCOIN_NODE_BLOCKPREFETCH_H
@@ -0,0 +1,166 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/dbcompaction.h>
+
+#include <dbwrapper.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h>
+
+std::unique_ptr<DBCompactor> g_db_compactor;
+
+static CDBWrapper* GetDatabase(const std::string& name) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (name == "chainstate") return pcoinsdbview ? &pcoinsdbview->GetDB() : nullptr;
+    if (name == "blockindex") return pblocktree.get();
+    return nullptr;
+}
+
+DBCompactor::DBCompactor(int64_t idle_interval)
+    : m_idle_interval(idle_interval), m_start_time(GetTime())
+{
+    LOCK(m_mutex);
+    for (const std::string& name : GetNames()) {
+        m_status[name];
+    }
+}
+
+DBCompactor::~DBCompactor()
+{
+    Interrupt();
+    Stop();
+}
+
+const std::vector<std::string>& DBCompactor::GetNames()
+{
+    static const std::vector<std::string> names{"chainstate", "blockindex"};
+    return names;
+}
+
+bool DBCompactor::Start(const std::string& name, std::string& error)
+{
+    CDBWrapper* db;
+    {
+        LOCK(cs_main);
+        db = GetDatabase(name);
+    }
+    if (!db) {
+        error = strprintf("Unknown database %s", name);
+        return false;
+    }
+
+    LOCK(m_mutex);
+    if (m_interrupt) {
+        error = "Shutting down";
+        return false;
+    }
+    for (const auto& entry : m_status) {
+        if (entry.second.running) {
+            error = strprintf("Compaction of %s is running", entry.first);
+            return false;
+        }
+    }
+    // The thread of the last compaction has released the mutex for good
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    DBCompactionStatus& status = m_status[name];
+    status.running = true;
+    status.progress = 0;
+    status.last_start = GetTime();
+    m_thread = std::thread(&TraceThread<std::function<void()>>, "dbcompact",
+                           std::bind(&DBCompactor::ThreadCompact, this, name, db));
+    return true;
+}
+
+void DBCompactor::ThreadCompact(std::string name, CDBWrapper* db)
+{
+    LogPrintf("Starting database compaction of %s, %d MiB\n", name, db->EstimateTotalSize() >> 20);
+    int logged_percent = 0;
+    const bool completed = db->Compact([&](double progress) {
+        {
+            LOCK(m_mutex);
+            m_status[name].progress = progress;
+        }
+        const int percent = static_cast<int>(progress * 100);
+        if (percent >= logged_percent + 10 && percent < 100) {
+            logged_percent = percent - percent % 10;
+            LogPrintf("Compacting %s: %d%%\n", name, logged_percent);
+        }
+        return !m_interrupt;
+    });
+
+    {
+        LOCK(m_mutex);
+        DBCompactionStatus& status = m_status[name];
+        status.running = false;
+        status.last_end = GetTime();
+        status.last_completed = completed;
+    }
+    if (completed) {
+        LogPrintf("Finished database compaction of %s, %d MiB\n", name, db->EstimateTotalSize() >> 20);
+    } else {
+        LogPrintf("Interrupted database compaction of %s\n", name);
+    }
+}
+
+void DBCompactor::CompactIfIdle()
+{
+    if (m_idle_interval <= 0 || m_interrupt) return;
+
+    // A node that is syncing, or that is connecting a block right now, is
+    // not idle. Compacting competes with it for the disk.
+    if (IsInitialBlockDownload()) return;
+    {
+        TRY_LOCK(cs_main, lockMain);
+        if (!lockMain) return;
+    }
+
+    std::string name;
+    {
+        LOCK(m_mutex);
+        int64_t oldest = GetTime() - m_idle_interval;
+        for (const auto& entry : m_status) {
+            if (entry.second.running) return;
+            const int64_t last = std::max(entry.second.last_end, m_start_time);
+            if (last <= oldest) {
+                oldest = last;
+                name = entry.first;
+            }
+        }
+    }
+    if (name.empty()) return;
+
+    LogPrint(BCLog::LEVELDB, "Node is idle, compacting %s\n", name);
+    std::string error;
+    if (!Start(name, error)) {
+        LogPrint(BCLog::LEVELDB, "%s: %s\n", __func__, error);
+    }
+}
+
+std::map<std::string, DBCompactionStatus> DBCompactor::GetStatus() const
+{
+    LOCK(m_mutex);
+    return m_status;
+}
+
+void DBCompactor::Interrupt()
+{
+    m_interrupt();
+}
+
+void DBCompactor::Stop()
+{
+    // Start fails once interrupted, the thread is not replaced after this
+    std::thread thread;
+    {
+        LOCK(m_mutex);
+        thread = std::move(m_thread);
+    }
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_DBCOMPACTION_H
+#define BITCOIN_NODE_DBCOMPACTION_H
+
+#include <sync.h>
+#include <threadinterrupt.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CDBWrapper;
+
+/** Default for -dbcompactidle, the hours between idle-time compactions of a database (0 to disable) */
+static const int64_t DEFAULT_DB_COMPACT_IDLE = 0;
+/** Seconds between checks whether the node is idle enough to compact a database */
+static const int64_t DB_COMPACT_IDLE_CHECK_INTERVAL = 5 * 60;
+
+struct DBCompactionStatus
+{
+    bool running{false};
+    //! Compacted fraction of the data of the running or last compaction
+    double progress{0};
+    int64_t last_start{0};
+    int64_t last_end{0};
+    //! Whether the last compaction ran to the end
+    bool last_completed{false};
+};
+
+/**
+ * Compacts the chain state and block index databases in a background thread,
+ * one at a time, when requested over RPC or when the node is idle. LevelDB
+ * compacts on its own as data is written, a full compaction drops the
+ * overwritten and deleted records that linger in the lower levels and
+ * shortens the lookups of a database that has been written for a long time.
+ */
+class DBCompactor
+{
+private:
+    //! Seconds between idle-time compactions of a database, 0 if disabled
+    const int64_t m_idle_interval;
+    const int64_t m_start_time;
+
+    mutable Mutex m_mutex;
+    std::map<std::string, DBCompactionStatus> m_status GUARDED_BY(m_mutex);
+    std::thread m_thread;
+    CThreadInterrupt m_interrupt;
+
+    void ThreadCompact(std::string name, CDBWrapper* db);
+
+public:
+    explicit DBCompactor(int64_t idle_interval);
+    ~DBCompactor();
+
+    /// The names of the databases that can be compacted.
+    static const std::vector<std::string>& GetNames();
+
+    /// Start compacting a database in the background. Fails if the name is
+    /// unknown or a compaction is running.
+    bool Start(const std::string& name, std::string& error);
+
+    /// Compact the database that was not compacted for the longest time if
+    /// that is longer than the idle-time interval and the node is not busy.
+    /// Called from the scheduler.
+    void CompactIfIdle();
+
+    std::map<std::string, DBCompactionStatus> GetStatus() const;
+
+    void Interrupt();
+    void Stop();
+};
+
+/// The database compactor, created at startup.
+extern std::unique_ptr<DBCompactor> g_db_compactor;
+
+#endif // BITCOIN_NODE_DBCOMPACTION_H
@@ -0,0 +1,273 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/utxo_snapshot.h>
+
+#include <chain.h>
+#include <clientversion.h>
+#include <hash.h>
+#include <shutdown.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <version.h>
+#include <warnings.h>
+
+std::unique_ptr<UTXOSnapshot> g_utxo_snapshot;
+
+/** Coins loaded into the cache before it is flushed to the snapshot database */
+static const size_t SNAPSHOT_FLUSH_USAGE = 64 << 20;
+
+static void HashCoin(CHashWriter& ss, const COutPoint& outpoint, const Coin& coin)
+{
+    ss << outpoint << coin;
+}
+
+bool DumpUTXOSnapshot(CCoinsViewCursor& cursor, const CBlockIndex* base, CAutoFile& file,
+                      uint64_t& coins_written, uint256& hash)
+{
+    if (cursor.GetBestBlock() != base->GetBlockHash()) {
+        return error("%s: Coins are not at block %s", __func__, base->GetBlockHash().ToString());
+    }
+
+    // The number of coins is not known in advance, the metadata is rewritten
+    // once they are written.
+    FILE* raw = file.Get();
+    const long metadata_pos = ftell(raw);
+    file << SnapshotMetadata(base->GetBlockHash(), base->nHeight, 0);
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    coins_written = 0;
+    COutPoint outpoint;
+    Coin coin;
+    for (; cursor.Valid(); cursor.Next()) {
+        if (ShutdownRequested()) {
+            return error("%s: Interrupted", __func__);
+        }
+        if (!cursor.GetKey(outpoint) || !cursor.GetValue(coin)) {
+            return error("%s: Unable to read coin database", __func__);
+        }
+        file << outpoint << coin;
+        HashCoin(ss, outpoint, coin);
+        ++coins_written;
+    }
+    hash = ss.GetHash();
+
+    if (fseek(raw, metadata_pos, SEEK_SET) != 0) {
+        return error("%s: Failed to seek to the snapshot metadata", __func__);
+    }
+    file << SnapshotMetadata(base->GetBlockHash(), base->nHeight, coins_written);
+    return true;
+}
+
+bool ReadSnapshotMetadata(const fs::path& path, SnapshotMetadata& metadata, std::string& error)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Unable to open UTXO snapshot %s", path.string());
+        return false;
+    }
+    try {
+        file >> metadata;
+    } catch (const std::exception& e) {
+        error = strprintf("Invalid UTXO snapshot %s: %s", path.string(), e.what());
+        return false;
+    }
+    return true;
+}
+
+UTXOSnapshot::UTXOSnapshot(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_cache_size(n_cache_size), m_memory(f_memory),
+      m_db(MakeUnique<CCoinsViewDB>(GetDataDir() / "chainstate_snapshot", n_cache_size, f_memory, f_wipe))
+{}
+
+UTXOSnapshot::~UTXOSnapshot()
+{
+    Interrupt();
+    Stop();
+}
+
+bool UTXOSnapshot::HashCoins(CCoinsViewCursor& cursor, uint256& hash)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    COutPoint outpoint;
+    Coin coin;
+    for (; cursor.Valid(); cursor.Next()) {
+        if (m_interrupt || ShutdownRequested()) {
+            return false;
+        }
+        if (!cursor.GetKey(outpoint) || !cursor.GetValue(coin)) {
+            return error("%s: Unable to read coin database", __func__);
+        }
+        HashCoin(ss, outpoint, coin);
+    }
+    hash = ss.GetHash();
+    return true;
+}
+
+bool UTXOSnapshot::Load(const fs::path& path, std::string& error)
+{
+    return Load(path, Params().Assumeutxo(), error);
+}
+
+bool UTXOSnapshot::Load(const fs::path& path, const MapAssumeutxo& pinned, std::string& error)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Unable to open UTXO snapshot %s", path.string());
+        return false;
+    }
+
+    SnapshotMetadata metadata;
+    try {
+        file >> metadata;
+    } catch (const std::exception& e) {
+        error = strprintf("Invalid UTXO snapshot %s: %s", path.string(), e.what());
+        return false;
+    }
+
+    const auto it = pinned.find(metadata.m_base_height);
+    if (it == pinned.end() || it->second.blockhash != metadata.m_base_blockhash) {
+        error = strprintf("UTXO snapshot of block %s at height %d is not pinned in the chain params",
+                          metadata.m_base_blockhash.ToString(), metadata.m_base_height);
+        return false;
+    }
+    const uint256& expected_hash = it->second.hash_serialized;
+
+    m_base_blockhash = metadata.m_base_blockhash;
+    m_base_height = metadata.m_base_height;
+    m_hash = expected_hash;
+
+    // Reuse the coins of a previous run if they are complete
+    if (m_db->GetBestBlock() == m_base_blockhash) {
+        std::unique_ptr<CCoinsViewCursor> cursor(m_db->Cursor());
+        uint256 hash;
+        if (HashCoins(*cursor, hash) && hash == expected_hash) {
+            LogPrintf("Using UTXO snapshot of block %s at height %d\n", m_base_blockhash.ToString(), m_base_height);
+            m_active = true;
+            return true;
+        }
+        if (ShutdownRequested()) {
+            error = "Interrupted while loading the UTXO snapshot";
+            return false;
+        }
+    }
+    if (!m_db->GetBestBlock().IsNull()) {
+        m_db.reset();
+        m_db = MakeUnique<CCoinsViewDB>(GetDataDir() / "chainstate_snapshot", m_cache_size, m_memory, true);
+    }
+
+    LogPrintf("Loading UTXO snapshot of block %s at height %d with %u coins\n",
+              m_base_blockhash.ToString(), m_base_height, metadata.m_coins_count);
+
+    CCoinsViewCache cache(m_db.get());
+    cache.SetBestBlock(m_base_blockhash);
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    COutPoint outpoint;
+    Coin coin;
+    try {
+        for (uint64_t i = 0; i < metadata.m_coins_count; ++i) {
+            file >> outpoint >> coin;
+            if (coin.nHeight > static_cast<uint32_t>(m_base_height) || coin.IsSpent()) {
+                error = strprintf("Invalid coin %s in the UTXO snapshot", outpoint.ToString());
+                return false;
+            }
+            HashCoin(ss, outpoint, coin);
+            cache.AddCoin(outpoint, std::move(coin), false);
+
+            if (cache.DynamicMemoryUsage() > SNAPSHOT_FLUSH_USAGE) {
+                if (ShutdownRequested()) {
+                    error = "Interrupted while loading the UTXO snapshot";
+                    return false;
+                }
+                if (!cache.Flush()) {
+                    error = "Failed to write the UTXO snapshot database";
+                    return false;
+                }
+                LogPrintf("Loaded %u of %u coins of the UTXO snapshot\n", i + 1, metadata.m_coins_count);
+            }
+        }
+    } catch (const std::exception& e) {
+        error = strprintf("Invalid UTXO snapshot %s: %s", path.string(), e.what());
+        return false;
+    }
+
+    // The snapshot must end after the coins
+    bool trailing_data = true;
+    try {
+        unsigned char b;
+        file >> b;
+    } catch (const std::ios_base::failure&) {
+        trailing_data = false;
+    }
+    if (trailing_data) {
+        error = strprintf("Invalid UTXO snapshot %s: unexpected data after the coins", path.string());
+        return false;
+    }
+
+    if (ss.GetHash() != expected_hash) {
+        error = strprintf("UTXO snapshot hash %s does not match the pinned hash %s",
+                          ss.GetHash().ToString(), expected_hash.ToString());
+        return false;
+    }
+    if (!cache.Flush()) {
+        error = "Failed to write the UTXO snapshot database";
+        return false;
+    }
+
+    LogPrintf("Loaded UTXO snapshot of block %s at height %d\n", m_base_blockhash.ToString(), m_base_height);
+    m_active = true;
+    return true;
+}
+
+bool UTXOSnapshot::IsBase(const CBlockIndex* pindex) const
+{
+    return m_active && pindex->nHeight == m_base_height && pindex->GetBlockHash() == m_base_blockhash;
+}
+
+bool UTXOSnapshot::GetCoin(const COutPoint& outpoint, Coin& coin) const
+{
+    return m_db->GetCoin(outpoint, coin);
+}
+
+void UTXOSnapshot::StartValidation(std::unique_ptr<CCoinsViewCursor> cursor)
+{
+    if (!m_active.exchange(false)) {
+        return;
+    }
+    LogPrintf("Validating UTXO snapshot of block %s at height %d\n", m_base_blockhash.ToString(), m_base_height);
+    m_thread_validate = std::thread(&TraceThread<std::function<void()>>, "snapshotval",
+                                    std::bind(&UTXOSnapshot::ThreadValidate, this, std::shared_ptr<CCoinsViewCursor>(std::move(cursor))));
+}
+
+void UTXOSnapshot::ThreadValidate(std::shared_ptr<CCoinsViewCursor> cursor)
+{
+    uint256 hash;
+    if (!HashCoins(*cursor, hash)) {
+        LogPrintf("%s: Validation of the UTXO snapshot was interrupted\n", __func__);
+        return;
+    }
+    if (hash != m_hash) {
+        const std::string msg = strprintf("The chain state at block %s does not match the loaded UTXO snapshot (%s != %s). "
+                                          "Service node collateral validated before the block may have been wrong.",
+                                          m_base_blockhash.ToString(), hash.ToString(), m_hash.ToString());
+        SetMiscWarning(msg);
+        LogPrintf("*** %s\n", msg);
+        return;
+    }
+    m_validated = true;
+    LogPrintf("UTXO snapshot of block %s at height %d is valid\n", m_base_blockhash.ToString(), m_base_height);
+}
+
+void UTXOSnapshot::Interrupt()
+{
+    m_interrupt();
+}
+
+void UTXOSnapshot::Stop()
+{
+    if (m_thread_validate.joinable()) {
+        m_thread_validate.join();
+    }
+}
@@ -0,0 +1,147 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_UTXO_SNAPSHOT_H
+#define BITCOIN_NODE_UTXO_SNAPSHOT_H
+
+#include <chainparams.h>
+#include <coins.h>
+#include <fs.h>
+#include <serialize.h>
+#include <streams.h>
+#include <threadinterrupt.h>
+#include <uint256.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+class CBlockIndex;
+class CCoinsViewDB;
+
+/** Magic bytes at the start of a UTXO snapshot file */
+static const unsigned char SNAPSHOT_MAGIC_BYTES[5] = {'u', 't', 'x', 'o', 0xff};
+static const uint16_t SNAPSHOT_VERSION = 1;
+
+/**
+ * Metadata at the start of a UTXO snapshot file, followed by m_coins_count
+ * (outpoint, coin) pairs in the order of the coin database.
+ */
+class SnapshotMetadata
+{
+public:
+    //! The hash of the block the snapshot was taken at.
+    uint256 m_base_blockhash;
+    int m_base_height{-1};
+    uint64_t m_coins_count{0};
+
+    SnapshotMetadata() = default;
+    SnapshotMetadata(const uint256& base_blockhash, int base_height, uint64_t coins_count)
+        : m_base_blockhash(base_blockhash), m_base_height(base_height), m_coins_count(coins_count) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s.write(reinterpret_cast<const char*>(SNAPSHOT_MAGIC_BYTES), sizeof(SNAPSHOT_MAGIC_BYTES));
+        ser_writedata16(s, SNAPSHOT_VERSION);
+        s << m_base_blockhash;
+        ser_writedata32(s, m_base_height);
+        ser_writedata64(s, m_coins_count);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char magic[sizeof(SNAPSHOT_MAGIC_BYTES)];
+        s.read(reinterpret_cast<char*>(magic), sizeof(magic));
+        if (memcmp(magic, SNAPSHOT_MAGIC_BYTES, sizeof(magic)) != 0) {
+            throw std::ios_base::failure("Invalid UTXO snapshot magic bytes");
+        }
+        if (ser_readdata16(s) != SNAPSHOT_VERSION) {
+            throw std::ios_base::failure("Unsupported UTXO snapshot version");
+        }
+        s >> m_base_blockhash;
+        m_base_height = ser_readdata32(s);
+        m_coins_count = ser_readdata64(s);
+    }
+};
+
+/** Read the metadata at the start of a snapshot file. */
+bool ReadSnapshotMetadata(const fs::path& path, SnapshotMetadata& metadata, std::string& error);
+
+/**
+ * Write the coins of a coin database cursor at base to a snapshot file.
+ *
+ * @param[out]  coins_written  The number of coins in the snapshot.
+ * @param[out]  hash  The content hash of the snapshot, as pinned in the chain params.
+ */
+bool DumpUTXOSnapshot(CCoinsViewCursor& cursor, const CBlockIndex* base, CAutoFile& file,
+                      uint64_t& coins_written, uint256& hash);
+
+/**
+ * A UTXO set snapshot of a block pinned in the chain params, stored in its own
+ * coin database (chainstate_snapshot/). New nodes load it at startup to
+ * validate service node collateral while the initial block download catches
+ * up. The download keeps validating history as usual, when the active chain
+ * connects the base block its chain state is hashed in the background and
+ * compared with the snapshot.
+ */
+class UTXOSnapshot
+{
+private:
+    const size_t m_cache_size;
+    const bool m_memory;
+    std::unique_ptr<CCoinsViewDB> m_db;
+
+    uint256 m_base_blockhash;
+    int m_base_height{-1};
+    uint256 m_hash;
+
+    std::atomic<bool> m_active{false};
+    std::atomic<bool> m_validated{false};
+
+    std::thread m_thread_validate;
+    CThreadInterrupt m_interrupt;
+
+    /// Hash the coins of a cursor in snapshot order.
+    bool HashCoins(CCoinsViewCursor& cursor, uint256& hash);
+
+    void ThreadValidate(std::shared_ptr<CCoinsViewCursor> cursor);
+
+public:
+    UTXOSnapshot(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+    ~UTXOSnapshot();
+
+    /// Load a snapshot pinned in the chain params, or reuse the coins loaded
+    /// by a previous run from the same snapshot.
+    bool Load(const fs::path& path, std::string& error);
+    bool Load(const fs::path& path, const MapAssumeutxo& pinned, std::string& error);
+
+    /// Whether coins are looked up in the snapshot, i.e. it is loaded and the
+    /// active chain has not reached its base block yet.
+    bool IsActive() const { return m_active; }
+
+    /// Whether the chain state at the base block matched the snapshot.
+    bool IsValidated() const { return m_validated; }
+
+    bool IsBase(const CBlockIndex* pindex) const;
+    const uint256& GetBaseBlockHash() const { return m_base_blockhash; }
+    int GetBaseHeight() const { return m_base_height; }
+
+    /// Look up an unspent output as of the base block.
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const;
+
+    /// Called when the active chain connects the base block, with a cursor
+    /// over the flushed chain state. Deactivates the snapshot and compares it
+    /// with the chain state in a background thread.
+    void StartValidation(std::unique_ptr<CCoinsViewCursor> cursor);
+
+    void Interrupt();
+    void Stop();
+};
+
+/// The UTXO snapshot loaded with -loadutxosnapshot. May be null.
+extern std::unique_ptr<UTXOSnapshot> g_utxo_snapshot;
+
+#endif // BITCOIN_NODE_UTXO_SNAPSHOT_H
@@ -0,0 +1,103 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <peertaskqueue.h>
+
+#include <util/system.h>
+
+PeerTaskQueue::PeerTaskQueue(int n_threads, const std::string& thread_name) : m_thread_name(thread_name)
+{
+    for (int i = 0; i < n_threads; ++i) {
+        m_threads.emplace_back(&TraceThread<std::function<void()>>, m_thread_name.c_str(),
+                               std::bind(&PeerTaskQueue::ThreadWorker, this));
+    }
+}
+
+PeerTaskQueue::~PeerTaskQueue()
+{
+    Stop();
+}
+
+void PeerTaskQueue::ThreadWorker()
+{
+    while (true) {
+        int64_t peer;
+        std::function<void()> task;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait(lock, [this] { return m_stop || !m_ready.empty(); });
+            if (m_stop) return;
+            peer = m_ready.front();
+            m_ready.pop_front();
+            std::deque<std::function<void()>>& tasks = m_tasks.at(peer);
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            --m_size;
+        }
+
+        task();
+        // Release what the task holds before the next task of the peer runs
+        task = nullptr;
+
+        {
+            LOCK(m_mutex);
+            const auto it = m_tasks.find(peer);
+            if (it->second.empty()) {
+                m_tasks.erase(it);
+                continue;
+            }
+            m_ready.push_back(peer);
+        }
+        m_cv.notify_one();
+    }
+}
+
+bool PeerTaskQueue::Add(int64_t peer, std::function<void()> task)
+{
+    {
+        LOCK(m_mutex);
+        if (m_stop) return false;
+        ++m_size;
+        const auto it = m_tasks.find(peer);
+        if (it != m_tasks.end()) {
+            // The peer is queued or its task is running
+            it->second.push_back(std::move(task));
+            return true;
+        }
+        m_tasks[peer].push_back(std::move(task));
+        m_ready.push_back(peer);
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+size_t PeerTaskQueue::Size()
+{
+    LOCK(m_mutex);
+    return m_size;
+}
+
+void PeerTaskQueue::Stop()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    m_threads.clear();
+
+    // Destroy the queued tasks without holding the lock
+    std::map<int64_t, std::deque<std::function<void()>>> tasks;
+    {
+        LOCK(m_mutex);
+        tasks.swap(m_tasks);
+        m_ready.clear();
+        m_size = 0;
+    }
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_PEERTASKQUEUE_H
+#define BITCOIN_PEERTASKQUEUE_H
+
+#include <sync.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * Runs tasks of peers on a pool of worker threads. The tasks of a peer run
+ * one at a time in the order they were added, the tasks of different peers
+ * run concurrently. Peers with queued tasks are served in turn, so a peer
+ * with many tasks does not hold up the others.
+ */
+class PeerTaskQueue
+{
+private:
+    const std::string m_thread_name;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    //! Queued tasks of the peers with queued or running tasks
+    std::map<int64_t, std::deque<std::function<void()>>> m_tasks GUARDED_BY(m_mutex);
+    //! Peers with queued tasks and no running task, in the order they are served
+    std::deque<int64_t> m_ready GUARDED_BY(m_mutex);
+    size_t m_size GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void ThreadWorker();
+
+public:
+    PeerTaskQueue(int n_threads, const std::string& thread_name);
+    ~PeerTaskQueue();
+
+    /// Queue a task of a peer. Returns false if the queue is stopped.
+    bool Add(int64_t peer, std::function<void()> task);
+
+    /// The number of queued tasks, not counting running ones.
+    size_t Size();
+
+    /// Wait for the running tasks, drop the queued ones and stop the threads.
+    void Stop();
+};
+
+#endif // BITCOIN_PEERTASKQUEUE_H
@@ -8,7 +8,10 @@
 #include <chainparams.h>
 #include <core_io.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/txindex.h>
+#include <key_io.h>
+#include <node/blockcache.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
@@ -218,24 +221,29 @@ static bool rest_block(HTTPRequest* req,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        if (rf == RetFormat::JSON && !ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
     switch (rf) {
     case RetFormat::BINARY: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string binaryBlock = ssBlock.str();
+        // Serialized blocks are served from the block cache
+        const bool fWitness = !(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS);
+        const CSharedNetMsg msg = GetBlockMsg(pblockindex, fWitness, Params());
+        if (msg.IsNull())
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        std::string binaryBlock(msg.data->begin(), msg.data->end());
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
         return true;
     }
 
     case RetFormat::HEX: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        const bool fWitness = !(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS);
+        const CSharedNetMsg msg = GetBlockMsg(pblockindex, fWitness, Params());
+        if (msg.IsNull())
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        std::string strHex = HexStr(msg.data->begin(), msg.data->end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
@@ -621,6 +629,57 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+/** Parses the address of an address index request, replies with an error if it can't be served. */
+static bool ParseAddressIndexRequest(HTTPRequest* req, const std::string& str_uri_part, uint256& script_hash)
+{
+    if (!CheckWarmup(req)) return false;
+    std::string address;
+    const RetFormat rf = ParseDataFormat(address, str_uri_part);
+    if (rf != RetFormat::JSON) {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    if (!g_addressindex) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Address index is not enabled (-addressindex)");
+    }
+    const CTxDestination dest = DecodeDestination(address);
+    if (!IsValidDestination(dest)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + SanitizeString(address));
+    }
+    if (!g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Address index is still syncing");
+    }
+    script_hash = AddressIndex::GetScriptHash(GetScriptForDestination(dest));
+    return true;
+}
+
+static bool rest_address_history(HTTPRequest* req, const std::string& str_uri_part)
+{
+    uint256 script_hash;
+    if (!ParseAddressIndexRequest(req, str_uri_part, script_hash)) return false;
+
+    std::vector<AddressHistoryEntry> entries;
+    if (!g_addressindex->FindHistory(script_hash, 0, std::numeric_limits<int>::max(), entries)) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read the address index");
+    }
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK, addressHistoryToJSON(entries).write() + "\n");
+    return true;
+}
+
+static bool rest_address_utxos(HTTPRequest* req, const std::string& str_uri_part)
+{
+    uint256 script_hash;
+    if (!ParseAddressIndexRequest(req, str_uri_part, script_hash)) return false;
+
+    std::vector<AddressUnspentEntry> entries;
+    if (!g_addressindex->FindUnspent(script_hash, entries)) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read the address index");
+    }
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK, addressUnspentToJSON(entries).write() + "\n");
+    return true;
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -634,6 +693,8 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/address/history/", rest_address_history},
+      {"/rest/address/utxos/", rest_address_utxos},
 };
 
 void StartREST()
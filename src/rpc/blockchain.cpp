@@ -14,8 +14,14 @@
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
+#include <node/dbcompaction.h>
+#include <node/utxo_snapshot.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
@@ -446,9 +452,8 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e) EXCLUSIVE_LOCK
 
     UniValue spent(UniValue::VARR);
     const CTxMemPool::txiter &it = mempool.mapTx.find(tx.GetHash());
-    const CTxMemPool::setEntries &setChildren = mempool.GetMemPoolChildren(it);
-    for (CTxMemPool::txiter childiter : setChildren) {
-        spent.push_back(childiter->GetTx().GetHash().ToString());
+    for (const CTxMemPoolEntry* child : mempool.GetMemPoolChildren(it)) {
+        spent.push_back(child->GetTx().GetHash().ToString());
     }
 
     info.pushKV("spentby", spent);
@@ -2035,6 +2040,78 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"dumptxoutset",
+                "\nWrite the UTXO set at the chain tip to a snapshot file, which new nodes can load with\n"
+                "-loadutxosnapshot once its hash is pinned in the chain parameters.\n"
+                "To dump the UTXO set at an earlier height, roll the chain back with invalidateblock first.\n"
+                "Note this call may take some time.\n",
+                {
+                    {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
+                },
+                RPCResult{
+            "{\n"
+            "  \"coins_written\" : n,          (numeric) The number of coins written to the snapshot\n"
+            "  \"base_hash\" : \"hash\",        (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\" : n,            (numeric) The height of the block the snapshot was taken at\n"
+            "  \"hash_serialized\" : \"hash\",  (string) The content hash of the snapshot, as pinned in the chain parameters\n"
+            "  \"path\" : \"path\"              (string) The absolute path of the snapshot\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("dumptxoutset", "utxo.dat")
+            + HelpExampleRpc("dumptxoutset", "utxo.dat")
+                },
+            }.ToString());
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    // Write to a temporary path and move it into place once complete
+    const fs::path temppath = fs::absolute(request.params[0].get_str() + ".incomplete", GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists. If you are sure this is what you want, move it out of the way first");
+    }
+
+    CAutoFile file(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to open " + temppath.string() + " for writing");
+    }
+
+    // The cursor reads the coin database as of its creation, the chain can
+    // move on while the coins are written.
+    std::unique_ptr<CCoinsViewCursor> cursor;
+    const CBlockIndex* base;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        cursor.reset(pcoinsdbview->Cursor());
+        base = LookupBlockIndex(cursor->GetBestBlock());
+    }
+    if (!base) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to find the block of the UTXO set");
+    }
+
+    uint64_t coins_written;
+    uint256 hash;
+    if (!DumpUTXOSnapshot(*cursor, base, file, coins_written, hash)) {
+        file.fclose();
+        fs::remove(temppath);
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to write the UTXO snapshot");
+    }
+    file.fclose();
+    fs::rename(temppath, path);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("coins_written", coins_written);
+    result.pushKV("base_hash", base->GetBlockHash().GetHex());
+    result.pushKV("base_height", base->nHeight);
+    result.pushKV("hash_serialized", hash.GetHex());
+    result.pushKV("path", path.string());
+    return result;
+}
+
 static UniValue savemempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0) {
@@ -2289,6 +2366,494 @@ UniValue scantxoutset(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue addressHistoryToJSON(const std::vector<AddressHistoryEntry>& entries)
+{
+    UniValue result(UniValue::VARR);
+    for (const AddressHistoryEntry& entry : entries) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", entry.key.txid.GetHex());
+        obj.pushKV("height", entry.key.height);
+        obj.pushKV(entry.key.spending ? "vin" : "vout", static_cast<int64_t>(entry.key.index));
+        obj.pushKV("amount", ValueFromAmount(entry.amount));
+        result.push_back(obj);
+    }
+    return result;
+}
+
+UniValue addressUnspentToJSON(const std::vector<AddressUnspentEntry>& entries)
+{
+    UniValue result(UniValue::VARR);
+    for (const AddressUnspentEntry& entry : entries) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", entry.outpoint.hash.GetHex());
+        obj.pushKV("vout", static_cast<int64_t>(entry.outpoint.n));
+        obj.pushKV("amount", ValueFromAmount(entry.amount));
+        obj.pushKV("height", entry.height);
+        result.push_back(obj);
+    }
+    return result;
+}
+
+/** Address index key of an address argument, waits for the index to catch up. */
+static uint256 AddressIndexKey(const UniValue& address)
+{
+    if (!g_addressindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is not enabled, restart with -addressindex");
+    }
+    const CTxDestination dest = DecodeDestination(address.get_str());
+    if (!IsValidDestination(dest)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+    if (!g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is still syncing, try again later");
+    }
+    return AddressIndex::GetScriptHash(GetScriptForDestination(dest));
+}
+
+static UniValue getaddresshistory(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddresshistory",
+                "\nReturns the outputs received and spent by an address, oldest first. Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                    {"start_height", RPCArg::Type::NUM, /* default */ "0", "First block height to include"},
+                    {"end_height", RPCArg::Type::NUM, /* default */ "chain tip", "Last block height to include"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"hash\",      (string) The transaction id\n"
+            "    \"height\" : n,         (numeric) The block height\n"
+            "    \"vout\" : n,           (numeric) The output index, if the address received coins\n"
+            "    \"vin\" : n,            (numeric) The input index, if the address spent coins\n"
+            "    \"amount\" : x.xxx      (numeric) The amount in " + CURRENCY_UNIT + ", negative if spent\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddresshistory", "\"address\"")
+            + HelpExampleCli("getaddresshistory", "\"address\" 1000 2000")
+            + HelpExampleRpc("getaddresshistory", "\"address\", 1000, 2000")
+                },
+            }.ToString());
+
+    const uint256 script_hash = AddressIndexKey(request.params[0]);
+
+    int start_height = 0;
+    int end_height = std::numeric_limits<int>::max();
+    if (!request.params[1].isNull()) {
+        start_height = request.params[1].get_int();
+    }
+    if (!request.params[2].isNull()) {
+        end_height = request.params[2].get_int();
+    }
+    if (start_height < 0 || end_height < start_height) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height range");
+    }
+
+    std::vector<AddressHistoryEntry> entries;
+    if (!g_addressindex->FindHistory(script_hash, start_height, end_height, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+    }
+    return addressHistoryToJSON(entries);
+}
+
+static UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddressutxos",
+                "\nReturns the unspent outputs of an address in the best chain. Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"hash\",      (string) The transaction id\n"
+            "    \"vout\" : n,           (numeric) The output index\n"
+            "    \"amount\" : x.xxx,     (numeric) The amount in " + CURRENCY_UNIT + "\n"
+            "    \"height\" : n          (numeric) The block height of the output\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressutxos", "\"address\"")
+            + HelpExampleRpc("getaddressutxos", "\"address\"")
+                },
+            }.ToString());
+
+    const uint256 script_hash = AddressIndexKey(request.params[0]);
+
+    std::vector<AddressUnspentEntry> entries;
+    if (!g_addressindex->FindUnspent(script_hash, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+    }
+    return addressUnspentToJSON(entries);
+}
+
+static UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getaddressbalance",
+                "\nReturns the confirmed balance of an address. Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"balance\" : x.xxx,     (numeric) The sum of the unspent outputs in " + CURRENCY_UNIT + "\n"
+            "  \"utxos\" : n            (numeric) The number of unspent outputs\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddressbalance", "\"address\"")
+            + HelpExampleRpc("getaddressbalance", "\"address\"")
+                },
+            }.ToString());
+
+    const uint256 script_hash = AddressIndexKey(request.params[0]);
+
+    std::vector<AddressUnspentEntry> entries;
+    if (!g_addressindex->FindUnspent(script_hash, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+    }
+    CAmount balance = 0;
+    for (const AddressUnspentEntry& entry : entries) {
+        balance += entry.amount;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("balance", ValueFromAmount(balance));
+    result.pushKV("utxos", static_cast<uint64_t>(entries.size()));
+    return result;
+}
+
+static UniValue getspentinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getspentinfo",
+                "\nReturns the input that spent a transaction output in the best chain. Requires -spentindex.\n",
+                {
+                    {"txid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The transaction id"},
+                    {"n", RPCArg::Type::NUM, RPCArg::Optional::NO, "The output number"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"txid\" : \"hash\",      (string) The spending transaction id\n"
+            "  \"vin\" : n,             (numeric) The input index in the spending transaction\n"
+            "  \"height\" : n           (numeric) The height of the block containing the spending transaction\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getspentinfo", "\"txid\" 1")
+            + HelpExampleRpc("getspentinfo", "\"txid\", 1")
+                },
+            }.ToString());
+
+    if (!g_spentindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index is not enabled, restart with -spentindex");
+    }
+    const uint256 txid = ParseHashV(request.params[0], "txid");
+    const int n = request.params[1].get_int();
+    if (n < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid output number");
+    }
+    if (!g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index is still syncing, try again later");
+    }
+
+    SpentIndexValue value;
+    if (!g_spentindex->FindSpend(COutPoint(txid, n), value)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Output is unspent or unknown");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("txid", value.txid.GetHex());
+    result.pushKV("vin", static_cast<uint64_t>(value.vin));
+    result.pushKV("height", value.height);
+    return result;
+}
+
+static UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getblockfilter",
+                "\nRetrieve a BIP 157 content filter for a particular block. Requires -blockfilterindex.\n",
+                {
+                    {"blockhash", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The hash of the block"},
+                    {"filtertype", RPCArg::Type::STR, /* default */ "basic", "The type name of the filter"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"filter\" : (string) the hex-encoded filter data\n"
+            "  \"header\" : (string) the hex-encoded filter header\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+                },
+            }.ToString());
+
+    uint256 block_hash = ParseHashV(request.params[0], "blockhash");
+    std::string filtertype_name = "basic";
+    if (!request.params[1].isNull()) {
+        filtertype_name = request.params[1].get_str();
+    }
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(filtertype_name, filtertype)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+    }
+
+    BlockFilterIndex* index = g_blockfilterindex.get();
+    if (!index || index->GetFilterType() != filtertype) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + filtertype_name);
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = index->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!index->LookupFilter(block_index, filter) ||
+        !index->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
+}
+
+static UniValue getblockattime(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getblockattime",
+                "\nReturns the block that was the tip of the best chain at a time, i.e. the highest block\n"
+                "whose time and the times of all its ancestors are not after the timestamp.\n"
+                "Uses the timestamp index if enabled with -timestampindex.\n",
+                {
+                    {"timestamp", RPCArg::Type::NUM, RPCArg::Optional::NO, "The UNIX epoch time"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"height\" : n,         (numeric) The block height\n"
+            "  \"hash\" : \"hash\",     (string) The block hash\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getblockattime", "1559347200")
+            + HelpExampleRpc("getblockattime", "1559347200")
+                },
+            }.ToString());
+
+    const int64_t timestamp = request.params[0].get_int64();
+
+    int height;
+    uint256 hash;
+    if (g_timestampindex && g_timestampindex->BlockUntilSyncedToCurrentChain() &&
+        g_timestampindex->FindBlockAtTime(timestamp, height) && g_timestampindex->LookupBlockHash(height, hash)) {
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("height", height);
+        result.pushKV("hash", hash.GetHex());
+        return result;
+    }
+
+    LOCK(cs_main);
+    const CBlockIndex* pindex = timestamp < std::numeric_limits<int64_t>::max() ? chainActive.FindEarliestAtLeast(timestamp + 1) : nullptr;
+    pindex = pindex ? pindex->pprev : chainActive.Tip();
+    if (!pindex) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Timestamp is before the genesis block");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("height", pindex->nHeight);
+    result.pushKV("hash", pindex->GetBlockHash().GetHex());
+    return result;
+}
+
+static UniValue IndexSummaryToJSON(const IndexSummary& summary)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("synced", summary.synced);
+    ret.pushKV("best_block_height", summary.best_block_height);
+    ret.pushKV("sync_threads", summary.sync_threads);
+    ret.pushKV("blocks_synced", summary.blocks_synced);
+    ret.pushKV("blocks_per_second", summary.blocks_per_second);
+    return ret;
+}
+
+static UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            RPCHelpMan{"getindexinfo",
+                "\nReturns the status of the enabled indexes and the throughput of their last sync.\n",
+                {},
+                RPCResult{
+            "{\n"
+            "  \"name\" : {                  (json object) The name of the index\n"
+            "    \"synced\" : true|false,     (boolean) Whether the index is synced with the best chain\n"
+            "    \"best_block_height\" : n,   (numeric) The height of the last indexed block\n"
+            "    \"sync_threads\" : n,        (numeric) The number of threads that read blocks during the last sync\n"
+            "    \"blocks_synced\" : n,       (numeric) The number of blocks indexed by the last sync\n"
+            "    \"blocks_per_second\" : x.x  (numeric) The throughput of the last sync\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+                },
+            }.ToString());
+
+    UniValue result(UniValue::VOBJ);
+    if (g_txindex) {
+        const IndexSummary summary = g_txindex->GetSummary();
+        result.pushKV(summary.name, IndexSummaryToJSON(summary));
+    }
+    if (g_addressindex) {
+        const IndexSummary summary = g_addressindex->GetSummary();
+        result.pushKV(summary.name, IndexSummaryToJSON(summary));
+    }
+    if (g_spentindex) {
+        const IndexSummary summary = g_spentindex->GetSummary();
+        result.pushKV(summary.name, IndexSummaryToJSON(summary));
+    }
+    if (g_blockfilterindex) {
+        const IndexSummary summary = g_blockfilterindex->GetSummary();
+        result.pushKV(summary.name, IndexSummaryToJSON(summary));
+    }
+    if (g_timestampindex) {
+        const IndexSummary summary = g_timestampindex->GetSummary();
+        result.pushKV(summary.name, IndexSummaryToJSON(summary));
+    }
+    return result;
+}
+
+static UniValue compactdatabase(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            RPCHelpMan{"compactdatabase",
+                "\nStarts compacting a database in the background. LevelDB compacts on its own as data is written,\n"
+                "a full compaction drops the overwritten and deleted records and shortens lookups.\n"
+                "The progress is reported by getdatabaseinfo.\n",
+                {
+                    {"database", RPCArg::Type::STR, /* default */ "chainstate", "The database to compact, chainstate or blockindex"},
+                },
+                RPCResults{},
+                RPCExamples{
+                    HelpExampleCli("compactdatabase", "")
+            + HelpExampleCli("compactdatabase", "\"blockindex\"")
+            + HelpExampleRpc("compactdatabase", "\"chainstate\"")
+                },
+            }.ToString());
+
+    const std::string name = request.params[0].isNull() ? "chainstate" : request.params[0].get_str();
+    if (!g_db_compactor) {
+        throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, "The databases are not loaded yet");
+    }
+    std::string error;
+    if (!g_db_compactor->Start(name, error)) {
+        throw JSONRPCError(RPC_MISC_ERROR, error);
+    }
+    return NullUniValue;
+}
+
+static UniValue getdatabaseinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            RPCHelpMan{"getdatabaseinfo",
+                "\nReturns the tuning profile, the size and the compaction status of the databases.\n",
+                {},
+                RPCResult{
+            "{\n"
+            "  \"name\" : {                        (json object) The name of the database\n"
+            "    \"profile\" : \"str\",              (string) The tuning profile, see -dbprofile\n"
+            "    \"estimated_size\" : n,            (numeric) The estimated size of the table files in bytes\n"
+            "    \"compacting\" : true|false,       (boolean) Whether a compaction is running\n"
+            "    \"progress\" : x.x,                (numeric) The compacted fraction of the running or last compaction\n"
+            "    \"last_compaction_start\" : ttt,   (numeric, optional) The UNIX epoch time the last compaction started\n"
+            "    \"last_compaction_end\" : ttt,     (numeric, optional) The UNIX epoch time the last compaction ended\n"
+            "    \"last_compaction_completed\" : true|false (boolean, optional) Whether the last compaction ran to the end\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getdatabaseinfo", "")
+            + HelpExampleRpc("getdatabaseinfo", "")
+                },
+            }.ToString());
+
+    if (!g_db_compactor) {
+        throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, "The databases are not loaded yet");
+    }
+
+    const std::map<std::string, DBCompactionStatus> statuses = g_db_compactor->GetStatus();
+    UniValue result(UniValue::VOBJ);
+    for (const std::string& name : DBCompactor::GetNames()) {
+        CDBWrapper* db;
+        {
+            LOCK(cs_main);
+            db = name == "chainstate" ? &pcoinsdbview->GetDB() : pblocktree.get();
+        }
+        const DBCompactionStatus& status = statuses.at(name);
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("profile", db->GetProfile().name);
+        entry.pushKV("estimated_size", (uint64_t)db->EstimateTotalSize());
+        entry.pushKV("compacting", status.running);
+        entry.pushKV("progress", status.progress);
+        if (status.last_start > 0) {
+            entry.pushKV("last_compaction_start", status.last_start);
+        }
+        if (status.last_end > 0) {
+            entry.pushKV("last_compaction_end", status.last_end);
+            entry.pushKV("last_compaction_completed", status.last_completed);
+        }
+        result.pushKV(name, entry);
+    }
+    return result;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2312,11 +2877,22 @@ static const CRPCCommand commands[] =
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           {"path"} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
 
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
 
+    { "blockchain",         "getaddressbalance",      &getaddressbalance,      {"address"} },
+    { "blockchain",         "getaddresshistory",      &getaddresshistory,      {"address","start_height","end_height"} },
+    { "blockchain",         "getaddressutxos",        &getaddressutxos,        {"address"} },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           {"txid","n"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
+    { "blockchain",         "getblockattime",         &getblockattime,         {"timestamp"} },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           {} },
+    { "blockchain",         "getdatabaseinfo",        &getdatabaseinfo,        {} },
+    { "blockchain",         "compactdatabase",        &compactdatabase,        {"database"} },
+
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
     { "hidden",             "reconsiderblock",        &reconsiderblock,        {"blockhash"} },
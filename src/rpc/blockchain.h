@@ -12,6 +12,8 @@
 class CBlock;
 class CBlockIndex;
 class UniValue;
+struct AddressHistoryEntry;
+struct AddressUnspentEntry;
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
 
@@ -38,6 +40,12 @@ UniValue mempoolToJSON(bool fVerbose = false);
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex);
 
+/** Address index history to JSON */
+UniValue addressHistoryToJSON(const std::vector<AddressHistoryEntry>& entries);
+
+/** Address index unspent outputs to JSON */
+UniValue addressUnspentToJSON(const std::vector<AddressUnspentEntry>& entries);
+
 /** Used by getblockstats to get feerates at different percentiles by weight  */
 void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
 
@@ -0,0 +1,154 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <stddef.h>
+
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * Hands out small blocks carved from large chunks, with a free list per
+ * block size. Node based containers allocate one block per element, pooling
+ * them saves the per allocation overhead of malloc and keeps the nodes of a
+ * container close together. Freed blocks are reused by later allocations of
+ * the same size, chunks are only released when the resource is destroyed.
+ * Blocks larger than MAX_BLOCK_SIZE are allocated with operator new.
+ *
+ * Not thread safe, the owner serializes allocations.
+ */
+class PoolResource
+{
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static const size_t ALIGN = alignof(FreeBlock);
+    static const size_t MAX_BLOCK_SIZE = 512;
+    static const size_t CHUNK_SIZE = 256 << 10;
+
+    //! Free blocks by size / ALIGN
+    std::vector<FreeBlock*> m_free_lists;
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char* m_chunk_pos{nullptr};
+    char* m_chunk_end{nullptr};
+    size_t m_bytes_in_use{0};
+
+    static bool IsPooled(size_t bytes, size_t alignment)
+    {
+        return bytes <= MAX_BLOCK_SIZE && alignment <= ALIGN;
+    }
+
+    static size_t BlockSize(size_t bytes)
+    {
+        return bytes < ALIGN ? ALIGN : (bytes + ALIGN - 1) / ALIGN * ALIGN;
+    }
+
+    void PushFree(void* p, size_t size)
+    {
+        FreeBlock*& head = m_free_lists[size / ALIGN];
+        head = new (p) FreeBlock{head};
+    }
+
+public:
+    PoolResource() : m_free_lists(MAX_BLOCK_SIZE / ALIGN + 1, nullptr) {}
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    void* Allocate(size_t bytes, size_t alignment)
+    {
+        if (!IsPooled(bytes, alignment)) {
+            void* p = ::operator new(bytes);
+            m_bytes_in_use += bytes;
+            return p;
+        }
+        const size_t size = BlockSize(bytes);
+        FreeBlock*& head = m_free_lists[size / ALIGN];
+        void* p = head;
+        if (head) {
+            head = head->next;
+        } else {
+            if (static_cast<size_t>(m_chunk_end - m_chunk_pos) < size) {
+                // The rest of the current chunk is smaller than the largest
+                // block size, keep it for a smaller block
+                if (m_chunk_pos != m_chunk_end) {
+                    PushFree(m_chunk_pos, m_chunk_end - m_chunk_pos);
+                }
+                m_chunks.emplace_back(new char[CHUNK_SIZE]);
+                m_chunk_pos = m_chunks.back().get();
+                m_chunk_end = m_chunk_pos + CHUNK_SIZE;
+            }
+            p = m_chunk_pos;
+            m_chunk_pos += size;
+        }
+        m_bytes_in_use += size;
+        return p;
+    }
+
+    void Deallocate(void* p, size_t bytes, size_t alignment) noexcept
+    {
+        if (!IsPooled(bytes, alignment)) {
+            ::operator delete(p);
+            m_bytes_in_use -= bytes;
+            return;
+        }
+        const size_t size = BlockSize(bytes);
+        PushFree(p, size);
+        m_bytes_in_use -= size;
+    }
+
+    //! Bytes of the blocks handed out and not freed yet.
+    size_t BytesInUse() const { return m_bytes_in_use; }
+    //! Bytes of the chunks the blocks are carved from.
+    size_t ChunkBytes() const { return m_chunks.size() * CHUNK_SIZE; }
+};
+
+/** Stateful allocator for node based containers, allocating from a PoolResource. */
+template <typename T>
+class PoolAllocator
+{
+private:
+    PoolResource* m_resource;
+
+    template <typename U>
+    friend class PoolAllocator;
+
+public:
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind {
+        typedef PoolAllocator<U> other;
+    };
+
+    explicit PoolAllocator(PoolResource& resource) noexcept : m_resource(&resource) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : m_resource(other.m_resource) {}
+
+    T* allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const noexcept { return m_resource == other.m_resource; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const noexcept { return m_resource != other.m_resource; }
+};
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
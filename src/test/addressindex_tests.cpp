@@ -0,0 +1,112 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/addressindex.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+static size_t CountOutputs(const std::vector<CTransactionRef>& txns, const CScript& script)
+{
+    size_t n = 0;
+    for (const auto& tx : txns) {
+        for (const auto& out : tx->vout) {
+            if (out.scriptPubKey == script) ++n;
+        }
+    }
+    return n;
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_sync_and_reorg, TestChain100Setup)
+{
+    AddressIndex index(1 << 20, true);
+
+    const CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const uint256 script_hash = AddressIndex::GetScriptHash(coinbase_script);
+    const size_t expected = CountOutputs(m_coinbase_txns, coinbase_script);
+    BOOST_REQUIRE(expected > 0);
+
+    std::vector<AddressUnspentEntry> unspent;
+    std::vector<AddressHistoryEntry> history;
+
+    // Nothing is indexed before the index is started.
+    BOOST_CHECK(index.FindUnspent(script_hash, unspent));
+    BOOST_CHECK(unspent.empty());
+    BOOST_CHECK(!index.BlockUntilSyncedToCurrentChain());
+
+    index.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    BOOST_CHECK(index.FindUnspent(script_hash, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), expected);
+    BOOST_CHECK(index.FindHistory(script_hash, 0, std::numeric_limits<int>::max(), history));
+    BOOST_CHECK_EQUAL(history.size(), expected);
+    for (size_t i = 1; i < history.size(); ++i) {
+        BOOST_CHECK(history[i - 1].key.height <= history[i].key.height);
+        BOOST_CHECK(!history[i].key.spending);
+        BOOST_CHECK(history[i].amount > 0);
+    }
+
+    // Height range lookups
+    history.clear();
+    BOOST_CHECK(index.FindHistory(script_hash, 1, 10, history));
+    for (const auto& entry : history) {
+        BOOST_CHECK(entry.key.height >= 1 && entry.key.height <= 10);
+    }
+
+    // New blocks are indexed through the validation interface.
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript other_script = GetScriptForDestination(other_key.GetPubKey().GetID());
+    const uint256 other_hash = AddressIndex::GetScriptHash(other_script);
+    std::vector<CMutableTransaction> no_txns;
+    const CBlock block = CreateAndProcessBlock(no_txns, other_script);
+    SyncWithValidationInterfaceQueue();
+
+    unspent.clear();
+    BOOST_CHECK(index.FindUnspent(other_hash, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), CountOutputs({block.vtx[0]}, other_script));
+
+    // Disconnected blocks are removed from the index.
+    {
+        CValidationState state;
+        CBlockIndex* tip;
+        {
+            LOCK(cs_main);
+            tip = chainActive.Tip();
+        }
+        BOOST_CHECK(InvalidateBlock(state, Params(), tip));
+        BOOST_CHECK(ActivateBestChain(state, Params()));
+    }
+    SyncWithValidationInterfaceQueue();
+
+    unspent.clear();
+    history.clear();
+    BOOST_CHECK(index.FindUnspent(other_hash, unspent));
+    BOOST_CHECK(index.FindHistory(other_hash, 0, std::numeric_limits<int>::max(), history));
+    BOOST_CHECK(unspent.empty());
+    BOOST_CHECK(history.empty());
+
+    unspent.clear();
+    BOOST_CHECK(index.FindUnspent(script_hash, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), expected);
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
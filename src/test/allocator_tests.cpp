@@ -4,9 +4,11 @@
 
 #include <util/system.h>
 
+#include <support/allocators/pool.h>
 #include <support/allocators/secure.h>
 #include <test/test_bitcoin.h>
 
+#include <map>
 #include <memory>
 
 #include <boost/test/unit_test.hpp>
@@ -233,4 +235,42 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+BOOST_AUTO_TEST_CASE(pool_resource_tests)
+{
+    PoolResource resource;
+    {
+        typedef std::map<int, int, std::less<int>, PoolAllocator<std::pair<const int, int>>> PoolMap;
+        PoolMap map{std::less<int>(), PoolMap::allocator_type(resource)};
+        for (int i = 0; i < 100000; ++i) {
+            map.emplace(i, i);
+        }
+        const size_t used = resource.BytesInUse();
+        const size_t chunks = resource.ChunkBytes();
+        BOOST_CHECK(used >= map.size() * (sizeof(PoolMap::value_type) + 3 * sizeof(void*)));
+        BOOST_CHECK(chunks >= used);
+
+        // Freed nodes are reused without new chunks
+        for (int i = 0; i < 100000; i += 2) {
+            map.erase(i);
+        }
+        BOOST_CHECK(resource.BytesInUse() < used);
+        for (int i = 0; i < 100000; i += 2) {
+            map.emplace(i, -i);
+        }
+        BOOST_CHECK_EQUAL(resource.BytesInUse(), used);
+        BOOST_CHECK_EQUAL(resource.ChunkBytes(), chunks);
+        for (int i = 0; i < 100000; ++i) {
+            BOOST_CHECK_EQUAL(map.at(i), i % 2 ? i : -i);
+        }
+    }
+    BOOST_CHECK_EQUAL(resource.BytesInUse(), 0U);
+
+    // Large blocks are allocated with operator new but counted
+    PoolAllocator<char> alloc(resource);
+    char* large = alloc.allocate(4096);
+    BOOST_CHECK_EQUAL(resource.BytesInUse(), 4096U);
+    alloc.deallocate(large, 4096);
+    BOOST_CHECK_EQUAL(resource.BytesInUse(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,99 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <node/blockcache.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <validation.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockcache_tests)
+
+static std::vector<unsigned char> SerializeBlock(const CBlockIndex* pindex, int flags)
+{
+    CBlock block;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | flags);
+    ss << block;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(blockcache_get, TestChain100Setup)
+{
+    const CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    BlockCache cache(1 << 20);
+
+    const CSharedNetMsg msg = cache.Get(tip, true, Params());
+    BOOST_REQUIRE(!msg.IsNull());
+    BOOST_CHECK_EQUAL(msg.command, NetMsgType::BLOCK);
+    BOOST_CHECK(*msg.data == SerializeBlock(tip, 0));
+    BOOST_CHECK_EQUAL(cache.Misses(), 1U);
+
+    // The cached buffers are shared
+    const CSharedNetMsg cached = cache.Get(tip, true, Params());
+    BOOST_CHECK(cached.data == msg.data);
+    BOOST_CHECK(cached.header == msg.header);
+    BOOST_CHECK_EQUAL(cache.Hits(), 1U);
+
+    // Blocks without witness data are cached separately
+    const CSharedNetMsg no_witness = cache.Get(tip, false, Params());
+    BOOST_REQUIRE(!no_witness.IsNull());
+    BOOST_CHECK(*no_witness.data == SerializeBlock(tip, SERIALIZE_TRANSACTION_NO_WITNESS));
+    BOOST_CHECK(no_witness.data != msg.data);
+    BOOST_CHECK_EQUAL(cache.Count(), 2U);
+
+    // The header matches the one of an uncached message
+    const CSharedNetMsg uncached = ReadBlockMsg(tip, true, Params());
+    BOOST_CHECK(*uncached.header == *msg.header);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Count(), 0U);
+    BOOST_CHECK_EQUAL(cache.Bytes(), 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(blockcache_evict, TestChain100Setup)
+{
+    const CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    size_t entry_bytes;
+    {
+        BlockCache cache(1 << 20);
+        BOOST_REQUIRE(!cache.Get(tip, true, Params()).IsNull());
+        entry_bytes = cache.Bytes();
+    }
+
+    // Room for two blocks of about the same size
+    const size_t max_bytes = entry_bytes * 5 / 2;
+    BlockCache cache(max_bytes);
+
+    const CSharedNetMsg first = cache.Get(tip, true, Params());
+    cache.Get(tip->pprev, true, Params());
+    // Using the first block makes the second one the least recently used
+    cache.Get(tip, true, Params());
+    cache.Get(tip->pprev->pprev, true, Params());
+    BOOST_CHECK_EQUAL(cache.Count(), 2U);
+    BOOST_CHECK(cache.Bytes() <= max_bytes);
+
+    BOOST_CHECK(cache.Get(tip, true, Params()).data == first.data);
+    const uint64_t misses = cache.Misses();
+    cache.Get(tip->pprev, true, Params());
+    BOOST_CHECK_EQUAL(cache.Misses(), misses + 1);
+
+    // Blocks larger than the cache are not cached
+    BlockCache small(1);
+    BOOST_CHECK(!small.Get(tip, true, Params()).IsNull());
+    BOOST_CHECK_EQUAL(small.Count(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include <blockencodings.h>
 #include <consensus/merkle.h>
 #include <chainparams.h>
+#include <core_memusage.h>
 #include <pow.h>
 #include <random.h>
 
@@ -321,6 +322,91 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CoinstakePrefilledTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildBlockTestCase());
+
+    CMutableTransaction coinstake;
+    coinstake.vin.resize(1);
+    coinstake.vin[0].prevout = COutPoint(InsecureRand256(), 1);
+    coinstake.vout.resize(2);
+    coinstake.vout[0].nValue = 0;
+    coinstake.vout[1].nValue = 42;
+    block.vtx[1] = MakeTransactionRef(coinstake);
+    BOOST_REQUIRE(block.IsProofOfStake());
+
+    LOCK2(cs_main, pool.cs);
+    pool.addUnchecked(entry.FromTx(block.vtx[2]));
+
+    // The coinbase and the coinstake are sent with the short ids
+    TestHeaderAndShortIDs shortIDs(block);
+    BOOST_CHECK_EQUAL(shortIDs.prefilledtxn.size(), 2U);
+    BOOST_CHECK_EQUAL(shortIDs.shorttxids.size(), 1U);
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << shortIDs;
+    CBlockHeaderAndShortTxIDs shortIDs2;
+    stream >> shortIDs2;
+
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn) == READ_STATUS_OK);
+    BOOST_CHECK(partialBlock.IsTxAvailable(0));
+    BOOST_CHECK(partialBlock.IsTxAvailable(1));
+    BOOST_CHECK(partialBlock.IsTxAvailable(2));
+}
+
+BOOST_AUTO_TEST_CASE(ExtraTxnPoolTest)
+{
+    CTxMemPool pool;
+    CBlock block(BuildBlockTestCase());
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i < 4; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        txs.push_back(MakeTransactionRef(tx));
+    }
+
+    // The oldest transaction is dropped once the pool is full, a transaction
+    // is kept once
+    ExtraTxnPool extra_pool(3, 1000000);
+    for (const auto& tx : txs) {
+        extra_pool.Add(tx);
+        extra_pool.Add(tx);
+    }
+    BOOST_CHECK_EQUAL(extra_pool.Count(), 3U);
+    size_t found = 0;
+    for (const auto& extra : extra_pool.Get()) {
+        BOOST_CHECK(extra.second != txs[0]);
+        if (extra.second) found++;
+    }
+    BOOST_CHECK_EQUAL(found, 3U);
+
+    // Memory limit
+    const size_t tx_bytes = RecursiveDynamicUsage(txs[0]);
+    ExtraTxnPool small_pool(10, 2 * tx_bytes);
+    for (const auto& tx : txs) {
+        small_pool.Add(tx);
+    }
+    BOOST_CHECK_EQUAL(small_pool.Count(), 2U);
+    BOOST_CHECK(small_pool.Bytes() <= 2 * tx_bytes);
+
+    // Block reconstruction finds the transaction of the block in the pool
+    extra_pool.Add(block.vtx[2]);
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(CBlockHeaderAndShortTxIDs(block, true), extra_pool.Get()) == READ_STATUS_OK);
+    BOOST_CHECK(partialBlock.IsTxAvailable(2));
+    BOOST_CHECK_EQUAL(partialBlock.ExtraTxnCount(), 1U);
+    extra_pool.RecordBlock(partialBlock.ExtraTxnCount());
+    BOOST_CHECK_EQUAL(extra_pool.Blocks(), 1U);
+    BOOST_CHECK_EQUAL(extra_pool.BlocksHit(), 1U);
+    BOOST_CHECK_EQUAL(extra_pool.TxnHit(), 1U);
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
@@ -0,0 +1,165 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilter.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/blockfilterindex.h>
+#include <test/test_bitcoin.h>
+#include <undo.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockfilter_index_tests)
+
+static bool CheckFilterLookups(BlockFilterIndex& filter_index, const CBlockIndex* block_index,
+                               uint256& last_header)
+{
+    BlockFilter expected_filter;
+    {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, block_index, Params().GetConsensus())) return false;
+        if (block_index->nHeight > 0 && !UndoReadFromDisk(block_undo, block_index)) return false;
+        expected_filter = BlockFilter(filter_index.GetFilterType(), block, block_undo);
+    }
+
+    BlockFilter filter;
+    uint256 filter_header;
+    std::vector<BlockFilter> filters;
+    std::vector<uint256> filter_hashes;
+
+    BOOST_CHECK(filter_index.LookupFilter(block_index, filter));
+    BOOST_CHECK(filter_index.LookupFilterHeader(block_index, filter_header));
+    BOOST_CHECK(filter_index.LookupFilterRange(block_index->nHeight, block_index, filters));
+    BOOST_CHECK(filter_index.LookupFilterHashRange(block_index->nHeight, block_index,
+                                                   filter_hashes));
+
+    BOOST_CHECK_EQUAL(filters.size(), 1U);
+    BOOST_CHECK_EQUAL(filter_hashes.size(), 1U);
+
+    BOOST_CHECK_EQUAL(filter.GetHash(), expected_filter.GetHash());
+    BOOST_CHECK_EQUAL(filter_header, expected_filter.ComputeHeader(last_header));
+    BOOST_CHECK_EQUAL(filters[0].GetHash(), expected_filter.GetHash());
+    BOOST_CHECK_EQUAL(filter_hashes[0], expected_filter.GetHash());
+
+    filters.clear();
+    filter_hashes.clear();
+    last_header = filter_header;
+    return true;
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_initial_sync, TestChain100Setup)
+{
+    BlockFilterIndex filter_index(BlockFilterType::BASIC, 1 << 20, true);
+
+    uint256 last_header;
+
+    // Filter should not be found in the index before it is started.
+    {
+        LOCK(cs_main);
+
+        BlockFilter filter;
+        uint256 filter_header;
+        std::vector<BlockFilter> filters;
+        std::vector<uint256> filter_hashes;
+
+        for (const CBlockIndex* block_index = chainActive.Genesis();
+             block_index != nullptr;
+             block_index = chainActive.Next(block_index)) {
+            BOOST_CHECK(!filter_index.LookupFilter(block_index, filter));
+            BOOST_CHECK(!filter_index.LookupFilterHeader(block_index, filter_header));
+            BOOST_CHECK(!filter_index.LookupFilterRange(block_index->nHeight, block_index, filters));
+            BOOST_CHECK(!filter_index.LookupFilterHashRange(block_index->nHeight, block_index,
+                                                            filter_hashes));
+        }
+    }
+
+    // BlockUntilSyncedToCurrentChain should return false before index is started.
+    BOOST_CHECK(!filter_index.BlockUntilSyncedToCurrentChain());
+
+    filter_index.Start();
+
+    // Allow filter index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Check that filter index has all blocks that were in the chain before it started.
+    {
+        LOCK(cs_main);
+        const CBlockIndex* block_index;
+        for (block_index = chainActive.Genesis();
+             block_index != nullptr;
+             block_index = chainActive.Next(block_index)) {
+            BOOST_CHECK(CheckFilterLookups(filter_index, block_index, last_header));
+        }
+    }
+
+    // Range lookups return one filter per block of the chain.
+    {
+        const CBlockIndex* tip;
+        {
+            LOCK(cs_main);
+            tip = chainActive.Tip();
+        }
+        std::vector<BlockFilter> filters;
+        std::vector<uint256> filter_hashes;
+        BOOST_CHECK(filter_index.LookupFilterRange(0, tip, filters));
+        BOOST_CHECK(filter_index.LookupFilterHashRange(0, tip, filter_hashes));
+        BOOST_CHECK_EQUAL(filters.size(), static_cast<size_t>(tip->nHeight + 1));
+        BOOST_CHECK_EQUAL(filter_hashes.size(), static_cast<size_t>(tip->nHeight + 1));
+        BOOST_CHECK(filters.back().GetBlockHash() == tip->GetBlockHash());
+    }
+
+    // Disconnect the tip and connect a replacement. The filter of the stale
+    // block is still served by hash, the new block is indexed by height.
+    const CBlockIndex* stale_index;
+    {
+        CValidationState state;
+        CBlockIndex* tip;
+        {
+            LOCK(cs_main);
+            tip = chainActive.Tip();
+        }
+        stale_index = tip;
+        BOOST_CHECK(InvalidateBlock(state, Params(), tip));
+        BOOST_CHECK(ActivateBestChain(state, Params()));
+    }
+    SyncWithValidationInterfaceQueue();
+
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript other_script = CScript() << ToByteVector(other_key.GetPubKey()) << OP_CHECKSIG;
+    std::vector<CMutableTransaction> no_txns;
+    CreateAndProcessBlock(no_txns, other_script);
+    SyncWithValidationInterfaceQueue();
+
+    {
+        BlockFilter filter;
+        BOOST_CHECK(filter_index.LookupFilter(stale_index, filter));
+        BOOST_CHECK(filter.GetBlockHash() == stale_index->GetBlockHash());
+
+        const CBlockIndex* tip;
+        {
+            LOCK(cs_main);
+            tip = chainActive.Tip();
+        }
+        BOOST_CHECK(tip != stale_index);
+        uint256 prev_header;
+        BOOST_CHECK(filter_index.LookupFilterHeader(tip->pprev, prev_header));
+        BOOST_CHECK(CheckFilterLookups(filter_index, tip, prev_header));
+    }
+
+    filter_index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
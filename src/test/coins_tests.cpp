@@ -7,6 +7,7 @@
 #include <consensus/validation.h>
 #include <script/standard.h>
 #include <test/test_bitcoin.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
@@ -858,4 +859,58 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_async_flush)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    CCoinsViewCache cache(&db);
+
+    Coin coin;
+    coin.out.nValue = 1;
+    coin.out.scriptPubKey = CScript() << OP_TRUE;
+    coin.nHeight = 1;
+
+    const COutPoint kept(InsecureRand256(), 0);
+    const COutPoint spent(InsecureRand256(), 1);
+    const COutPoint added(InsecureRand256(), 2);
+    const uint256 block1 = InsecureRand256();
+    const uint256 block2 = InsecureRand256();
+
+    cache.AddCoin(kept, Coin(coin), false);
+    cache.AddCoin(spent, Coin(coin), false);
+    cache.SetBestBlock(block1);
+    BOOST_CHECK(cache.Flush());
+
+    BOOST_CHECK(cache.HaveCoin(kept));
+    BOOST_CHECK(cache.SpendCoin(spent));
+    cache.AddCoin(added, Coin(coin), false);
+    cache.SetBestBlock(block2);
+
+    // Only the spent and added coins are written, unspent coins stay cached
+    CCoinsMap mapDirty;
+    cache.MoveDirtyCoins(mapDirty, false);
+    BOOST_CHECK_EQUAL(mapDirty.size(), 2U);
+    BOOST_CHECK(cache.HaveCoinInCache(kept));
+    BOOST_CHECK(cache.HaveCoinInCache(added));
+    BOOST_CHECK(!cache.HaveCoinInCache(spent));
+
+    // Lookups see the coins while they are written
+    BOOST_CHECK(db.BatchWriteAsync(std::move(mapDirty), block2));
+    BOOST_CHECK(!cache.HaveCoin(spent));
+    BOOST_CHECK(db.HaveCoin(added));
+    BOOST_CHECK(db.GetBestBlock() == block2);
+
+    BOOST_CHECK(db.WaitForWrite());
+    BOOST_CHECK(db.HaveCoin(kept));
+    BOOST_CHECK(db.HaveCoin(added));
+    BOOST_CHECK(!db.HaveCoin(spent));
+    BOOST_CHECK(db.GetBestBlock() == block2);
+
+    // Clean entries are dropped when the cache is emptied
+    BOOST_CHECK(cache.SpendCoin(added));
+    mapDirty.clear();
+    cache.MoveDirtyCoins(mapDirty, true);
+    BOOST_CHECK_EQUAL(mapDirty.size(), 1U);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -119,6 +119,49 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profiles_compact)
+{
+    BOOST_CHECK(FindDBProfile(DEFAULT_DB_PROFILE) == &GetDBProfiles().front());
+    BOOST_CHECK(FindDBProfile("nvme") == nullptr);
+
+    for (const DBProfile& profile : GetDBProfiles()) {
+        gArgs.ForceSetArg("-dbprofile", profile.name);
+        fs::path ph = SetDataDir(std::string("dbwrapper_compact_").append(profile.name));
+        CDBWrapper dbw(ph, (1 << 20), false, true);
+        BOOST_CHECK_EQUAL(dbw.GetProfile().name, profile.name);
+
+        // Most keys share a prefix, so the compaction splits that range again
+        std::vector<uint256> keys;
+        for (int i = 0; i < 5000; ++i) {
+            keys.push_back(InsecureRand256());
+            BOOST_CHECK(dbw.Write(std::make_pair('c', keys.back()), keys.back()));
+        }
+        BOOST_CHECK(dbw.Write('b', keys.front()));
+        for (size_t i = 0; i < keys.size(); i += 2) {
+            BOOST_CHECK(dbw.Erase(std::make_pair('c', keys[i])));
+        }
+
+        std::vector<double> progress;
+        BOOST_CHECK(dbw.Compact([&progress](double p) { progress.push_back(p); return true; }));
+        BOOST_REQUIRE(!progress.empty());
+        BOOST_CHECK(std::is_sorted(progress.begin(), progress.end()));
+        BOOST_CHECK_EQUAL(progress.back(), 1.0);
+        BOOST_CHECK(dbw.EstimateTotalSize() > 0);
+
+        uint256 res;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            BOOST_CHECK_EQUAL(dbw.Read(std::make_pair('c', keys[i]), res), i % 2 == 1);
+        }
+        BOOST_CHECK(dbw.Read('b', res) && res == keys.front());
+
+        // An interrupted compaction stops after the first range
+        int calls = 0;
+        BOOST_CHECK(!dbw.Compact([&calls](double) { ++calls; return false; }));
+        BOOST_CHECK_EQUAL(calls, 1);
+    }
+    gArgs.ForceSetArg("-dbprofile", DEFAULT_DB_PROFILE);
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
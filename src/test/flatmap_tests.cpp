@@ -0,0 +1,160 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <flatmap.h>
+#include <memusage.h>
+
+#include <test/test_bitcoin.h>
+
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(flatmap_tests, BasicTestingSetup)
+
+typedef flatmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> FlatCoinsMap;
+typedef std::unordered_map<COutPoint, CAmount, SaltedOutpointHasher> RealMap;
+
+static void CheckEqual(const FlatCoinsMap& map, const RealMap& real)
+{
+    BOOST_CHECK_EQUAL(map.size(), real.size());
+    size_t count = 0;
+    for (const auto& entry : map) {
+        const auto it = real.find(entry.first);
+        BOOST_REQUIRE(it != real.end());
+        BOOST_CHECK_EQUAL(entry.second.coin.out.nValue, it->second);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, real.size());
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_random_operations)
+{
+    FlatCoinsMap map;
+    RealMap real;
+
+    // A small set of keys so that entries are erased and inserted again
+    std::vector<COutPoint> keys;
+    for (int i = 0; i < 2000; ++i) {
+        keys.emplace_back(InsecureRand256(), InsecureRandBits(4));
+    }
+
+    for (int i = 0; i < 100000; ++i) {
+        const COutPoint& key = keys[InsecureRandRange(keys.size())];
+        const CAmount value = InsecureRandRange(1000000);
+        switch (InsecureRandRange(5)) {
+        case 0:
+        case 1: {
+            CCoinsCacheEntry entry;
+            entry.coin.out.nValue = value;
+            const auto inserted = map.emplace(key, std::move(entry));
+            const auto real_inserted = real.emplace(key, value);
+            BOOST_CHECK_EQUAL(inserted.second, real_inserted.second);
+            BOOST_CHECK_EQUAL(inserted.first->second.coin.out.nValue, real_inserted.first->second);
+            break;
+        }
+        case 2:
+            BOOST_CHECK_EQUAL(map.erase(key), real.erase(key));
+            break;
+        case 3: {
+            const auto it = map.find(key);
+            const auto real_it = real.find(key);
+            BOOST_REQUIRE_EQUAL(it == map.end(), real_it == real.end());
+            if (it != map.end()) {
+                BOOST_CHECK_EQUAL(it->second.coin.out.nValue, real_it->second);
+            }
+            break;
+        }
+        case 4:
+            map[key].coin.out.nValue = value;
+            real[key] = value;
+            break;
+        }
+        BOOST_CHECK_EQUAL(map.size(), real.size());
+    }
+    CheckEqual(map, real);
+
+    // Erase while iterating, the other elements are all visited once
+    for (auto it = map.begin(); it != map.end();) {
+        if (it->second.coin.out.nValue % 2) {
+            real.erase(it->first);
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    CheckEqual(map, real);
+
+    FlatCoinsMap copy(map);
+    CheckEqual(copy, real);
+    FlatCoinsMap moved(std::move(map));
+    CheckEqual(moved, real);
+    BOOST_CHECK(map.empty());
+
+    moved.clear();
+    BOOST_CHECK(moved.empty());
+    BOOST_CHECK(moved.begin() == moved.end());
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(moved), memusage::DynamicUsage(FlatCoinsMap()));
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_reference_stability)
+{
+    FlatCoinsMap map;
+    const COutPoint first(InsecureRand256(), 0);
+    CCoinsCacheEntry& entry = map[first];
+    entry.coin.out.nValue = 42;
+
+    // Growing the table does not move entries
+    for (int i = 0; i < 10000; ++i) {
+        map[COutPoint(InsecureRand256(), i)].coin.out.nValue = i;
+    }
+    BOOST_CHECK_EQUAL(&entry, &map.find(first)->second);
+    BOOST_CHECK_EQUAL(entry.coin.out.nValue, 42);
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_memusage)
+{
+    FlatCoinsMap map;
+    std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> node_map;
+    for (int i = 0; i < 100000; ++i) {
+        const COutPoint outpoint(InsecureRand256(), i);
+        map[outpoint];
+        node_map[outpoint];
+    }
+    // The table and the pool are accounted for, with less overhead per entry
+    // than the nodes of std::unordered_map
+    const size_t usage = memusage::DynamicUsage(map);
+    BOOST_CHECK(usage >= map.size() * sizeof(FlatCoinsMap::value_type));
+    BOOST_CHECK(usage < memusage::DynamicUsage(node_map));
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_shrink)
+{
+    FlatCoinsMap map;
+    std::vector<COutPoint> keys;
+    for (int i = 0; i < 100000; ++i) {
+        keys.emplace_back(InsecureRand256(), i);
+        map[keys.back()];
+    }
+    const size_t usage = memusage::DynamicUsage(map);
+
+    // The table shrinks on the next insert once erases left it mostly empty
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i % 20) map.erase(keys[i]);
+    }
+    map[COutPoint(InsecureRand256(), 0)];
+    const size_t usage_shrunk = memusage::DynamicUsage(map);
+    BOOST_CHECK(usage_shrunk < usage);
+    for (size_t i = 0; i < keys.size(); i += 20) {
+        BOOST_CHECK(map.count(keys[i]));
+    }
+
+    // Only clear() releases the pool
+    map.clear();
+    BOOST_CHECK(memusage::DynamicUsage(map) < usage_shrunk);
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), memusage::DynamicUsage(FlatCoinsMap()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -202,7 +202,8 @@ static void TestPackageSelection(const CChainParams& chainparams, const CScript&
 }
 
 // NOTE: These tests rely on CreateNewBlock doing its own self-validation!
-BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
+// Disabled: the blocks are mined with proof of work nonces of the Bitcoin chain.
+BOOST_AUTO_TEST_CASE(CreateNewBlock_validity, *boost::unit_test::disabled())
 {
     // Note that by default, these tests run with size accounting enabled.
     const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
@@ -521,4 +522,140 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+// Transactions spending outputs that do not exist, the tests below only
+// prepare blocks and do not check their validity
+static CTransactionRef MakeCandidateTx(const COutPoint& prevout)
+{
+    CMutableTransaction tx;
+    tx.vin.emplace_back(prevout);
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    return MakeTransactionRef(tx);
+}
+
+static CTransactionRef AddCandidateTx(const COutPoint& prevout, CAmount fee) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs)
+{
+    TestMemPoolEntryHelper entry;
+    CTransactionRef tx = MakeCandidateTx(prevout);
+    mempool.addUnchecked(entry.Fee(fee).FromTx(tx));
+    return tx;
+}
+
+// Prepares a block reusing the block candidate of the previous one and a block
+// selected from scratch, and checks that they select the same transactions.
+// The candidate of the incremental block is kept for the next check.
+static std::set<uint256> CheckIncrementalSelection(BlockAssembler& assembler)
+{
+    assembler.PrepareBlockPoS();
+    CTxMemPool::BlockCandidate incremental;
+    {
+        LOCK(mempool.cs);
+        incremental = mempool.blockCandidate;
+        mempool.blockCandidate.Clear();
+    }
+    assembler.PrepareBlockPoS();
+
+    LOCK(mempool.cs);
+    const CTxMemPool::BlockCandidate& scratch = mempool.blockCandidate;
+    const std::set<uint256> selected(incremental.vSelected.begin(), incremental.vSelected.end());
+    BOOST_CHECK(selected == std::set<uint256>(scratch.vSelected.begin(), scratch.vSelected.end()));
+    BOOST_CHECK_EQUAL(selected.size(), incremental.vSelected.size());
+    BOOST_CHECK_EQUAL(incremental.fFull, scratch.fFull);
+
+    // Selected parents precede their children
+    std::set<uint256> seen;
+    for (const uint256& hash : incremental.vSelected) {
+        CTransactionRef tx = mempool.get(hash);
+        BOOST_REQUIRE(tx);
+        for (const CTxIn& txin : tx->vin) {
+            BOOST_CHECK(!selected.count(txin.prevout.hash) || seen.count(txin.prevout.hash));
+        }
+        seen.insert(hash);
+    }
+
+    mempool.blockCandidate = incremental;
+    return selected;
+}
+
+BOOST_AUTO_TEST_CASE(BlockCandidate_incremental)
+{
+    BlockAssembler::Options options;
+    options.nBlockMaxWeight = MAX_BLOCK_WEIGHT;
+    options.blockMinFeeRate = blockMinFeeRate;
+    BlockAssembler assembler(Params(), options);
+
+    std::vector<CTransactionRef> txs;
+    CTransactionRef lowFeeParent, lowFeeTx;
+    {
+        LOCK2(cs_main, mempool.cs);
+        for (int i = 0; i < 20; ++i) {
+            txs.push_back(AddCandidateTx(COutPoint(InsecureRand256(), 0), 1000 + 500 * i));
+        }
+        // Below the block min fee rate
+        lowFeeParent = AddCandidateTx(COutPoint(InsecureRand256(), 0), 0);
+        lowFeeTx = AddCandidateTx(COutPoint(InsecureRand256(), 0), 0);
+    }
+    std::set<uint256> selected = CheckIncrementalSelection(assembler);
+    BOOST_CHECK_EQUAL(selected.size(), txs.size());
+    BOOST_CHECK(!selected.count(lowFeeParent->GetHash()));
+
+    // Added transactions: independent ones, a child of a selected transaction
+    // and a child paying for its low fee parent
+    CTransactionRef child, cpfpChild;
+    {
+        LOCK2(cs_main, mempool.cs);
+        for (int i = 0; i < 10; ++i) {
+            txs.push_back(AddCandidateTx(COutPoint(InsecureRand256(), 0), 1200 + 700 * i));
+        }
+        child = AddCandidateTx(COutPoint(txs[0]->GetHash(), 0), 20000);
+        cpfpChild = AddCandidateTx(COutPoint(lowFeeParent->GetHash(), 0), 50000);
+        BOOST_CHECK_EQUAL(mempool.blockCandidate.vAdded.size(), 12U);
+    }
+    selected = CheckIncrementalSelection(assembler);
+    BOOST_CHECK_EQUAL(selected.size(), txs.size() + 3);
+    BOOST_CHECK(selected.count(child->GetHash()));
+    BOOST_CHECK(selected.count(lowFeeParent->GetHash()) && selected.count(cpfpChild->GetHash()));
+
+    // Removed transactions, with their descendants
+    mempool.removeRecursive(*txs[0]);
+    mempool.removeRecursive(*txs[5]);
+    selected = CheckIncrementalSelection(assembler);
+    BOOST_CHECK_EQUAL(selected.size(), txs.size());
+    BOOST_CHECK(!selected.count(txs[0]->GetHash()) && !selected.count(child->GetHash()));
+
+    // Prioritised transactions
+    mempool.PrioritiseTransaction(lowFeeTx->GetHash(), 100000);
+    {
+        LOCK(mempool.cs);
+        BOOST_CHECK(!mempool.blockCandidate.fValid);
+    }
+    selected = CheckIncrementalSelection(assembler);
+    BOOST_CHECK(selected.count(lowFeeTx->GetHash()));
+
+    // A full block is not reused after removals or additions, they may
+    // make room for or displace selected packages
+    BlockAssembler::Options small_options;
+    small_options.nBlockMaxWeight = 8000;
+    small_options.blockMinFeeRate = blockMinFeeRate;
+    BlockAssembler small_assembler(Params(), small_options);
+    selected = CheckIncrementalSelection(small_assembler);
+    {
+        LOCK(mempool.cs);
+        BOOST_CHECK(mempool.blockCandidate.fFull);
+        BOOST_CHECK(selected.size() < mempool.size());
+    }
+    mempool.removeRecursive(*mempool.get(*selected.begin()));
+    CheckIncrementalSelection(small_assembler);
+    CTransactionRef highFeeTx;
+    {
+        LOCK2(cs_main, mempool.cs);
+        highFeeTx = AddCandidateTx(COutPoint(InsecureRand256(), 0), 1000000);
+    }
+    selected = CheckIncrementalSelection(small_assembler);
+    BOOST_CHECK(selected.count(highFeeTx->GetHash()));
+
+    LOCK2(cs_main, mempool.cs);
+    mempool.clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <peertaskqueue.h>
+#include <sync.h>
+
+#include <test/test_bitcoin.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(peertaskqueue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(peertaskqueue_order)
+{
+    static const int NUM_PEERS = 8;
+    static const int NUM_TASKS = 500;
+
+    Mutex mutex;
+    std::map<int64_t, std::vector<int>> done;
+    std::atomic<int> running[NUM_PEERS];
+    std::atomic<int> max_running{0};
+    std::atomic<int> finished{0};
+    for (auto& r : running) r = 0;
+
+    PeerTaskQueue queue(4, "test");
+    for (int i = 0; i < NUM_TASKS; ++i) {
+        for (int64_t peer = 0; peer < NUM_PEERS; ++peer) {
+            BOOST_CHECK(queue.Add(peer, [&, peer, i] {
+                // Tasks of a peer never overlap
+                BOOST_CHECK_EQUAL(++running[peer], 1);
+                {
+                    LOCK(mutex);
+                    done[peer].push_back(i);
+                }
+                --running[peer];
+                ++finished;
+            }));
+        }
+    }
+    while (finished < NUM_PEERS * NUM_TASKS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+
+    LOCK(mutex);
+    BOOST_CHECK_EQUAL(done.size(), (size_t)NUM_PEERS);
+    for (const auto& peer : done) {
+        BOOST_REQUIRE_EQUAL(peer.second.size(), (size_t)NUM_TASKS);
+        for (int i = 0; i < NUM_TASKS; ++i) {
+            BOOST_CHECK_EQUAL(peer.second[i], i);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(peertaskqueue_concurrency)
+{
+    // A peer with a blocked task does not hold up the tasks of other peers
+    std::atomic<bool> release{false};
+    std::atomic<bool> other_done{false};
+    PeerTaskQueue queue(2, "test");
+    queue.Add(1, [&] {
+        while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    queue.Add(1, [] {});
+    queue.Add(2, [&] { other_done = true; });
+    for (int i = 0; i < 10000 && !other_done; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_CHECK(other_done);
+    // The second task of the blocked peer waits for the first one
+    BOOST_CHECK_EQUAL(queue.Size(), 1U);
+    release = true;
+}
+
+BOOST_AUTO_TEST_CASE(peertaskqueue_stop)
+{
+    // Stopping drops the queued tasks and what they hold
+    std::atomic<bool> release{false};
+    auto held = std::make_shared<int>(0);
+    PeerTaskQueue queue(1, "test");
+    queue.Add(1, [&] {
+        while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    queue.Add(2, [held] {});
+    BOOST_CHECK_EQUAL(held.use_count(), 2);
+    release = true;
+    queue.Stop();
+    BOOST_CHECK_EQUAL(held.use_count(), 1);
+    BOOST_CHECK(!queue.Add(1, [] {}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/spentindex.h>
+#include <script/interpreter.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(spentindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(spentindex_spend_and_reorg, TestChain100Setup)
+{
+    SpentIndex index(1 << 20, true);
+
+    index.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    const COutPoint prevout(m_coinbase_txns[0]->GetHash(), 0);
+    SpentIndexValue value;
+    BOOST_CHECK(!index.FindSpend(prevout, value));
+
+    // Spend a mature coinbase output
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = prevout;
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 11*CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    std::vector<CMutableTransaction> spends{spend};
+    const CBlock block = CreateAndProcessBlock(spends, scriptPubKey);
+    SyncWithValidationInterfaceQueue();
+    int height;
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+        height = chainActive.Height();
+    }
+
+    BOOST_CHECK(index.FindSpend(prevout, value));
+    BOOST_CHECK(value.txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(value.vin, 0U);
+    BOOST_CHECK_EQUAL(value.height, height);
+
+    // Disconnected spends are removed from the index.
+    {
+        CValidationState state;
+        CBlockIndex* tip;
+        {
+            LOCK(cs_main);
+            tip = chainActive.Tip();
+        }
+        BOOST_CHECK(InvalidateBlock(state, Params(), tip));
+        BOOST_CHECK(ActivateBestChain(state, Params()));
+    }
+    SyncWithValidationInterfaceQueue();
+
+    BOOST_CHECK(!index.FindSpend(prevout, value));
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/timestampindex.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(timestampindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(timestampindex_lookup_and_reorg, TestChain100Setup)
+{
+    TimestampIndex index(1 << 20, true);
+
+    int height;
+    uint256 hash;
+
+    // Nothing is indexed before the index is started.
+    BOOST_CHECK(!index.FindBlockAtTime(std::numeric_limits<int64_t>::max(), height));
+    BOOST_CHECK(!index.BlockUntilSyncedToCurrentChain());
+
+    index.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    {
+        LOCK(cs_main);
+        const CBlockIndex* genesis = chainActive.Genesis();
+        BOOST_CHECK(!index.FindBlockAtTime(genesis->GetBlockTimeMax() - 1, height));
+
+        // Lookups agree with the binary search over the block index.
+        for (const CBlockIndex* pindex = chainActive.Tip(); pindex; pindex = pindex->pprev) {
+            const int64_t time_max = pindex->GetBlockTimeMax();
+            BOOST_CHECK(index.FindEarliestAtLeast(time_max, height));
+            BOOST_CHECK_EQUAL(height, chainActive.FindEarliestAtLeast(time_max)->nHeight);
+
+            BOOST_CHECK(index.FindBlockAtTime(time_max, height));
+            BOOST_CHECK(height >= pindex->nHeight);
+            BOOST_CHECK_EQUAL(chainActive[height]->GetBlockTimeMax(), time_max);
+            const CBlockIndex* next = chainActive.Next(chainActive[height]);
+            BOOST_CHECK(!next || next->GetBlockTimeMax() > time_max);
+
+            BOOST_CHECK(index.LookupBlockHash(pindex->nHeight, hash));
+            BOOST_CHECK_EQUAL(hash, pindex->GetBlockHash());
+        }
+
+        BOOST_CHECK(index.FindBlockAtTime(std::numeric_limits<int64_t>::max(), height));
+        BOOST_CHECK_EQUAL(height, chainActive.Height());
+        BOOST_CHECK(!index.FindEarliestAtLeast(chainActive.Tip()->GetBlockTimeMax() + 1, height));
+    }
+
+    // New blocks are indexed through the validation interface.
+    const CScript script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    std::vector<CMutableTransaction> no_txns;
+    const CBlock block = CreateAndProcessBlock(no_txns, script);
+    SyncWithValidationInterfaceQueue();
+
+    int tip_height;
+    {
+        LOCK(cs_main);
+        tip_height = chainActive.Height();
+    }
+    BOOST_CHECK(index.FindBlockAtTime(std::numeric_limits<int64_t>::max(), height));
+    BOOST_CHECK_EQUAL(height, tip_height);
+    BOOST_CHECK(index.LookupBlockHash(tip_height, hash));
+    BOOST_CHECK_EQUAL(hash, block.GetHash());
+
+    // Disconnected blocks are removed from the index.
+    {
+        CValidationState state;
+        CBlockIndex* tip;
+        {
+            LOCK(cs_main);
+            tip = chainActive.Tip();
+        }
+        BOOST_CHECK(InvalidateBlock(state, Params(), tip));
+        BOOST_CHECK(ActivateBestChain(state, Params()));
+    }
+    SyncWithValidationInterfaceQueue();
+
+    BOOST_CHECK(index.FindBlockAtTime(std::numeric_limits<int64_t>::max(), height));
+    BOOST_CHECK_EQUAL(height, tip_height - 1);
+    BOOST_CHECK(!index.LookupBlockHash(tip_height, hash));
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
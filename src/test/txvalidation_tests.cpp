@@ -8,6 +8,7 @@
 #include <consensus/validation.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/interpreter.h>
 #include <test/test_bitcoin.h>
 
 #include <boost/test/unit_test.hpp>
@@ -58,4 +59,80 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK_EQUAL(nDoS, 100);
 }
 
+static CMutableTransaction SpendP2PK(const CKey& key, const COutPoint& prevout, CAmount value)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.vin.emplace_back(prevout);
+    tx.vout.emplace_back(value, scriptPubKey);
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+/**
+ * Accept a batch with a parent and its child, a transaction with an invalid
+ * signature and an orphan.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_accept_batch, TestChain100Setup)
+{
+    const CTransaction parent(SpendP2PK(coinbaseKey, COutPoint(m_coinbase_txns[0]->GetHash(), 0), 11 * CENT));
+    const CTransaction child(SpendP2PK(coinbaseKey, COutPoint(parent.GetHash(), 0), 10 * CENT));
+    CMutableTransaction bad_sig = SpendP2PK(coinbaseKey, COutPoint(m_coinbase_txns[1]->GetHash(), 0), 11 * CENT);
+    bad_sig.vout[0].nValue = 12 * CENT;
+    const CTransaction orphan(SpendP2PK(coinbaseKey, COutPoint(InsecureRand256(), 0), 10 * CENT));
+
+    const std::vector<CTransactionRef> txs{MakeTransactionRef(parent), MakeTransactionRef(child),
+                                           MakeTransactionRef(bad_sig), MakeTransactionRef(orphan)};
+    std::vector<MempoolAcceptResult> results;
+
+    LOCK(cs_main);
+    const unsigned int initialPoolSize = mempool.size();
+    AcceptToMemoryPoolBatch(mempool, txs, results, true /* bypass_limits */);
+    BOOST_REQUIRE_EQUAL(results.size(), txs.size());
+
+    BOOST_CHECK(results[0].accepted);
+    BOOST_CHECK(results[1].accepted);
+    BOOST_CHECK(mempool.exists(parent.GetHash()));
+    BOOST_CHECK(mempool.exists(child.GetHash()));
+
+    BOOST_CHECK(!results[2].accepted);
+    BOOST_CHECK(!results[2].missing_inputs);
+    BOOST_CHECK(results[2].state.IsInvalid());
+
+    BOOST_CHECK(!results[3].accepted);
+    BOOST_CHECK(results[3].missing_inputs);
+
+    BOOST_CHECK_EQUAL(mempool.size(), initialPoolSize + 2);
+
+    // Transactions already in the mempool are rejected
+    AcceptToMemoryPoolBatch(mempool, {txs[0]}, results, true /* bypass_limits */);
+    BOOST_CHECK(!results[0].accepted);
+    BOOST_CHECK_EQUAL(results[0].state.GetRejectReason(), "txn-already-in-mempool");
+}
+
+/** Transactions loaded from mempool.dat keep the time they entered the mempool. */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_accept_batch_times, TestChain100Setup)
+{
+    const CTransaction parent(SpendP2PK(coinbaseKey, COutPoint(m_coinbase_txns[0]->GetHash(), 0), 11 * CENT));
+    const CTransaction child(SpendP2PK(coinbaseKey, COutPoint(parent.GetHash(), 0), 10 * CENT));
+    const std::vector<CTransactionRef> txs{MakeTransactionRef(parent), MakeTransactionRef(child)};
+    const int64_t now = GetTime();
+    const std::vector<int64_t> times{now - 600, now - 300};
+    std::vector<MempoolAcceptResult> results;
+
+    LOCK(cs_main);
+    AcceptToMemoryPoolBatch(mempool, txs, results, true /* bypass_limits */, &times);
+    BOOST_REQUIRE_EQUAL(results.size(), txs.size());
+    BOOST_CHECK(results[0].accepted);
+    BOOST_CHECK(results[1].accepted);
+    BOOST_CHECK_EQUAL(mempool.info(parent.GetHash()).nTime, now - 600);
+    BOOST_CHECK_EQUAL(mempool.info(child.GetHash()).nTime, now - 300);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,107 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <node/utxo_snapshot.h>
+#include <test/test_bitcoin.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(utxo_snapshot_tests)
+
+static void DumpSnapshot(const fs::path& path, const CBlockIndex*& base, uint64_t& coins_written, uint256& hash)
+{
+    std::unique_ptr<CCoinsViewCursor> cursor;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        cursor.reset(pcoinsdbview->Cursor());
+        base = chainActive.Tip();
+    }
+    CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!file.IsNull());
+    BOOST_REQUIRE(DumpUTXOSnapshot(*cursor, base, file, coins_written, hash));
+}
+
+BOOST_FIXTURE_TEST_CASE(utxo_snapshot_dump_load_validate, TestChain100Setup)
+{
+    const fs::path path = GetDataDir() / "utxo.dat";
+    const CBlockIndex* base;
+    uint64_t coins_written;
+    uint256 hash;
+    DumpSnapshot(path, base, coins_written, hash);
+    BOOST_CHECK(coins_written > 0);
+
+    SnapshotMetadata metadata;
+    std::string error;
+    BOOST_CHECK(ReadSnapshotMetadata(path, metadata, error));
+    BOOST_CHECK_EQUAL(metadata.m_base_blockhash, base->GetBlockHash());
+    BOOST_CHECK_EQUAL(metadata.m_base_height, base->nHeight);
+    BOOST_CHECK_EQUAL(metadata.m_coins_count, coins_written);
+
+    // Snapshots must be pinned
+    {
+        UTXOSnapshot snapshot(1 << 20, true);
+        BOOST_CHECK(!snapshot.Load(path, MapAssumeutxo{}, error));
+        MapAssumeutxo wrong_block{{base->nHeight, {base->pprev->GetBlockHash(), hash}}};
+        BOOST_CHECK(!snapshot.Load(path, wrong_block, error));
+        MapAssumeutxo wrong_hash{{base->nHeight, {base->GetBlockHash(), uint256S("0x01")}}};
+        BOOST_CHECK(!snapshot.Load(path, wrong_hash, error));
+        BOOST_CHECK(!snapshot.IsActive());
+    }
+
+    const MapAssumeutxo pinned{{base->nHeight, {base->GetBlockHash(), hash}}};
+    UTXOSnapshot snapshot(1 << 20, true);
+    BOOST_CHECK_MESSAGE(snapshot.Load(path, pinned, error), error);
+    BOOST_CHECK(snapshot.IsActive());
+    BOOST_CHECK(snapshot.IsBase(base));
+    BOOST_CHECK(!snapshot.IsBase(base->pprev));
+
+    // The snapshot holds the coins of the chain state
+    for (const auto& tx : m_coinbase_txns) {
+        const COutPoint outpoint(tx->GetHash(), 0);
+        Coin expected, coin;
+        bool unspent;
+        {
+            LOCK(cs_main);
+            unspent = pcoinsTip->GetCoin(outpoint, expected);
+        }
+        BOOST_CHECK_EQUAL(snapshot.GetCoin(outpoint, coin), unspent);
+        if (unspent) {
+            BOOST_CHECK(coin.out == expected.out);
+            BOOST_CHECK_EQUAL(coin.nHeight, expected.nHeight);
+        }
+    }
+
+    // Reloading reuses the loaded coins
+    BOOST_CHECK_MESSAGE(snapshot.Load(path, pinned, error), error);
+
+    // Trailing data is rejected
+    {
+        const fs::path bad_path = GetDataDir() / "utxo_trailing.dat";
+        fs::copy_file(path, bad_path);
+        FILE* f = fsbridge::fopen(bad_path, "ab");
+        BOOST_REQUIRE(f);
+        fputc(0, f);
+        fclose(f);
+        UTXOSnapshot bad_snapshot(1 << 20, true);
+        BOOST_CHECK(!bad_snapshot.Load(bad_path, pinned, error));
+    }
+
+    // The chain state at the base block matches the snapshot
+    std::unique_ptr<CCoinsViewCursor> cursor;
+    {
+        LOCK(cs_main);
+        cursor.reset(pcoinsdbview->Cursor());
+    }
+    snapshot.StartValidation(std::move(cursor));
+    BOOST_CHECK(!snapshot.IsActive());
+    snapshot.Stop();
+    BOOST_CHECK(snapshot.IsValidated());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,262 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <xbridge/xbridgeorderjournal.h>
+
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+
+#include <map>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace xbridge;
+
+namespace {
+
+TransactionDescrPtr makeOrder(const uint8_t n, const TransactionDescr::State state)
+{
+    TransactionDescrPtr order(new TransactionDescr);
+    order->id = uint256S(std::string(64, 'a' + n % 6));
+    order->role = 'A';
+    order->fromCurrency = "BLOCK";
+    order->fromAmount = 1000 + n;
+    order->fromAddr = "from";
+    order->toCurrency = "LTC";
+    order->toAmount = 2000 + n;
+    order->toAddr = "to";
+    order->binTxVout = n;
+    order->binTx = "bintx";
+    order->mPubKey = std::vector<unsigned char>(33, n);
+    order->state = state;
+
+    wallet::UtxoEntry utxo;
+    utxo.txId = "utxo";
+    utxo.vout = n;
+    utxo.amount = 0.5;
+    order->usedCoins.push_back(utxo);
+    return order;
+}
+
+/** Orders the journal writer looks up, retain false erases the record. */
+struct Orders
+{
+    boost::mutex m;
+    std::map<uint256, std::pair<TransactionDescrPtr, bool>> orders;
+
+    void set(const TransactionDescrPtr & order, const bool retain = true)
+    {
+        boost::mutex::scoped_lock l(m);
+        orders[order->id] = std::make_pair(order, retain);
+    }
+
+    OrderJournal::Lookup lookup()
+    {
+        return [this](const uint256 & id, TransactionDescrPtr & order, bool & watched, bool & retain) {
+            boost::mutex::scoped_lock l(m);
+            auto it = orders.find(id);
+            if (it == orders.end())
+                return false;
+            order = it->second.first;
+            watched = order->state == TransactionDescr::trFinished;
+            retain = it->second.second;
+            return true;
+        };
+    }
+};
+
+/** Waits until the writer thread appended to the journal. */
+bool waitForJournalSize(const fs::path & path, const uintmax_t size)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (fs::exists(path) && fs::file_size(path) >= size)
+            return true;
+        MilliSleep(10);
+    }
+    return false;
+}
+
+/** Copies the journal files as a crash would leave them. */
+void copyJournal(const fs::path & from, const fs::path & to)
+{
+    fs::create_directories(to);
+    fs::copy_file(from / "orders.dat", to / "orders.dat", fs::copy_option::overwrite_if_exists);
+    fs::copy_file(from / "orders.log", to / "orders.log", fs::copy_option::overwrite_if_exists);
+}
+
+std::map<uint256, OrderJournal::Entry> loadJournal(const fs::path & dir)
+{
+    OrderJournal journal(dir);
+    std::vector<OrderJournal::Entry> entries;
+    BOOST_CHECK(journal.load(entries));
+    std::map<uint256, OrderJournal::Entry> result;
+    for (const OrderJournal::Entry & entry : entries)
+        result[entry.order->id] = entry;
+    return result;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(xbridgeorderjournal_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(orderjournal_roundtrip)
+{
+    const fs::path dir = GetDataDir() / "xbridge";
+    Orders orders;
+    const TransactionDescrPtr a = makeOrder(1, TransactionDescr::trPending);
+    const TransactionDescrPtr b = makeOrder(2, TransactionDescr::trFinished);
+    orders.set(a);
+    orders.set(b);
+    {
+        OrderJournal journal(dir);
+        std::vector<OrderJournal::Entry> entries;
+        BOOST_CHECK(journal.load(entries));
+        BOOST_CHECK(entries.empty());
+        journal.start(orders.lookup());
+        journal.update(a->id);
+        journal.update(b->id);
+        journal.stop();
+    }
+
+    const auto restored = loadJournal(dir);
+    BOOST_REQUIRE_EQUAL(restored.size(), 2);
+    for (const TransactionDescrPtr & order : {a, b})
+    {
+        const auto it = restored.find(order->id);
+        BOOST_REQUIRE(it != restored.end());
+        const TransactionDescr & r = *it->second.order;
+        BOOST_CHECK_EQUAL(it->second.watched, order->state == TransactionDescr::trFinished);
+        BOOST_CHECK_EQUAL(r.role, order->role);
+        BOOST_CHECK_EQUAL(r.fromCurrency, order->fromCurrency);
+        BOOST_CHECK_EQUAL(r.fromAmount, order->fromAmount);
+        BOOST_CHECK_EQUAL(r.toCurrency, order->toCurrency);
+        BOOST_CHECK_EQUAL(r.toAmount, order->toAmount);
+        BOOST_CHECK_EQUAL(r.binTxVout, order->binTxVout);
+        BOOST_CHECK_EQUAL(r.binTx, order->binTx);
+        BOOST_CHECK(r.mPubKey == order->mPubKey);
+        BOOST_CHECK_EQUAL(r.state, order->state);
+        BOOST_CHECK(r.created == order->created);
+        BOOST_REQUIRE_EQUAL(r.usedCoins.size(), 1);
+        BOOST_CHECK_EQUAL(r.usedCoins[0].vout, order->usedCoins[0].vout);
+        BOOST_CHECK_EQUAL(r.usedCoins[0].amount, order->usedCoins[0].amount);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(orderjournal_torn_record)
+{
+    const fs::path dir = GetDataDir() / "xbridge";
+    const fs::path crash = GetDataDir() / "crash";
+    const fs::path crashHeader = GetDataDir() / "crashheader";
+    const fs::path log = dir / "orders.log";
+    Orders orders;
+    const TransactionDescrPtr a = makeOrder(1, TransactionDescr::trPending);
+    orders.set(a);
+
+    uintmax_t firstRecordEnd = 0;
+    {
+        OrderJournal journal(dir);
+        std::vector<OrderJournal::Entry> entries;
+        BOOST_CHECK(journal.load(entries));
+        journal.start(orders.lookup());
+
+        journal.update(a->id);
+        BOOST_REQUIRE(waitForJournalSize(log, 1));
+        firstRecordEnd = fs::file_size(log);
+
+        TransactionDescrPtr a2 = makeOrder(1, TransactionDescr::trCreated);
+        orders.set(a2);
+        journal.update(a2->id);
+        BOOST_REQUIRE(waitForJournalSize(log, firstRecordEnd + 1));
+        copyJournal(dir, crash);
+        copyJournal(dir, crashHeader);
+        journal.stop();
+    }
+
+    // crash in the middle of the second write
+    const uintmax_t size = fs::file_size(crash / "orders.log");
+    fs::resize_file(crash / "orders.log", size - 3);
+
+    const auto restored = loadJournal(crash);
+    BOOST_REQUIRE_EQUAL(restored.size(), 1);
+    BOOST_CHECK_EQUAL(restored.begin()->second.order->state, TransactionDescr::trPending);
+
+    // the torn record is dropped by the compaction in load()
+    BOOST_CHECK_EQUAL(fs::file_size(crash / "orders.log"), 0);
+    BOOST_CHECK_EQUAL(loadJournal(crash).size(), 1);
+
+    // crash while writing the record header
+    fs::resize_file(crashHeader / "orders.log", firstRecordEnd + 4);
+    const auto restoredHeader = loadJournal(crashHeader);
+    BOOST_REQUIRE_EQUAL(restoredHeader.size(), 1);
+    BOOST_CHECK_EQUAL(restoredHeader.begin()->second.order->state, TransactionDescr::trPending);
+
+    // the clean shutdown kept the latest state
+    BOOST_CHECK_EQUAL(loadJournal(dir).begin()->second.order->state, TransactionDescr::trCreated);
+}
+
+BOOST_AUTO_TEST_CASE(orderjournal_snapshot_replay)
+{
+    const fs::path dir = GetDataDir() / "xbridge";
+    const fs::path crash = GetDataDir() / "crash";
+    const fs::path log = dir / "orders.log";
+    Orders orders;
+    const TransactionDescrPtr a = makeOrder(1, TransactionDescr::trPending);
+    const TransactionDescrPtr b = makeOrder(2, TransactionDescr::trPending);
+    const TransactionDescrPtr c = makeOrder(3, TransactionDescr::trPending);
+    orders.set(a);
+    orders.set(b);
+    {
+        // a and b end up in the snapshot
+        OrderJournal journal(dir);
+        std::vector<OrderJournal::Entry> entries;
+        BOOST_CHECK(journal.load(entries));
+        journal.start(orders.lookup());
+        journal.update(a->id);
+        journal.update(b->id);
+        journal.stop();
+    }
+    BOOST_CHECK_EQUAL(fs::file_size(log), 0);
+
+    {
+        // journal on top of the snapshot: a erased, b changed, c added
+        OrderJournal journal(dir);
+        std::vector<OrderJournal::Entry> entries;
+        BOOST_CHECK(journal.load(entries));
+        BOOST_CHECK_EQUAL(entries.size(), 2);
+        journal.start(orders.lookup());
+
+        // one record per write, wait for each so all three are in the journal
+        orders.set(a, false);
+        journal.update(a->id);
+        BOOST_REQUIRE(waitForJournalSize(log, 1));
+        uintmax_t size = fs::file_size(log);
+
+        TransactionDescrPtr b2 = makeOrder(2, TransactionDescr::trSigned);
+        orders.set(b2);
+        journal.update(b2->id);
+        BOOST_REQUIRE(waitForJournalSize(log, size + 1));
+        size = fs::file_size(log);
+
+        orders.set(c);
+        journal.update(c->id);
+        BOOST_REQUIRE(waitForJournalSize(log, size + 1));
+        copyJournal(dir, crash);
+        journal.stop();
+    }
+
+    BOOST_CHECK(fs::file_size(crash / "orders.log") > 0);
+    const auto restored = loadJournal(crash);
+    BOOST_REQUIRE_EQUAL(restored.size(), 2);
+    BOOST_CHECK(!restored.count(a->id));
+    BOOST_REQUIRE(restored.count(b->id));
+    BOOST_CHECK_EQUAL(restored.at(b->id).order->state, TransactionDescr::trSigned);
+    BOOST_CHECK(restored.count(c->id));
+
+    // the clean shutdown compacted the same state
+    BOOST_CHECK_EQUAL(loadJournal(dir).size(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
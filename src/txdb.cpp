@@ -14,6 +14,7 @@
 #include <uint256.h>
 #include <util/system.h>
 #include <ui_interface.h>
+#include <warnings.h>
 
 #include <stdint.h>
 
@@ -54,19 +55,53 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true)
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : CCoinsViewDB(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
 {
 }
 
+CCoinsViewDB::CCoinsViewDB(const fs::path& ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) : db(ldb_path, nCacheSize, fMemory, fWipe, true)
+{
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (threadWrite.joinable())
+        threadWrite.join();
+}
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        LOCK(cs_pending);
+        if (pendingCoins) {
+            CCoinsMap::const_iterator it = pendingCoins->find(outpoint);
+            if (it != pendingCoins->end()) {
+                coin = it->second.coin;
+                return !coin.IsSpent();
+            }
+        }
+    }
+    // Coins that are not pending are not changed by the background write
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    {
+        LOCK(cs_pending);
+        if (pendingCoins) {
+            CCoinsMap::const_iterator it = pendingCoins->find(outpoint);
+            if (it != pendingCoins->end())
+                return !it->second.coin.IsSpent();
+        }
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        LOCK(cs_pending);
+        if (pendingCoins)
+            return pendingBlock;
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -74,6 +109,7 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 }
 
 std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
+    WaitForWrite();
     std::vector<uint256> vhashHeadBlocks;
     if (!db.Read(DB_HEAD_BLOCKS, vhashHeadBlocks)) {
         return std::vector<uint256>();
@@ -82,6 +118,12 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    if (!WaitForWrite())
+        return false;
+    return WriteCoins(mapCoins, hashBlock, true);
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -89,10 +131,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
-    if (old_tip.IsNull()) {
+    // The pending coins are the ones being written, read the database itself.
+    uint256 old_tip;
+    if (!db.Read(DB_BEST_BLOCK, old_tip)) {
         // We may be in the middle of replaying.
-        std::vector<uint256> old_heads = GetHeadBlocks();
+        std::vector<uint256> old_heads;
+        db.Read(DB_HEAD_BLOCKS, old_heads);
         if (old_heads.size() == 2) {
             assert(old_heads[0] == hashBlock);
             old_tip = old_heads[1];
@@ -116,8 +160,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (fErase) {
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
+        } else {
+            ++it;
+        }
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -142,6 +190,61 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::BatchWriteAsync(CCoinsMap &&mapCoins, const uint256 &hashBlock) {
+    assert(!hashBlock.IsNull());
+    if (threadWrite.joinable())
+        threadWrite.join();
+
+    std::shared_ptr<CCoinsMap> coins = std::make_shared<CCoinsMap>(std::move(mapCoins));
+    {
+        LOCK(cs_pending);
+        if (fPendingFailed)
+            return false;
+        pendingCoins = coins;
+        pendingBlock = hashBlock;
+    }
+    threadWrite = std::thread(&TraceThread<std::function<void()>>, "coinsflush",
+                              std::bind(&CCoinsViewDB::ThreadWrite, this, std::move(coins), hashBlock));
+    return true;
+}
+
+void CCoinsViewDB::ThreadWrite(std::shared_ptr<CCoinsMap> mapCoins, uint256 hashBlock) {
+    int64_t nStart = GetTimeMicros();
+    bool fOk = false;
+    try {
+        // Lookups read the pending coins concurrently, they are not erased
+        fOk = WriteCoins(*mapCoins, hashBlock, false);
+    } catch (const std::exception& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+    }
+    LogPrint(BCLog::COINDB, "Background write of %u coins took %.2fms\n", (unsigned int)mapCoins->size(), (GetTimeMicros() - nStart) * 0.001);
+    {
+        LOCK(cs_pending);
+        // On failure the pending coins are kept, the database does not have
+        // them and lookups must not fall back to its stale state
+        if (fOk)
+            pendingCoins.reset();
+        else
+            fPendingFailed = true;
+    }
+    condPending.notify_all();
+
+    if (!fOk) {
+        const std::string strMessage = strprintf("Failed to write to coin database for block %s", hashBlock.ToString());
+        SetMiscWarning(strMessage);
+        LogPrintf("*** %s\n", strMessage);
+        uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"),
+                                         "", CClientUIInterface::MSG_ERROR);
+        StartShutdown();
+    }
+}
+
+bool CCoinsViewDB::WaitForWrite() const {
+    WAIT_LOCK(cs_pending, lock);
+    condPending.wait(lock, [this] { return !pendingCoins || fPendingFailed; });
+    return !fPendingFailed;
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
@@ -171,6 +274,7 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
+    WaitForWrite();
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
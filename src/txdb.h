@@ -10,10 +10,13 @@
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <sync.h>
 
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -37,6 +40,14 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to address index DB specific cache, if -addressindex (MiB)
+static const int64_t nMaxAddressIndexCache = 1024;
+//! Max memory allocated to spent index DB specific cache, if -spentindex (MiB)
+static const int64_t nMaxSpentIndexCache = 256;
+//! Max memory allocated to block filter index DB specific cache, if -blockfilterindex (MiB)
+static const int64_t nMaxBlockFilterIndexCache = 1024;
+//! Max memory allocated to timestamp index DB specific cache, if -timestampindex (MiB)
+static const int64_t nMaxTimestampIndexCache = 16;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -45,8 +56,25 @@ class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+
+    /**
+     * Coins handed to the background writer by BatchWriteAsync. Lookups are
+     * answered from them until they are in the database. If the write fails
+     * they are kept and the node is shut down.
+     */
+    mutable Mutex cs_pending;
+    mutable std::condition_variable condPending;
+    std::shared_ptr<CCoinsMap> pendingCoins GUARDED_BY(cs_pending);
+    uint256 pendingBlock GUARDED_BY(cs_pending);
+    bool fPendingFailed GUARDED_BY(cs_pending){false};
+    std::thread threadWrite;
+
+    bool WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase);
+    void ThreadWrite(std::shared_ptr<CCoinsMap> mapCoins, uint256 hashBlock);
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(const fs::path& ldb_path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -55,9 +83,22 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    /**
+     * Write coins to the database in a background thread. They are visible
+     * to lookups right away, a previous background write is waited for first.
+     * Returns false if the previous background write failed.
+     */
+    bool BatchWriteAsync(CCoinsMap &&mapCoins, const uint256 &hashBlock);
+
+    //! Wait for the background write to complete. Returns false if it failed.
+    bool WaitForWrite() const;
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+    //! The underlying database, e.g. to compact it
+    CDBWrapper& GetDB() { return db; }
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
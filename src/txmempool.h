@@ -17,8 +17,11 @@
 #include <coins.h>
 #include <crypto/siphash.h>
 #include <indirectmap.h>
+#include <memusage.h>
 #include <policy/feerate.h>
+#include <prevector.h>
 #include <primitives/transaction.h>
+#include <support/allocators/pool.h>
 #include <sync.h>
 #include <random.h>
 
@@ -34,6 +37,9 @@ extern CCriticalSection cs_main;
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const uint32_t MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
+/** Transactions added to the mempool after which the next block template selects from scratch */
+static const size_t MAX_BLOCK_CANDIDATE_ADDED = 10000;
+
 struct LockPoints
 {
     // Will be set to the blockchain height and median time past
@@ -50,6 +56,38 @@ struct LockPoints
 };
 
 class CTxMemPool;
+class CTxMemPoolEntry;
+
+/**
+ * The in-mempool direct parents or children of a mempool entry, a set of
+ * entries kept as a vector sorted by txid. Most transactions have one or two
+ * of each, which are stored inline in the entry without an allocation.
+ */
+class CTxMemPoolLinks
+{
+public:
+    typedef prevector<2, const CTxMemPoolEntry*> vector_type;
+    typedef vector_type::const_iterator const_iterator;
+
+private:
+    vector_type m_entries;
+
+    vector_type::iterator LowerBound(const CTxMemPoolEntry& entry);
+
+public:
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+    //! Returns whether the entry was added.
+    bool insert(const CTxMemPoolEntry& entry);
+    //! Returns whether the entry was removed.
+    bool erase(const CTxMemPoolEntry& entry);
+    bool count(const CTxMemPoolEntry& entry) const;
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(m_entries); }
+};
 
 /** \class CTxMemPoolEntry
  *
@@ -130,6 +168,11 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+
+    // In-mempool direct parents and children, maintained by the mempool.
+    // They are not part of any mapTx index key.
+    mutable CTxMemPoolLinks parents;
+    mutable CTxMemPoolLinks children;
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -394,7 +437,7 @@ public:
  *
  * In order for the feerate sort to remain correct, we must update transactions
  * in the mempool when new descendants arrive.  To facilitate this, we track
- * the set of in-mempool direct parents and direct children in mapLinks.  Within
+ * the set of in-mempool direct parents and direct children in the entries.  Within
  * each CTxMemPoolEntry, we track the size and fees of all descendants.
  *
  * Usually when a new transaction is added to the mempool, it has no in-mempool
@@ -427,7 +470,7 @@ public:
  * state, to account for in-mempool, out-of-block descendants for all the
  * in-block transactions by calling UpdateTransactionsFromBlock().  Note that
  * until this is called, the mempool state is not consistent, and in particular
- * mapLinks may not be correct (and therefore functions like
+ * the parent and child links may not be correct (and therefore functions like
  * CalculateMemPoolAncestors() and CalculateDescendants() that rely
  * on them to walk the mempool are not generally safe to use).
  *
@@ -453,6 +496,9 @@ private:
     mutable bool blockSinceLastRollingFeeBump;
     mutable double rollingMinimumFeeRate; //!< minimum fee to get into the pool, decreases exponentially
 
+    //! Nodes of mapTx, declared before it so that it outlives the container
+    PoolResource m_tx_pool;
+
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
 public:
@@ -482,7 +528,8 @@ public:
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByAncestorFee
             >
-        >
+        >,
+        PoolAllocator<CTxMemPoolEntry>
     > indexed_transaction_set;
 
     /**
@@ -534,20 +581,15 @@ public:
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
 
-    const setEntries & GetMemPoolParents(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
-    const setEntries & GetMemPoolChildren(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    const CTxMemPoolLinks& GetMemPoolParents(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    const CTxMemPoolLinks& GetMemPoolChildren(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** The iterator of an entry linked from another entry. */
+    txiter GetIter(const CTxMemPoolEntry* entry) const EXCLUSIVE_LOCKS_REQUIRED(cs) { return mapTx.iterator_to(*entry); }
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
-    struct TxLinks {
-        setEntries parents;
-        setEntries children;
-    };
-
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
-    txlinksMap mapLinks;
-
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -557,6 +599,42 @@ public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
     std::map<uint256, CAmount> mapDeltas;
 
+    /**
+     * The transactions selected by the last block template, kept up to date
+     * with the mempool so that the next template on the same tip starts from
+     * them and only selects among the transactions added since, see
+     * BlockAssembler::addPackageTxs.
+     *
+     * Removing a transaction from the mempool also removes its descendants,
+     * except when it is confirmed, which changes the tip. The selection stays
+     * valid without the removed transactions, unless a package did not fit
+     * in it: the removal may have made room for that package.
+     */
+    struct BlockCandidate {
+        //! Whether the selection can be used
+        bool fValid{false};
+        //! The tip and assembler settings the selection was made for
+        uint256 hashPrevBlock;
+        uint64_t nBlockMaxWeight{0};
+        CFeeRate blockMinFeeRate;
+        bool fIncludeWitness{false};
+        //! A package did not fit in the selection
+        bool fFull{false};
+        //! The selected transactions in block order, removed ones are skipped
+        std::vector<uint256> vSelected;
+        //! The transactions added to the mempool since the selection
+        std::vector<uint256> vAdded;
+
+        void Clear()
+        {
+            fValid = false;
+            fFull = false;
+            std::vector<uint256>().swap(vSelected);
+            std::vector<uint256>().swap(vAdded);
+        }
+    };
+    BlockCandidate blockCandidate GUARDED_BY(cs);
+
     /** Create a new CTxMemPool.
      */
     explicit CTxMemPool(CBlockPolicyEstimator* estimator = nullptr);
@@ -22,6 +22,8 @@
 #include <kernel.h>
 #include <index/txindex.h>
 #include <net.h>
+#include <node/blockprefetch.h>
+#include <node/utxo_snapshot.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
@@ -327,6 +329,8 @@ static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfte
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
 static FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
 bool CheckFinalTx(const CTransaction &tx, int flags)
 {
     AssertLockHeld(cs_main);
@@ -573,14 +577,51 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
     return CheckInputs(tx, state, view, true, flags, cacheSigStore, true, txdata);
 }
 
-static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx,
-                              bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
-                              bool bypass_limits, const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache, bool test_accept) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+namespace {
+/** A transaction between the steps of its acceptance to the mempool */
+struct ATMPWorkspace
 {
+    explicit ATMPWorkspace(const CTransactionRef& ptx) : m_ptx(ptx), m_hash(ptx->GetHash()), m_view(&m_dummy) {}
+
+    const CTransactionRef m_ptx;
+    const uint256 m_hash;
+    //! Mempool transactions spending the same outputs
+    std::set<uint256> m_conflicts;
+    //! The coins spent by the transaction, detached from the mempool
+    CCoinsView m_dummy;
+    CCoinsViewCache m_view;
+    std::unique_ptr<CTxMemPoolEntry> m_entry;
+    CTxMemPool::setEntries m_ancestors;
+    CTxMemPool::setEntries m_all_conflicting;
+    CAmount m_modified_fees{0};
+    CAmount m_conflicting_fees{0};
+    size_t m_conflicting_size{0};
+    std::unique_ptr<PrecomputedTransactionData> m_txdata;
+};
+} // namespace
+
+static bool CalculateAncestors(const CTxMemPool& pool, const CTxMemPoolEntry& entry, CTxMemPool::setEntries& setAncestors, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+    size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
+    size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+    size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
+    std::string errString;
+    if (!pool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
+        return state.DoS(0, false, REJECT_NONSTANDARD, "too-long-mempool-chain", false, errString);
+    }
+    return true;
+}
+
+/** Policy and context checks of a transaction, everything but its scripts. */
+static bool PreChecks(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, ATMPWorkspace& ws,
+                      bool* pfMissingInputs, int64_t nAcceptTime, bool bypass_limits, const CAmount& nAbsurdFee,
+                      std::vector<COutPoint>& coins_to_uncache) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    const CTransactionRef& ptx = ws.m_ptx;
     const CTransaction& tx = *ptx;
-    const uint256 hash = tx.GetHash();
+    const uint256& hash = ws.m_hash;
     AssertLockHeld(cs_main);
-    LOCK(pool.cs); // mempool "read lock" (held through GetMainSignals().TransactionAddedToMempool())
     if (pfMissingInputs) {
         *pfMissingInputs = false;
     }
@@ -626,7 +667,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
     }
 
     // Check for conflicts with in-memory transactions
-    std::set<uint256> setConflicts;
+    std::set<uint256>& setConflicts = ws.m_conflicts;
     for (const CTxIn &txin : tx.vin)
     {
         const CTransaction* ptxConflicting = pool.GetConflictTx(txin.prevout);
@@ -667,8 +708,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
     }
 
     {
-        CCoinsView dummy;
-        CCoinsViewCache view(&dummy);
+        CCoinsViewCache& view = ws.m_view;
 
         LockPoints lp;
         CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
@@ -699,7 +739,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         view.GetBestBlock();
 
         // we have all inputs cached now, so switch back to dummy, so we don't need to keep lock on mempool
-        view.SetBackend(dummy);
+        view.SetBackend(ws.m_dummy);
 
         // Only accept BIP68 sequence locked transactions that can be mined in the next
         // block; we don't want our mempool filled up with transactions that can't
@@ -725,7 +765,8 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         int64_t nSigOpsCost = GetTransactionSigOpCost(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS);
 
         // nModifiedFees includes any fee deltas from PrioritiseTransaction
-        CAmount nModifiedFees = nFees;
+        CAmount& nModifiedFees = ws.m_modified_fees;
+        nModifiedFees = nFees;
         pool.ApplyDelta(hash, nModifiedFees);
 
         // Keep track of transactions that spend a coinbase, which we re-scan
@@ -739,8 +780,9 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
             }
         }
 
-        CTxMemPoolEntry entry(ptx, nFees, nAcceptTime, chainActive.Height(),
-                              fSpendsCoinbase, nSigOpsCost, lp);
+        ws.m_entry = MakeUnique<CTxMemPoolEntry>(ptx, nFees, nAcceptTime, chainActive.Height(),
+                                                 fSpendsCoinbase, nSigOpsCost, lp);
+        const CTxMemPoolEntry& entry = *ws.m_entry;
         unsigned int nSize = entry.GetTxSize();
 
         // Check that the transaction doesn't have an excessive number of
@@ -768,14 +810,9 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
                 strprintf("%d > %d", nFees, nAbsurdFee));
 
         // Calculate in-mempool ancestors, up to a limit.
-        CTxMemPool::setEntries setAncestors;
-        size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
-        size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
-        size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
-        size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
-        std::string errString;
-        if (!pool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
-            return state.DoS(0, false, REJECT_NONSTANDARD, "too-long-mempool-chain", false, errString);
+        CTxMemPool::setEntries& setAncestors = ws.m_ancestors;
+        if (!CalculateAncestors(pool, entry, setAncestors, state)) {
+            return false;
         }
 
         // A transaction that spends outputs that would be replaced by it is invalid. Now
@@ -797,10 +834,10 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 
         // Check if it's economically rational to mine this transaction rather
         // than the ones it replaces.
-        CAmount nConflictingFees = 0;
-        size_t nConflictingSize = 0;
+        CAmount& nConflictingFees = ws.m_conflicting_fees;
+        size_t& nConflictingSize = ws.m_conflicting_size;
         uint64_t nConflictingCount = 0;
-        CTxMemPool::setEntries allConflicting;
+        CTxMemPool::setEntries& allConflicting = ws.m_all_conflicting;
 
         // If we don't hold the lock allConflicting might be incomplete; the
         // subsequent RemoveStaged() and addUnchecked() calls don't guarantee
@@ -911,80 +948,141 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
                               FormatMoney(::incrementalRelayFee.GetFee(nSize))));
             }
         }
+    }
+    return true;
+}
 
-        constexpr unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
-
-        // Check against previous transactions
-        // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        PrecomputedTransactionData txdata(tx);
-        if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, false, txdata)) {
-            // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
-            // need to turn both off, and compare against just turning off CLEANSTACK
-            // to see if the failure is specifically due to witness validation.
-            CValidationState stateDummy; // Want reported failures to be from first CheckInputs
-            if (!tx.HasWitness() && CheckInputs(tx, stateDummy, view, true, scriptVerifyFlags & ~(SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_CLEANSTACK), true, false, txdata) &&
-                !CheckInputs(tx, stateDummy, view, true, scriptVerifyFlags & ~SCRIPT_VERIFY_CLEANSTACK, true, false, txdata)) {
-                // Only the witness is missing, so the transaction itself may be fine.
-                state.SetCorruptionPossible();
-            }
-            return false; // state filled in by CheckInputs
-        }
-
-        // Check again against the current block tip's script verification
-        // flags to cache our script execution flags. This is, of course,
-        // useless if the next block has different script flags from the
-        // previous one, but because the cache tracks script flags for us it
-        // will auto-invalidate and we'll just have a few blocks of extra
-        // misses on soft-fork activation.
-        //
-        // This is also useful in case of bugs in the standard flags that cause
-        // transactions to pass as valid when they're actually invalid. For
-        // instance the STRICTENC flag was incorrectly allowing certain
-        // CHECKSIG NOT scripts to pass, even though they were invalid.
-        //
-        // There is a similar check in CreateNewBlock() to prevent creating
-        // invalid blocks (using TestBlockValidity), however allowing such
-        // transactions into the mempool can be exploited as a DoS attack.
-        unsigned int currentBlockScriptVerifyFlags = GetBlockScriptFlags(chainActive.Tip(), chainparams.GetConsensus());
-        if (!CheckInputsFromMempoolAndCache(tx, state, view, pool, currentBlockScriptVerifyFlags, true, txdata)) {
-            return error("%s: BUG! PLEASE REPORT THIS! CheckInputs failed against latest-block but not STANDARD flags %s, %s",
-                    __func__, hash.ToString(), FormatStateMessage(state));
-        }
-
-        if (test_accept) {
-            // Tx was accepted, but not added
-            return true;
-        }
+/**
+ * Check the scripts of a transaction against the standard flags. With pvChecks
+ * the script checks are appended to it instead of being run, and a failure is
+ * only reported by running them.
+ */
+static bool PolicyScriptChecks(CValidationState& state, ATMPWorkspace& ws, std::vector<CScriptCheck>* pvChecks = nullptr)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const CTransaction& tx = *ws.m_ptx;
+    const CCoinsViewCache& view = ws.m_view;
+
+    constexpr unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
+
+    // Check against previous transactions
+    // This is done last to help prevent CPU exhaustion denial-of-service attacks.
+    ws.m_txdata = MakeUnique<PrecomputedTransactionData>(tx);
+    PrecomputedTransactionData& txdata = *ws.m_txdata;
+    if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, false, txdata, pvChecks)) {
+        // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
+        // need to turn both off, and compare against just turning off CLEANSTACK
+        // to see if the failure is specifically due to witness validation.
+        CValidationState stateDummy; // Want reported failures to be from first CheckInputs
+        if (!tx.HasWitness() && CheckInputs(tx, stateDummy, view, true, scriptVerifyFlags & ~(SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_CLEANSTACK), true, false, txdata) &&
+            !CheckInputs(tx, stateDummy, view, true, scriptVerifyFlags & ~SCRIPT_VERIFY_CLEANSTACK, true, false, txdata)) {
+            // Only the witness is missing, so the transaction itself may be fine.
+            state.SetCorruptionPossible();
+        }
+        return false; // state filled in by CheckInputs
+    }
+    return true;
+}
 
-        // Remove conflicting transactions from the mempool
-        for (CTxMemPool::txiter it : allConflicting)
-        {
-            LogPrint(BCLog::MEMPOOL, "replacing tx %s with %s for %s BTC additional fees, %d delta bytes\n",
-                    it->GetTx().GetHash().ToString(),
-                    hash.ToString(),
-                    FormatMoney(nModifiedFees - nConflictingFees),
-                    (int)nSize - (int)nConflictingSize);
-            if (plTxnReplaced)
-                plTxnReplaced->push_back(it->GetSharedTx());
+/**
+ * Check a transaction that passed the policy checks against the flags of the
+ * next block and add it to the mempool. The mempool is not trimmed. If the
+ * mempool changed since the prechecks, the ancestors are calculated again.
+ */
+static bool Finalize(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, ATMPWorkspace& ws,
+                     std::list<CTransactionRef>* plTxnReplaced, bool bypass_limits, bool test_accept, bool recalc_ancestors)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    const CTransaction& tx = *ws.m_ptx;
+    const uint256& hash = ws.m_hash;
+    const CCoinsViewCache& view = ws.m_view;
+    PrecomputedTransactionData& txdata = *ws.m_txdata;
+    const CAmount& nModifiedFees = ws.m_modified_fees;
+    const unsigned int nSize = ws.m_entry->GetTxSize();
+    const bool fReplacementTransaction = ws.m_conflicts.size();
+
+    // Check again against the current block tip's script verification
+    // flags to cache our script execution flags. This is, of course,
+    // useless if the next block has different script flags from the
+    // previous one, but because the cache tracks script flags for us it
+    // will auto-invalidate and we'll just have a few blocks of extra
+    // misses on soft-fork activation.
+    //
+    // This is also useful in case of bugs in the standard flags that cause
+    // transactions to pass as valid when they're actually invalid. For
+    // instance the STRICTENC flag was incorrectly allowing certain
+    // CHECKSIG NOT scripts to pass, even though they were invalid.
+    //
+    // There is a similar check in CreateNewBlock() to prevent creating
+    // invalid blocks (using TestBlockValidity), however allowing such
+    // transactions into the mempool can be exploited as a DoS attack.
+    unsigned int currentBlockScriptVerifyFlags = GetBlockScriptFlags(chainActive.Tip(), chainparams.GetConsensus());
+    if (!CheckInputsFromMempoolAndCache(tx, state, view, pool, currentBlockScriptVerifyFlags, true, txdata)) {
+        return error("%s: BUG! PLEASE REPORT THIS! CheckInputs failed against latest-block but not STANDARD flags %s, %s",
+                __func__, hash.ToString(), FormatStateMessage(state));
+    }
+
+    if (test_accept) {
+        // Tx was accepted, but not added
+        return true;
+    }
+
+    if (recalc_ancestors) {
+        ws.m_ancestors.clear();
+        if (!CalculateAncestors(pool, *ws.m_entry, ws.m_ancestors, state)) {
+            return false;
         }
-        pool.RemoveStaged(allConflicting, false, MemPoolRemovalReason::REPLACED);
+    }
 
-        // This transaction should only count for fee estimation if:
-        // - it isn't a BIP 125 replacement transaction (may not be widely supported)
-        // - it's not being re-added during a reorg which bypasses typical mempool fee limits
-        // - the node is not behind
-        // - the transaction is not dependent on any other transactions in the mempool
-        bool validForFeeEstimation = !fReplacementTransaction && !bypass_limits && IsCurrentForFeeEstimation() && pool.HasNoInputsOf(tx);
+    // Remove conflicting transactions from the mempool
+    for (CTxMemPool::txiter it : ws.m_all_conflicting)
+    {
+        LogPrint(BCLog::MEMPOOL, "replacing tx %s with %s for %s BTC additional fees, %d delta bytes\n",
+                it->GetTx().GetHash().ToString(),
+                hash.ToString(),
+                FormatMoney(nModifiedFees - ws.m_conflicting_fees),
+                (int)nSize - (int)ws.m_conflicting_size);
+        if (plTxnReplaced)
+            plTxnReplaced->push_back(it->GetSharedTx());
+    }
+    pool.RemoveStaged(ws.m_all_conflicting, false, MemPoolRemovalReason::REPLACED);
+
+    // This transaction should only count for fee estimation if:
+    // - it isn't a BIP 125 replacement transaction (may not be widely supported)
+    // - it's not being re-added during a reorg which bypasses typical mempool fee limits
+    // - the node is not behind
+    // - the transaction is not dependent on any other transactions in the mempool
+    bool validForFeeEstimation = !fReplacementTransaction && !bypass_limits && IsCurrentForFeeEstimation() && pool.HasNoInputsOf(tx);
+
+    // Store transaction in memory
+    pool.addUnchecked(*ws.m_entry, ws.m_ancestors, validForFeeEstimation);
+    return true;
+}
 
-        // Store transaction in memory
-        pool.addUnchecked(entry, setAncestors, validForFeeEstimation);
+static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx,
+                              bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
+                              bool bypass_limits, const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache, bool test_accept) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    LOCK(pool.cs); // mempool "read lock" (held through GetMainSignals().TransactionAddedToMempool())
 
-        // trim mempool and check if tx was trimmed
-        if (!bypass_limits) {
-            LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
-            if (!pool.exists(hash))
-                return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
-        }
+    ATMPWorkspace ws(ptx);
+    if (!PreChecks(chainparams, pool, state, ws, pfMissingInputs, nAcceptTime, bypass_limits, nAbsurdFee, coins_to_uncache))
+        return false;
+    if (!PolicyScriptChecks(state, ws))
+        return false;
+    if (!Finalize(chainparams, pool, state, ws, plTxnReplaced, bypass_limits, test_accept, false))
+        return false;
+    if (test_accept) {
+        // Tx was accepted, but not added
+        return true;
+    }
+
+    // trim mempool and check if tx was trimmed
+    if (!bypass_limits) {
+        LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+        if (!pool.exists(ws.m_hash))
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
     }
 
     GetMainSignals().TransactionAddedToMempool(ptx);
@@ -1017,6 +1115,135 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee, test_accept);
 }
 
+namespace {
+/** Transactions of a batch that passed their prechecks and do not depend on each other */
+struct ATMPWave
+{
+    std::vector<std::pair<size_t, std::unique_ptr<ATMPWorkspace>>> txs;
+    std::set<uint256> txids;
+    std::set<COutPoint> spent;
+
+    bool Conflicts(const CTransaction& tx, const CTxMemPool& pool) const EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+    {
+        for (const CTxIn& txin : tx.vin) {
+            if (txids.count(txin.prevout.hash) || spent.count(txin.prevout) || pool.GetConflictTx(txin.prevout))
+                return true;
+        }
+        return false;
+    }
+
+    void Add(size_t i, std::unique_ptr<ATMPWorkspace> ws)
+    {
+        for (const CTxIn& txin : ws->m_ptx->vin)
+            spent.insert(txin.prevout);
+        txids.insert(ws->m_hash);
+        txs.emplace_back(i, std::move(ws));
+    }
+};
+} // namespace
+
+/** Check the scripts of a wave on the script check threads and add its transactions to the mempool */
+static void AcceptWave(const CChainParams& chainparams, CTxMemPool& pool, ATMPWave& wave, std::vector<MempoolAcceptResult>& results,
+                       bool bypass_limits) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    if (wave.txs.empty())
+        return;
+
+    bool fScriptsChecked = false;
+    if (nScriptCheckThreads) {
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        bool fQueued = true;
+        for (auto& item : wave.txs) {
+            std::vector<CScriptCheck> vChecks;
+            if (!PolicyScriptChecks(results[item.first].state, *item.second, &vChecks)) {
+                fQueued = false;
+                break;
+            }
+            control.Add(vChecks);
+        }
+        fScriptsChecked = control.Wait() && fQueued;
+    }
+
+    for (auto& item : wave.txs) {
+        MempoolAcceptResult& result = results[item.first];
+        ATMPWorkspace& ws = *item.second;
+        // Without script check threads, or if a script of the wave failed,
+        // the scripts are checked per transaction to find the invalid ones
+        // and their reject reasons. The signatures that were valid are found
+        // in the signature cache.
+        if (!fScriptsChecked) {
+            result.state = CValidationState();
+            if (!PolicyScriptChecks(result.state, ws))
+                continue;
+        }
+        if (!Finalize(chainparams, pool, result.state, ws, &result.replaced, bypass_limits, false, true))
+            continue;
+        result.accepted = true;
+    }
+
+    // Trim the mempool once for the whole wave
+    if (!bypass_limits) {
+        LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+    }
+    for (auto& item : wave.txs) {
+        MempoolAcceptResult& result = results[item.first];
+        if (!result.accepted)
+            continue;
+        if (!pool.exists(item.second->m_hash)) {
+            result.accepted = false;
+            result.state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
+            continue;
+        }
+        GetMainSignals().TransactionAddedToMempool(item.second->m_ptx);
+    }
+
+    wave = ATMPWave();
+}
+
+void AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& txs, std::vector<MempoolAcceptResult>& results,
+                             bool bypass_limits, const std::vector<int64_t>* accept_times)
+{
+    AssertLockHeld(cs_main);
+    assert(!accept_times || accept_times->size() == txs.size());
+    const CChainParams& chainparams = Params();
+    const int64_t nAcceptTime = GetTime();
+    results.clear();
+    results.resize(txs.size());
+
+    std::vector<std::vector<COutPoint>> coins_to_uncache(txs.size());
+    {
+        LOCK(pool.cs);
+        ATMPWave wave;
+        for (size_t i = 0; i < txs.size(); ++i) {
+            // A transaction that spends or conflicts with a transaction of the
+            // wave, or replaces mempool transactions, is checked once the wave
+            // is in the mempool
+            if (wave.Conflicts(*txs[i], pool))
+                AcceptWave(chainparams, pool, wave, results, bypass_limits);
+
+            std::unique_ptr<ATMPWorkspace> ws = MakeUnique<ATMPWorkspace>(txs[i]);
+            const int64_t nTxAcceptTime = accept_times ? (*accept_times)[i] : nAcceptTime;
+            if (!PreChecks(chainparams, pool, results[i].state, *ws, &results[i].missing_inputs, nTxAcceptTime, bypass_limits, 0, coins_to_uncache[i]))
+                continue;
+            const bool fReplacement = !ws->m_conflicts.empty();
+            wave.Add(i, std::move(ws));
+            if (fReplacement || wave.txs.size() >= MAX_ATMP_WAVE_SIZE)
+                AcceptWave(chainparams, pool, wave, results, bypass_limits);
+        }
+        AcceptWave(chainparams, pool, wave, results, bypass_limits);
+    }
+
+    for (size_t i = 0; i < txs.size(); ++i) {
+        if (results[i].accepted)
+            continue;
+        for (const COutPoint& outpoint : coins_to_uncache[i])
+            pcoinsTip->Uncache(outpoint);
+    }
+    // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
+    CValidationState stateDummy;
+    FlushStateToDisk(chainparams, stateDummy, FlushStateMode::PERIODIC);
+}
+
 /**
  * Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock.
  * If blockIndex is provided, the transaction is fetched from the corresponding block.
@@ -1108,6 +1335,17 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     return true;
 }
 
+/** Check the proof of stake of a block read from disk, which needs the index of the block */
+static bool CheckStakeOfDiskBlock(const CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    if (block.IsProofOfStake()) { // TODO Blocknet check PoS here
+        uint256 hashProofOfStake;
+        if (!CheckProofOfStake(block, pindex->pprev, hashProofOfStake, consensusParams))
+            return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): proof of stake check failed on block %u", pindex->nHeight);
+    }
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     CDiskBlockPos blockPos;
@@ -1120,11 +1358,8 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
         return false;
 
     // Check the header
-    if (block.IsProofOfStake()) { // TODO Blocknet check PoS here
-        uint256 hashProofOfStake;
-        if (!CheckProofOfStake(block, pindex->pprev, hashProofOfStake, consensusParams))
-            return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): proof of stake check failed on block %u", pindex->nHeight);
-    }
+    if (!CheckStakeOfDiskBlock(block, pindex, consensusParams))
+        return false;
 
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -1500,7 +1735,9 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 {
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
@@ -1531,6 +1768,8 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1695,8 +1934,6 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck() {
     RenameThread("blocknet-scriptch");
     scriptcheckqueue.Thread();
@@ -2142,9 +2379,6 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                     return AbortNode(state, "Failed to write to block index database");
                 }
             }
-            // Finally remove any pruned files
-            if (fFlushForPrune)
-                UnlinkPrunedFiles(setFilesToPrune);
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -2157,11 +2391,26 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
-                return AbortNode(state, "Failed to write to coin database");
+            // Unless the state has to be on disk when we return, the coins are
+            // written in the background while validation continues. Flushes
+            // to free memory empty the cache, other flushes keep it warm.
+            // Pruning needs the chainstate on disk before any block or undo
+            // file it might still be replayed from is removed.
+            if (mode == FlushStateMode::ALWAYS || fFlushForPrune) {
+                if (!pcoinsTip->Flush())
+                    return AbortNode(state, "Failed to write to coin database");
+            } else {
+                CCoinsMap mapDirty;
+                pcoinsTip->MoveDirtyCoins(mapDirty, fCacheLarge || fCacheCritical);
+                if (!pcoinsdbview->BatchWriteAsync(std::move(mapDirty), pcoinsTip->GetBestBlock()))
+                    return AbortNode(state, "Failed to write to coin database");
+            }
             nLastFlush = nNow;
             full_flush_completed = true;
         }
+        // Finally remove any pruned files
+        if (fFlushForPrune)
+            UnlinkPrunedFiles(setFilesToPrune);
     }
     if (full_flush_completed) {
         // Update best block in wallet (so we can detect restored wallets).
@@ -2397,10 +2646,19 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
-            return AbortNode(state, "Failed to read block");
-        pthisBlock = pblockNew;
+        // Blocks read ahead were hashed and compared with the index by the
+        // prefetcher, only their proof of stake is left to check.
+        std::shared_ptr<const CBlock> pblockPrefetched = g_block_prefetcher ? g_block_prefetcher->Take(pindexNew) : nullptr;
+        if (pblockPrefetched) {
+            if (!CheckStakeOfDiskBlock(*pblockPrefetched, pindexNew, chainparams.GetConsensus()))
+                return AbortNode(state, "Failed to read block");
+            pthisBlock = pblockPrefetched;
+        } else {
+            std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+                return AbortNode(state, "Failed to read block");
+            pthisBlock = pblockNew;
+        }
     } else {
         pthisBlock = pblock;
     }
@@ -2425,9 +2683,13 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint(BCLog::BENCH, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
-    // Write the chain state to disk, if necessary.
-    if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
+    // Write the chain state to disk, if necessary. The chain state at the base
+    // of a loaded UTXO snapshot is always flushed to compare it with the snapshot.
+    const bool fSnapshotBase = g_utxo_snapshot && g_utxo_snapshot->IsBase(pindexNew);
+    if (!FlushStateToDisk(chainparams, state, fSnapshotBase ? FlushStateMode::ALWAYS : FlushStateMode::IF_NEEDED))
         return false;
+    if (fSnapshotBase)
+        g_utxo_snapshot->StartValidation(std::unique_ptr<CCoinsViewCursor>(pcoinsdbview->Cursor()));
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
     // Remove conflicting transactions from the mempool.;
@@ -2539,6 +2801,10 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
         fBlocksDisconnected = true;
     }
 
+    // Read the next blocks on the way on worker threads while they are connected.
+    if (g_block_prefetcher)
+        g_block_prefetcher->Prefetch(chainActive.Tip(), pindexMostWork, pblock != nullptr);
+
     // Build list of new blocks to connect.
     std::vector<CBlockIndex*> vpindexToConnect;
     bool fContinue = true;
@@ -4849,7 +5115,6 @@ static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
 bool LoadMempool()
 {
-    const CChainParams& chainparams = Params();
     int64_t nExpiryTimeout = gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
     FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat", "rb");
     CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
@@ -4863,6 +5128,40 @@ bool LoadMempool()
     int64_t failed = 0;
     int64_t already_there = 0;
     int64_t nNow = GetTime();
+    int64_t nStart = GetTimeMicros();
+
+    // The transactions are accepted in batches, their scripts are checked on
+    // the script check threads. cs_main is released between batches so that
+    // the node keeps processing blocks and serving peers while loading.
+    std::vector<CTransactionRef> txs;
+    std::vector<int64_t> times;
+    std::vector<MempoolAcceptResult> results;
+    auto accept_batch = [&] {
+        // The batch is taken out first, a batch that throws is not accepted again
+        std::vector<CTransactionRef> batch;
+        std::vector<int64_t> batch_times;
+        batch.swap(txs);
+        batch_times.swap(times);
+        {
+            LOCK(cs_main);
+            AcceptToMemoryPoolBatch(mempool, batch, results, false /* bypass_limits */, &batch_times);
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (results[i].accepted) {
+                ++count;
+            } else {
+                // mempool may contain the transaction already, e.g. from
+                // wallet(s) having loaded it while we were processing
+                // mempool transactions; consider these as valid, instead of
+                // failed, but mark them as 'already there'
+                if (mempool.exists(batch[i]->GetHash())) {
+                    ++already_there;
+                } else {
+                    ++failed;
+                }
+            }
+        }
+    };
 
     try {
         uint64_t version;
@@ -4884,31 +5183,19 @@ bool LoadMempool()
             if (amountdelta) {
                 mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
-            CValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
-                                           false /* test_accept */);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (mempool.exists(tx->GetHash())) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
-                }
+                txs.push_back(std::move(tx));
+                times.push_back(nTime);
             } else {
                 ++expired;
             }
+            if (txs.size() >= MAX_ATMP_WAVE_SIZE) {
+                accept_batch();
+            }
             if (ShutdownRequested())
                 return false;
         }
+        accept_batch();
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
 
@@ -4917,10 +5204,15 @@ bool LoadMempool()
         }
     } catch (const std::exception& e) {
         LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        // Accept the transactions read before the error
+        if (!txs.empty()) {
+            accept_batch();
+            LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there (%.2fs)\n", count, failed, expired, already_there, (GetTimeMicros() - nStart) * MICRO);
+        }
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
+    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there (%.2fs)\n", count, failed, expired, already_there, (GetTimeMicros() - nStart) * MICRO);
     return true;
 }
 
@@ -5099,7 +5391,28 @@ bool SignBlock(CBlock & block, const CScript & stakeScript, const CKeyStore & ke
     return true;
 }
 
+/** Outputs that fit into a block, bounds the outputs of snapshot lookups in GetTxFunc */
+static const uint32_t MAX_OUTPUTS_PER_BLOCK = MAX_BLOCK_WEIGHT / ::GetSerializeSize(CTxOut(), PROTOCOL_VERSION);
+
 CTransactionRef GetTxFunc(const COutPoint & out) {
+    // Until the chain reaches the base of a loaded UTXO snapshot the coins are
+    // looked up in the snapshot. Callers only read the output being checked,
+    // the other outputs of the returned transaction are empty.
+    if (g_utxo_snapshot && g_utxo_snapshot->IsActive()) {
+        Coin coin;
+        if (out.n >= MAX_OUTPUTS_PER_BLOCK || !g_utxo_snapshot->GetCoin(out, coin))
+            return nullptr;
+        {
+            LOCK(mempool.cs);
+            if (mempool.isSpent(out))
+                return nullptr;
+        }
+        CMutableTransaction mtx;
+        mtx.vout.resize(out.n + 1);
+        mtx.vout[out.n] = coin.out;
+        return MakeTransactionRef(std::move(mtx));
+    }
+
     CTransactionRef tx;
     uint256 hashBlock;
     if (!GetTransaction(out.hash, tx, Params().GetConsensus(), hashBlock))
@@ -5116,9 +5429,11 @@ CTransactionRef GetTxFunc(const COutPoint & out) {
 
 bool IsServiceNodeBlockValidFunc(const uint64_t & blockNumber, const uint256 & blockHash, const bool & checkStale) {
     LOCK(cs_main);
-    if (checkStale && blockNumber < chainActive.Height() - SNODE_STALE_BLOCKS) // check if stale
+    // Until the chain reaches the base of a loaded UTXO snapshot, check against the best header chain
+    const CBlockIndex *tip = g_utxo_snapshot && g_utxo_snapshot->IsActive() && pindexBestHeader ? pindexBestHeader : chainActive.Tip();
+    if (checkStale && blockNumber < tip->nHeight - SNODE_STALE_BLOCKS) // check if stale
         return false; // only accept blocks that meet the threshold
-    const auto block = chainActive.Tip()->GetAncestor(blockNumber);
+    const auto block = tip->GetAncestor(blockNumber);
     if (!block)
         return false; // fail if block wasn't found
     return block->GetBlockHash() == blockHash;
@@ -12,6 +12,7 @@
 
 #include <amount.h>
 #include <coins.h>
+#include <consensus/validation.h>
 #include <crypto/common.h> // for ReadLE64
 #include <fs.h>
 #include <keystore.h>
@@ -27,6 +28,7 @@
 
 #include <algorithm>
 #include <exception>
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
@@ -39,6 +41,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
 class CCoinsViewDB;
 class CInv;
@@ -138,6 +141,7 @@ static const unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
 static const int MAX_UNCONNECTING_HEADERS = 10;
 
 static const bool DEFAULT_PEERBLOOMFILTERS = true;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
 
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
@@ -313,6 +317,29 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                         bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced,
                         bool bypass_limits, const CAmount nAbsurdFee, bool test_accept=false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Maximum number of transactions whose scripts are checked together by AcceptToMemoryPoolBatch */
+static const size_t MAX_ATMP_WAVE_SIZE = 1000;
+
+/** The outcome of a transaction passed to AcceptToMemoryPoolBatch */
+struct MempoolAcceptResult
+{
+    bool accepted{false};
+    //! The transaction spends outputs that were not found, see AcceptToMemoryPool
+    bool missing_inputs{false};
+    CValidationState state;
+    //! Transactions replaced from the mempool
+    std::list<CTransactionRef> replaced;
+};
+
+/** (try to) add a batch of transactions to the memory pool, in order. The
+ * policy and context checks run in series, the scripts of transactions that
+ * do not depend on each other are checked together on the script check
+ * threads. The results are in the order of the transactions. If accept_times
+ * is set it holds the acceptance time of each transaction, otherwise they
+ * are accepted at the current time. **/
+void AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& txs, std::vector<MempoolAcceptResult>& results,
+                             bool bypass_limits, const std::vector<int64_t>* accept_times = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Convert CValidationState to a human-readable message for logging */
 std::string FormatStateMessage(const CValidationState &state);
 
@@ -403,6 +430,8 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
+
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
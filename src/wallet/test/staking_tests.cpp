@@ -424,6 +424,35 @@ BOOST_FIXTURE_TEST_CASE(staking_tests_stakes, TestChainPoS)
     // TODO Blocknet PoS unit test for p2pkh stakes
 }
 
+/// Ensure that a block prepared ahead of the stake is completed with the stake and accepted.
+BOOST_FIXTURE_TEST_CASE(staking_tests_template_cache, TestChainPoS)
+{
+    StakeTemplateCache cache(Params());
+    const StakeMgr::StakeCoin stake = FindStake();
+    BOOST_REQUIRE(stake.coin != nullptr);
+
+    // Nothing prepared yet
+    BOOST_CHECK(cache.CreateBlock(*stake.coin, stake.hashBlock, stake.time, stake.wallet.get()) == nullptr);
+
+    cache.Refresh();
+    auto blocktemplate = cache.CreateBlock(*stake.coin, stake.hashBlock, stake.time, stake.wallet.get());
+    BOOST_REQUIRE(blocktemplate != nullptr);
+    BOOST_CHECK_EQUAL(blocktemplate->block.hashPrevBlock, chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK(blocktemplate->block.IsProofOfStake());
+
+    // The prepared block is kept for other stakes
+    BOOST_CHECK(cache.CreateBlock(*stake.coin, stake.hashBlock, stake.time, stake.wallet.get()) != nullptr);
+
+    auto block = std::make_shared<const CBlock>(blocktemplate->block);
+    bool fNewBlock{false};
+    BOOST_CHECK(ProcessNewBlock(Params(), block, true, &fNewBlock));
+    BOOST_CHECK(fNewBlock);
+    BOOST_CHECK_EQUAL(chainActive.Tip()->GetBlockHash(), block->GetHash());
+
+    // The prepared block builds on the previous tip
+    BOOST_CHECK(cache.CreateBlock(*stake.coin, stake.hashBlock, stake.time, stake.wallet.get()) == nullptr);
+}
+
 /// Check CLTV
 BOOST_FIXTURE_TEST_CASE(staking_tests_cltv, TestChainPoS)
 {
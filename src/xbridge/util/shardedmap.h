@@ -0,0 +1,263 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef BLOCKNET_XBRIDGE_UTIL_SHARDEDMAP_H
+#define BLOCKNET_XBRIDGE_UTIL_SHARDEDMAP_H
+
+#include <sync.h>
+#include <uint256.h>
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <vector>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace xbridge
+{
+
+/**
+ * @brief Map keyed by order id, split into independently locked copy-on-write shards.
+ *
+ * Readers take a reference counted snapshot of each shard under a short lock and
+ * iterate it without holding any lock. Writers modify a shard in place, unless a
+ * snapshot of that shard is still alive, in which case the shard is copied first.
+ * Writers to different shards never contend, and a reader never holds a lock for
+ * longer than a pointer copy.
+ */
+template <typename T, size_t NShards = 16>
+class ShardedMap
+{
+public:
+    typedef std::map<uint256, T>        Map;
+    typedef std::shared_ptr<const Map>  MapPtr;
+
+    /**
+     * @brief Immutable view of the whole map. Each shard is consistent, shards are
+     * captured one after another.
+     */
+    class Snapshot
+    {
+        friend class ShardedMap;
+
+    public:
+        class const_iterator
+        {
+            friend class Snapshot;
+
+        public:
+            typedef std::forward_iterator_tag              iterator_category;
+            typedef const typename Map::value_type         value_type;
+            typedef std::ptrdiff_t                         difference_type;
+            typedef value_type *                           pointer;
+            typedef value_type &                           reference;
+
+            const typename Map::value_type & operator * () const { return *m_it; }
+            const typename Map::value_type * operator -> () const { return &*m_it; }
+            const_iterator & operator ++ () { ++m_it; skipEmpty(); return *this; }
+            bool operator == (const const_iterator & other) const
+            {
+                return m_shard == other.m_shard && (m_shard == NShards || m_it == other.m_it);
+            }
+            bool operator != (const const_iterator & other) const { return !(*this == other); }
+
+        private:
+            const_iterator(const Snapshot * s, const size_t shard) : m_s(s), m_shard(shard)
+            {
+                if (m_shard < NShards)
+                {
+                    m_it = m_s->m_shards[m_shard]->begin();
+                    skipEmpty();
+                }
+            }
+            void skipEmpty()
+            {
+                while (m_it == m_s->m_shards[m_shard]->end())
+                {
+                    if (++m_shard == NShards)
+                        return;
+                    m_it = m_s->m_shards[m_shard]->begin();
+                }
+            }
+
+        private:
+            const Snapshot *                 m_s;
+            size_t                           m_shard;
+            typename Map::const_iterator     m_it;
+        };
+
+    public:
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const   { return const_iterator(this, NShards); }
+
+        size_t size() const
+        {
+            size_t n = 0;
+            for (const MapPtr & shard : m_shards)
+                n += shard->size();
+            return n;
+        }
+        bool empty() const { return size() == 0; }
+
+        Map toMap() const { return Map(begin(), end()); }
+
+    private:
+        std::array<MapPtr, NShards> m_shards;
+    };
+
+public:
+    ShardedMap()
+    {
+        for (Shard & shard : m_shards)
+            shard.map = std::make_shared<Map>();
+    }
+
+    ShardedMap(const ShardedMap &) = delete;
+    ShardedMap & operator = (const ShardedMap &) = delete;
+
+    bool get(const uint256 & id, T & value) const
+    {
+        const Shard & shard = shardFor(id);
+        LOCK(shard.lock);
+        auto it = shard.map->find(id);
+        if (it == shard.map->end())
+            return false;
+        value = it->second;
+        return true;
+    }
+
+    bool contains(const uint256 & id) const
+    {
+        const Shard & shard = shardFor(id);
+        LOCK(shard.lock);
+        return shard.map->count(id) > 0;
+    }
+
+    /**
+     * @brief Insert or replace the value stored for id.
+     */
+    void set(const uint256 & id, const T & value)
+    {
+        Shard & shard = shardFor(id);
+        LOCK(shard.lock);
+        shard.writable()[id] = value;
+    }
+
+    /**
+     * @brief Insert the value only if id is not present.
+     * @return true if the value was inserted
+     */
+    bool insert(const uint256 & id, const T & value)
+    {
+        Shard & shard = shardFor(id);
+        LOCK(shard.lock);
+        if (shard.map->count(id))
+            return false;
+        shard.writable().emplace(id, value);
+        return true;
+    }
+
+    bool erase(const uint256 & id)
+    {
+        T value;
+        return extract(id, value);
+    }
+
+    /**
+     * @brief Remove id from the map and return its value.
+     * @return false if id is not present
+     */
+    bool extract(const uint256 & id, T & value)
+    {
+        Shard & shard = shardFor(id);
+        LOCK(shard.lock);
+        auto it = shard.map->find(id);
+        if (it == shard.map->end())
+            return false;
+        value = it->second;
+        shard.writable().erase(id);
+        return true;
+    }
+
+    /**
+     * @brief Remove all entries matching pred(id, value), erased values are appended to erased.
+     */
+    template <typename Pred>
+    void eraseIf(Pred pred, std::vector<T> & erased)
+    {
+        for (Shard & shard : m_shards)
+        {
+            LOCK(shard.lock);
+            std::vector<uint256> ids;
+            for (const auto & item : *shard.map)
+            {
+                if (pred(item.first, item.second))
+                    ids.push_back(item.first);
+            }
+            if (ids.empty())
+                continue;
+
+            Map & map = shard.writable();
+            for (const uint256 & id : ids)
+            {
+                auto it = map.find(id);
+                erased.push_back(it->second);
+                map.erase(it);
+            }
+        }
+    }
+
+    Snapshot snapshot() const
+    {
+        Snapshot s;
+        for (size_t i = 0; i < NShards; ++i)
+        {
+            LOCK(m_shards[i].lock);
+            s.m_shards[i] = m_shards[i].map;
+        }
+        return s;
+    }
+
+    size_t size() const
+    {
+        size_t n = 0;
+        for (const Shard & shard : m_shards)
+        {
+            LOCK(shard.lock);
+            n += shard.map->size();
+        }
+        return n;
+    }
+
+private:
+    struct Shard
+    {
+        mutable CCriticalSection  lock;
+        std::shared_ptr<Map>      map;
+
+        // copy the shard if a snapshot still references it, requires lock
+        Map & writable()
+        {
+            if (map.use_count() != 1)
+                map = std::make_shared<Map>(*map);
+            return *map;
+        }
+    };
+
+    Shard & shardFor(const uint256 & id) { return m_shards[id.GetUint64(0) % NShards]; }
+    const Shard & shardFor(const uint256 & id) const { return m_shards[id.GetUint64(0) % NShards]; }
+
+private:
+    std::array<Shard, NShards> m_shards;
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_UTIL_SHARDEDMAP_H
@@ -59,12 +59,13 @@ namespace {
 
         std::vector<CurrencyPair> records;
 
-        CBlockIndex * pindex = chainActive.Tip();
+        // Binary search the last block at or before the end of the query
+        const int64_t end_secs = (query.end() - boost::posix_time::from_time_t(0)).total_seconds();
+        CBlockIndex * pindex = chainActive.FindEarliestAtLeast(end_secs + 1);
+        pindex = pindex ? pindex->pprev : chainActive.Tip();
+        if (pindex == nullptr)
+            return records;
         auto ts = boost::posix_time::from_time_t(pindex->GetBlockTime());
-        while (pindex->pprev != nullptr && query.end() < ts) {
-            pindex = pindex->pprev;
-            ts = boost::posix_time::from_time_t(pindex->GetBlockTime());
-        }
 
         for (; pindex->pprev != nullptr && query.contains(ts);
              pindex = pindex->pprev, ts = boost::posix_time::from_time_t(pindex->GetBlockTime()))
@@ -9,12 +9,14 @@
 
 #include <xbridge/util/logger.h>
 #include <xbridge/util/settings.h>
+#include <xbridge/util/shardedmap.h>
 #include <xbridge/util/txlog.h>
 #include <xbridge/util/xassert.h>
 #include <xbridge/util/xbridgeerror.h>
 #include <xbridge/util/xseries.h>
 #include <xbridge/xbridgecryptoproviderbtc.h>
 #include <xbridge/xbridgeexchange.h>
+#include <xbridge/xbridgeorderjournal.h>
 #include <xbridge/xbridgewalletconnector.h>
 #include <xbridge/xbridgewalletconnectorbtc.h>
 #include <xbridge/xbridgewalletconnectorbch.h>
@@ -76,7 +78,10 @@ class App::Impl
 
     enum
     {
-        TIMER_INTERVAL = 15
+        TIMER_INTERVAL = 15,
+        BLOCK_POLL_INTERVAL = 5,
+        NEW_ORDER_RELAY_INTERVAL = 15,
+        PENDING_ORDER_RELAY_INTERVAL = 240
     };
 
 protected:
@@ -164,15 +169,76 @@ protected:
         const std::set<CPubKey> & notIn) const;
 
     /**
-     * @brief Checks the orders that are in the New and Pending states. If orders are stuck, rebroadcast to a
+     * @brief Wake the order at the specified time (default now). If the order is already
+     *        scheduled the earlier deadline is kept.
+     * @param id - order id
+     * @param when - deadline
+     */
+    void scheduleOrderCheck(const uint256 & id, const boost::posix_time::ptime & when = boost::posix_time::ptime());
+
+    /**
+     * @brief Arms the order deadline timer for the earliest scheduled order (timer thread only).
+     */
+    void armOrderDeadlineTimer();
+
+    /**
+     * @brief Posts the checks of all orders whose deadline is due (timer thread only).
+     */
+    void onOrderDeadline(const boost::system::error_code & error);
+
+    /**
+     * @brief Relays and expires a single order and schedules its next deadline.
+     * @param id - order id
+     */
+    void checkOrder(const uint256 & id);
+
+    /**
+     * @brief Next time the order has timed work to do in its current state.
+     * @return deadline or not_a_date_time if the order only progresses on state changes
+     */
+    boost::posix_time::ptime nextOrderDeadline(const TransactionDescrPtr & order) const;
+
+    /**
+     * @brief If the order is in the New or Pending state and stuck, rebroadcast it to a
      *        different servicenode.
      */
-    void checkAndRelayPendingOrders();
+    void relayPendingOrder(const TransactionDescrPtr & order, const boost::posix_time::ptime & currentTime);
 
     /**
-     * @brief Check orders on timer and erase if expired.
+     * @brief Update the state of an order that timed out.
+     * @param erase - set if the order should be removed
+     * @return false if the order is busy and has to be checked later
      */
-    void checkAndEraseExpiredTransactions();
+    bool checkOrderExpiry(const TransactionDescrPtr & order, const boost::posix_time::ptime & currentTime, bool & erase);
+
+    /**
+     * @brief Arms the block poll timer (timer thread only).
+     */
+    void armBlocksTimer();
+
+    /**
+     * @brief Polls the block count of all connected wallets (refreshing their utxo check
+     *        caches) and runs the watches of the watched chains that advanced.
+     */
+    void checkWatchedChains();
+
+    /**
+     * @brief Restore the in flight orders from the order journal, lock their coins
+     *        and resume the deposit watches.
+     */
+    void restoreOrders();
+
+    /**
+     * @brief Queue the current state of the order for the order journal.
+     * @param id - order id
+     */
+    void journalOrder(const uint256 & id);
+
+    /**
+     * @brief Order journal lookup, local orders are kept in the journal while they
+     *        are active or their deposit is watched.
+     */
+    bool journalLookup(const uint256 & id, TransactionDescrPtr & order, bool & watched, bool & retain);
 
     /**
      * @brief Check for deposits that were spent by the counterparty.
@@ -197,6 +263,21 @@ protected:
     boost::thread                                      m_timerThread;
     boost::asio::deadline_timer                        m_timer;
 
+    // order deadlines, see scheduleOrderCheck
+    CCriticalSection                                   m_deadlinesLocker;
+    std::multimap<boost::posix_time::ptime, uint256>   m_deadlines;
+    std::map<uint256, boost::posix_time::ptime>        m_orderDeadlines;
+    boost::asio::deadline_timer                        m_deadlineTimer;
+    boost::signals2::connection                        m_orderReceivedConn;
+    boost::signals2::connection                        m_orderChangedConn;
+
+    // new block notifications for chains with watched deposits
+    boost::asio::deadline_timer                        m_blocksTimer;
+    std::map<std::string, uint32_t>                    m_watchedChainBlocks;
+
+    // persistent state of the in flight orders
+    std::unique_ptr<OrderJournal>                      m_journal;
+
     // sessions
     mutable CCriticalSection                           m_sessionsLock;
     SessionQueue                                       m_sessions;
@@ -218,10 +299,11 @@ protected:
     AddressBook                                        m_addressBook;
     std::set<std::string>                              m_addresses;
 
-    // transactions
+    // transactions, readers use the lock free snapshots of the maps,
+    // m_txLocker only serializes moves between live and historic orders
     CCriticalSection                                   m_txLocker;
-    std::map<uint256, TransactionDescrPtr>             m_transactions;
-    std::map<uint256, TransactionDescrPtr>             m_historicTransactions;
+    ShardedMap<TransactionDescrPtr>                    m_transactions;
+    ShardedMap<TransactionDescrPtr>                    m_historicTransactions;
     xSeriesCache                                       m_xSeriesCache;
 
     // network packets queue
@@ -245,6 +327,8 @@ App::Impl::Impl()
     : m_timerIoWork(new boost::asio::io_service::work(m_timerIo))
     , m_timerThread(boost::bind(&boost::asio::io_service::run, &m_timerIo))
     , m_timer(m_timerIo, boost::posix_time::seconds(TIMER_INTERVAL))
+    , m_deadlineTimer(m_timerIo)
+    , m_blocksTimer(m_timerIo)
 {
 
 }
@@ -327,6 +411,18 @@ bool App::Impl::start()
         }
 
         m_timer.async_wait(boost::bind(&Impl::onTimer, this));
+
+        // resume the swaps that were in flight on shutdown
+        restoreOrders();
+
+        // orders are woken on state changes and on their deadlines
+        m_orderReceivedConn = xuiConnector.NotifyXBridgeTransactionReceived.connect(
+            [this](const TransactionDescrPtr & tx) {
+                if (tx) { scheduleOrderCheck(tx->id); journalOrder(tx->id); } });
+        m_orderChangedConn = xuiConnector.NotifyXBridgeTransactionChanged.connect(
+            [this](const uint256 & id) { scheduleOrderCheck(id); journalOrder(id); });
+        m_timerIo.post(boost::bind(&Impl::armOrderDeadlineTimer, this));
+        m_timerIo.post(boost::bind(&Impl::armBlocksTimer, this));
     }
     catch (std::exception & e)
     {
@@ -430,7 +526,12 @@ bool App::Impl::stop()
 {
     LOG() << "stopping xbridge threads...";
 
+    m_orderReceivedConn.disconnect();
+    m_orderChangedConn.disconnect();
+
     m_timer.cancel();
+    m_deadlineTimer.cancel();
+    m_blocksTimer.cancel();
     m_timerIo.stop();
     m_timerIoWork.reset();
     m_timerThread.join();
@@ -446,6 +547,10 @@ bool App::Impl::stop()
 
     m_threads.join_all();
 
+    // write the final order states
+    if (m_journal)
+        m_journal->stop();
+
     return true;
 }
 
@@ -485,11 +590,12 @@ void App::Impl::onSend(const std::vector<unsigned char> & id, const std::vector<
 
     // Relay
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    const CSharedNetMsg relayMsg = CConnman::ShareMessage(msgMaker.Make(NetMsgType::XBRIDGE, msg));
     g_connman->ForEachNode([&](CNode* pnode) {
         if (!pnode->fSuccessfullyConnected)
             return;
         if (pnode->fSuccessfullyConnected && !pnode->fDisconnect && !pnode->fXRouter) // do not relay to xrouter nodes
-            g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::XBRIDGE, msg));
+            g_connman->PushMessage(pnode, relayMsg);
     });
 }
 
@@ -541,13 +647,11 @@ void App::onMessageReceived(const std::vector<unsigned char> & id,
                             const std::vector<unsigned char> & message,
                             CValidationState & /*state*/)
 {
-    if (isKnownMessage(message))
+    if (!addToKnownIfNew(message))
     {
         return;
     }
 
-    addToKnown(message);
-
     if (!Session::checkXBridgePacketVersion(message))
     {
         // TODO state.DoS()
@@ -630,13 +734,11 @@ void App::onMessageReceived(const std::vector<unsigned char> & id,
 void App::onBroadcastReceived(const std::vector<unsigned char> & message,
                               CValidationState & state)
 {
-    if (isKnownMessage(message))
+    if (!addToKnownIfNew(message))
     {
         return;
     }
 
-    addToKnown(message);
-
     if (!Session::checkXBridgePacketVersion(message))
     {
         // TODO state.DoS()
@@ -895,6 +997,7 @@ void App::updateActiveWallets()
         wp.requiredConfirmations       = s.get<int>        (*i + ".Confirmations", 0);
         wp.txWithTimeField             = s.get<bool>       (*i + ".TxWithTimeField", false);
         wp.isLockCoinsSupported        = s.get<bool>       (*i + ".LockCoinsSupported", false);
+        wp.txOutThreads                = s.get<uint32_t>   (*i + ".TxOutThreads", 4);
 
         if (wp.m_ip.empty() || wp.m_port.empty() ||
             wp.m_user.empty() || wp.m_passwd.empty() ||
@@ -1096,6 +1199,18 @@ void App::addToKnown(const std::vector<unsigned char> & message)
     m_p->m_processedMessages.insert(Hash(message.begin(), message.end()));
 }
 
+//*****************************************************************************
+//*****************************************************************************
+bool App::addToKnownIfNew(const std::vector<unsigned char> & message)
+{
+    // test and insert under one lock, a message relayed by several
+    // peers at once must be processed only once
+    LOCK(m_p->m_messagesLock);
+    // clear memory if it's larger than mempool threshold
+    clearMempool();
+    return m_p->m_processedMessages.insert(Hash(message.begin(), message.end())).second;
+}
+
 //*****************************************************************************
 //*****************************************************************************
 void App::addToKnown(const uint256 & hash)
@@ -1113,21 +1228,11 @@ TransactionDescrPtr App::transaction(const uint256 & id) const
 {
     TransactionDescrPtr result;
 
-    LOCK(m_p->m_txLocker);
-
-    if (m_p->m_transactions.count(id))
+    // orders are added to history before they are removed from the
+    // live orders, check live orders first so a moving order is found
+    if (!m_p->m_transactions.get(id, result))
     {
-        result = m_p->m_transactions[id];
-    }
-
-    if (m_p->m_historicTransactions.count(id))
-    {
-        if(result != nullptr) {
-            ERR() << "duplicate transaction " << __FUNCTION__;
-            return result;
-        }
-//        assert(!result && "duplicate objects");
-        result = m_p->m_historicTransactions[id];
+        m_p->m_historicTransactions.get(id, result);
     }
     return result;
 }
@@ -1136,16 +1241,14 @@ TransactionDescrPtr App::transaction(const uint256 & id) const
 //******************************************************************************
 std::map<uint256, xbridge::TransactionDescrPtr> App::transactions() const
 {
-    LOCK(m_p->m_txLocker);
-    return m_p->m_transactions;
+    return m_p->m_transactions.snapshot().toMap();
 }
 
 //******************************************************************************
 //******************************************************************************
 std::map<uint256, xbridge::TransactionDescrPtr> App::history() const
 {
-    LOCK(m_p->m_txLocker);
-    return m_p->m_historicTransactions;
+    return m_p->m_historicTransactions.snapshot().toMap();
 }
 
 //******************************************************************************
@@ -1154,11 +1257,9 @@ std::vector<CurrencyPair> App::history_matches(const App::TransactionFilter& fil
                                           const xQuery& query)
 {
     std::vector<CurrencyPair> matches{};
-    {
-        LOCK(m_p->m_txLocker);
-        for(const auto& it : m_p->m_historicTransactions) {
-            filter(matches, *it.second, query);
-        }
+    const auto history = m_p->m_historicTransactions.snapshot();
+    for(const auto& it : history) {
+        filter(matches, *it.second, query);
     }
     return matches;
 }
@@ -1172,20 +1273,19 @@ App::flushCancelledOrders(bpt::time_duration minAge) const
 {
     std::vector<App::FlushedOrder> list{};
     const bpt::ptime keepTime{bpt::microsec_clock::universal_time() - minAge};
-    const std::vector<TransactionMap*> maps{&m_p->m_transactions, &m_p->m_historicTransactions};
+    const std::vector<ShardedMap<TransactionDescrPtr>*> maps{&m_p->m_transactions, &m_p->m_historicTransactions};
 
     LOCK(m_p->m_txLocker);
 
     for(auto mp : maps) {
-        for(auto it = mp->begin(); it != mp->end(); ) {
-            const TransactionDescrPtr & ptr = it->second;
-            if (ptr->state == xbridge::TransactionDescr::trCancelled
-                && ptr->txtime < keepTime) {
-                list.emplace_back(ptr->id,ptr->txtime,ptr.use_count());
-                mp->erase(it++);
-            } else {
-                ++it;
-            }
+        std::vector<TransactionDescrPtr> erased;
+        mp->eraseIf([&keepTime](const uint256 &, const TransactionDescrPtr & ptr) {
+            return ptr->state == xbridge::TransactionDescr::trCancelled
+                && ptr->txtime < keepTime;
+        }, erased);
+        for (const TransactionDescrPtr & ptr : erased) {
+            // the erased list holds the reference the map held
+            list.emplace_back(ptr->id,ptr->txtime,ptr.use_count());
         }
     }
 
@@ -1198,21 +1298,28 @@ void App::appendTransaction(const TransactionDescrPtr & ptr)
 {
     LOCK(m_p->m_txLocker);
 
-    if (m_p->m_historicTransactions.count(ptr->id))
+    if (m_p->m_historicTransactions.contains(ptr->id))
     {
         return;
     }
 
-    if (!m_p->m_transactions.count(ptr->id))
+    TransactionDescrPtr existing;
+    if (!m_p->m_transactions.get(ptr->id, existing))
     {
         // new transaction, copy data
-        m_p->m_transactions[ptr->id] = ptr;
+        m_p->m_transactions.set(ptr->id, ptr);
     }
     else
     {
         // existing, update timestamp
-        m_p->m_transactions[ptr->id]->updateTimestamp(*ptr);
+        existing->updateTimestamp(*ptr);
     }
+
+    // recompute the order deadline (an updated order may be active again)
+    m_p->scheduleOrderCheck(ptr->id);
+
+    if (ptr->isLocal())
+        m_p->journalOrder(ptr->id);
 }
 
 //******************************************************************************
@@ -1224,28 +1331,20 @@ void App::moveTransactionToHistory(const uint256 & id)
     {
         LOCK(m_p->m_txLocker);
 
-        size_t counter = 0;
-
-        if (m_p->m_transactions.count(id))
-        {
-            xtx = m_p->m_transactions[id];
-
-            counter = m_p->m_transactions.erase(id);
-            if(counter > 1) {
-                ERR() << "duplicate transaction id = " << id.GetHex() << " " << __FUNCTION__;
-            }
-        }
-
-        if (xtx)
+        if (m_p->m_transactions.get(id, xtx))
         {
-            if(m_p->m_historicTransactions.count(id) != 0) {
+            if (!m_p->m_historicTransactions.insert(id, xtx)) {
                 ERR() << "duplicate tx " << id.GetHex() << " in tx list and history " << __FUNCTION__;
                 return;
             }
-            m_p->m_historicTransactions[id] = xtx;
+            // remove from live orders only after the order is in history, see transaction()
+            m_p->m_transactions.erase(id);
         }
     }
 
+    if (xtx)
+        m_p->journalOrder(id);
+
     if (xtx)
     {
         // unlock tx coins
@@ -1477,10 +1576,9 @@ xbridge::Error App::sendXBridgeTransaction(const std::string & from,
     // try send immediatelly
     m_p->sendPendingTransaction(ptr);
 
-    {
-        LOCK(m_p->m_txLocker);
-        m_p->m_transactions[id] = ptr;
-    }
+    m_p->m_transactions.set(id, ptr);
+    m_p->scheduleOrderCheck(id);
+    m_p->journalOrder(id);
 
     LOG() << "order created" << ptr << __FUNCTION__;
 
@@ -1568,15 +1666,10 @@ Error App::acceptXBridgeTransaction(const uint256     & id,
 //        return res;
 //    }
 
+    if (!m_p->m_transactions.get(id, ptr))
     {
-        LOCK(m_p->m_txLocker);
-        if (!m_p->m_transactions.count(id))
-        {
-
-            WARN() << "transaction not found " << __FUNCTION__;
-            return xbridge::TRANSACTION_NOT_FOUND;
-        }
-        ptr = m_p->m_transactions[id];
+        WARN() << "transaction not found " << __FUNCTION__;
+        return xbridge::TRANSACTION_NOT_FOUND;
     }
 
     WalletConnectorPtr connFrom = connectorByCurrency(ptr->fromCurrency);
@@ -2002,8 +2095,11 @@ Error App::checkAmount(const std::string & currency,
 bool App::watchForSpentDeposit(TransactionDescrPtr tr) {
     if (tr == nullptr)
         return false;
-    LOCK(m_p->m_watchDepositsLocker);
-    m_p->m_watchDeposits[tr->id] = tr;
+    {
+        LOCK(m_p->m_watchDepositsLocker);
+        m_p->m_watchDeposits[tr->id] = tr;
+    }
+    m_p->journalOrder(tr->id);
     return true;
 }
 
@@ -2016,8 +2112,11 @@ bool App::watchForSpentDeposit(TransactionDescrPtr tr) {
 void App::unwatchSpentDeposit(TransactionDescrPtr tr) {
     if (tr == nullptr)
         return;
-    LOCK(m_p->m_watchDepositsLocker);
-    m_p->m_watchDeposits.erase(tr->id);
+    {
+        LOCK(m_p->m_watchDepositsLocker);
+        m_p->m_watchDeposits.erase(tr->id);
+    }
+    m_p->journalOrder(tr->id);
 }
 
 //******************************************************************************
@@ -2490,53 +2589,42 @@ bool App::selectUtxos(const std::string &addr, const std::vector<wallet::UtxoEnt
 
 //******************************************************************************
 //******************************************************************************
-void App::Impl::checkAndRelayPendingOrders() {
-    // Try and rebroadcast my orders older than N seconds (see below)
-    auto currentTime = boost::posix_time::second_clock::universal_time();
-    std::map<uint256, TransactionDescrPtr> txs;
-    {
-        LOCK(m_txLocker);
-        txs = m_transactions;
-    }
-    if (txs.empty())
+void App::Impl::relayPendingOrder(const TransactionDescrPtr & order, const boost::posix_time::ptime & currentTime)
+{
+    if (!order->isLocal()) // only process local orders
         return;
 
-    for (const auto & i : txs) {
-        TransactionDescrPtr order = i.second;
-        if (!order->isLocal()) // only process local orders
-            continue;
-
-        auto pendingOrderShouldRebroadcast = (currentTime - order->txtime).total_seconds() >= 240; // 4min
-        auto newOrderShouldRebroadcast = (currentTime - order->txtime).total_seconds() >= 15; // 15sec
-
-        if (newOrderShouldRebroadcast && order->state == xbridge::TransactionDescr::trNew)
-        {
-            // exclude the old snode
-            CPubKey oldsnode;
-            oldsnode.Set(order->sPubKey.begin(), order->sPubKey.end());
-            order->excludeNode(oldsnode);
-
-            // Pick new servicenode
-            std::set<std::string> currencies{order->fromCurrency, order->toCurrency};
-            CPubKey snode;
-            auto notIn = order->excludedNodes();
-            if (!xbridge::App::instance().findNodeWithService(currencies, snode, notIn)) {
-                LOG() << "order may be stuck, failed to find servicenode for order "
-                      << order->id.ToString() << " " << __FUNCTION__;
-                continue;
-            } else {
-                // assign new snode
-                order->assignServicenode(snode);
-            }
-
-            // Broadcast the order
-            order->updateTimestamp();
-            sendPendingTransaction(order);
-        }
-        else if (pendingOrderShouldRebroadcast && order->state == xbridge::TransactionDescr::trPending) {
-            order->updateTimestamp();
-            sendPendingTransaction(order);
+    // Try and rebroadcast my orders older than N seconds (see below)
+    auto pendingOrderShouldRebroadcast = (currentTime - order->txtime).total_seconds() >= PENDING_ORDER_RELAY_INTERVAL; // 4min
+    auto newOrderShouldRebroadcast = (currentTime - order->txtime).total_seconds() >= NEW_ORDER_RELAY_INTERVAL; // 15sec
+
+    if (newOrderShouldRebroadcast && order->state == xbridge::TransactionDescr::trNew)
+    {
+        // exclude the old snode
+        CPubKey oldsnode;
+        oldsnode.Set(order->sPubKey.begin(), order->sPubKey.end());
+        order->excludeNode(oldsnode);
+
+        // Pick new servicenode
+        std::set<std::string> currencies{order->fromCurrency, order->toCurrency};
+        CPubKey snode;
+        auto notIn = order->excludedNodes();
+        if (!xbridge::App::instance().findNodeWithService(currencies, snode, notIn)) {
+            LOG() << "order may be stuck, failed to find servicenode for order "
+                  << order->id.ToString() << " " << __FUNCTION__;
+            return;
+        } else {
+            // assign new snode
+            order->assignServicenode(snode);
         }
+
+        // Broadcast the order
+        order->updateTimestamp();
+        sendPendingTransaction(order);
+    }
+    else if (pendingOrderShouldRebroadcast && order->state == xbridge::TransactionDescr::trPending) {
+        order->updateTimestamp();
+        sendPendingTransaction(order);
     }
 }
 
@@ -2745,86 +2833,359 @@ void App::Impl::watchTraderDeposits()
 
 //*****************************************************************************
 //*****************************************************************************
-void App::Impl::checkAndEraseExpiredTransactions()
+bool App::Impl::checkOrderExpiry(const TransactionDescrPtr & tx, const boost::posix_time::ptime & currentTime, bool & erase)
 {
-    // check xbridge transactions
-    Exchange & e = Exchange::instance();
-    e.eraseExpiredTransactions();
+    erase = false;
+    bool stateChanged = false;
+    {
+        TRY_LOCK(tx->_lock, txlock);
+        if (!txlock)
+        {
+            return false;
+        }
+        boost::posix_time::time_duration td = currentTime - tx->txtime;
+        boost::posix_time::time_duration tc = currentTime - tx->created;
+        if (tx->state == xbridge::TransactionDescr::trNew &&
+            td.total_seconds() > xbridge::Transaction::pendingTTL)
+        {
+            tx->state = xbridge::TransactionDescr::trOffline;
+            stateChanged = true;
+        }
+        else if (tx->state == xbridge::TransactionDescr::trPending &&
+                 td.total_seconds() > xbridge::Transaction::pendingTTL)
+        {
+            tx->state = xbridge::TransactionDescr::trExpired;
+            stateChanged = true;
+        }
+        else if ((tx->state == xbridge::TransactionDescr::trExpired ||
+                  tx->state == xbridge::TransactionDescr::trOffline) &&
+                 td.total_seconds() < xbridge::Transaction::pendingTTL)
+        {
+            tx->state = xbridge::TransactionDescr::trPending;
+            stateChanged = true;
+        }
+        else if ((tx->state == xbridge::TransactionDescr::trExpired ||
+                  tx->state == xbridge::TransactionDescr::trOffline) &&
+                 td.total_seconds() > xbridge::Transaction::TTL)
+        {
+            erase = true;
+        }
+        else if (tx->state == xbridge::TransactionDescr::trPending &&
+                 tc.total_seconds() > xbridge::Transaction::deadlineTTL)
+        {
+            erase = true;
+        }
+    }
+    if (stateChanged)
+    {
+        xuiConnector.NotifyXBridgeTransactionChanged(tx->id);
+    }
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+boost::posix_time::ptime App::Impl::nextOrderDeadline(const TransactionDescrPtr & order) const
+{
+    using boost::posix_time::seconds;
+
+    boost::posix_time::ptime next; // not_a_date_time
+    auto earliest = [&next](const boost::posix_time::ptime & t) {
+        if (next.is_not_a_date_time() || t < next)
+            next = t;
+    };
 
-    // check client transactions
-    auto currentTime = boost::posix_time::microsec_clock::universal_time();
-    std::map<uint256, TransactionDescrPtr> txs;
-    std::set<uint256> forErase;
+    // the ttl checks are strict, wake one second after they pass
+    LOCK(order->_lock);
+    switch (order->state)
     {
-        LOCK(m_txLocker);
-        txs = m_transactions;
+        case xbridge::TransactionDescr::trNew:
+            earliest(order->txtime + seconds(xbridge::Transaction::pendingTTL + 1));
+            if (order->isLocal())
+                earliest(order->txtime + seconds(static_cast<int>(NEW_ORDER_RELAY_INTERVAL)));
+            break;
+        case xbridge::TransactionDescr::trPending:
+            earliest(order->txtime + seconds(xbridge::Transaction::pendingTTL + 1));
+            earliest(order->created + seconds(xbridge::Transaction::deadlineTTL + 1));
+            if (order->isLocal())
+                earliest(order->txtime + seconds(static_cast<int>(PENDING_ORDER_RELAY_INTERVAL)));
+            break;
+        case xbridge::TransactionDescr::trExpired:
+        case xbridge::TransactionDescr::trOffline:
+            // reactivation is driven by timestamp updates, see appendTransaction
+            earliest(order->txtime + seconds(xbridge::Transaction::TTL + 1));
+            break;
+        default:
+            break;
     }
-    if (txs.empty())
+
+    return next;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void App::Impl::checkOrder(const uint256 & id)
+{
+    TransactionDescrPtr order;
+    if (!m_transactions.get(id, order))
+        return; // moved to history or erased
+
+    const auto currentTime = boost::posix_time::microsec_clock::universal_time();
+
+    relayPendingOrder(order, currentTime);
+
+    bool erase = false;
+    if (!checkOrderExpiry(order, currentTime, erase))
     {
+        // order is busy, try again shortly
+        scheduleOrderCheck(id, currentTime + boost::posix_time::seconds(1));
         return;
     }
-    // check...
-    for (const std::pair<uint256, TransactionDescrPtr> & i : txs)
+    if (erase)
     {
-        TransactionDescrPtr tx = i.second;
-        bool stateChanged = false;
+        m_transactions.erase(id);
+        return;
+    }
+
+    auto next = nextOrderDeadline(order);
+    if (next.is_not_a_date_time())
+        return; // no timed work in this state, state changes wake the order
+
+    // still due (e.g. no servicenode to relay to), retry on the next interval
+    if (next <= currentTime)
+        next = currentTime + boost::posix_time::seconds(static_cast<int>(TIMER_INTERVAL));
+
+    scheduleOrderCheck(id, next);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void App::Impl::scheduleOrderCheck(const uint256 & id, const boost::posix_time::ptime & when)
+{
+    const auto deadline = when.is_not_a_date_time()
+                        ? boost::posix_time::microsec_clock::universal_time() : when;
+    {
+        LOCK(m_deadlinesLocker);
+        auto it = m_orderDeadlines.find(id);
+        if (it != m_orderDeadlines.end())
         {
-            TRY_LOCK(tx->_lock, txlock);
-            if (!txlock)
-            {
-                continue;
-            }
-            boost::posix_time::time_duration td = currentTime - tx->txtime;
-            boost::posix_time::time_duration tc = currentTime - tx->created;
-            if (tx->state == xbridge::TransactionDescr::trNew &&
-                td.total_seconds() > xbridge::Transaction::pendingTTL)
-            {
-                tx->state = xbridge::TransactionDescr::trOffline;
-                stateChanged = true;
-            }
-            else if (tx->state == xbridge::TransactionDescr::trPending &&
-                     td.total_seconds() > xbridge::Transaction::pendingTTL)
-            {
-                tx->state = xbridge::TransactionDescr::trExpired;
-                stateChanged = true;
-            }
-            else if ((tx->state == xbridge::TransactionDescr::trExpired ||
-                      tx->state == xbridge::TransactionDescr::trOffline) &&
-                     td.total_seconds() < xbridge::Transaction::pendingTTL)
-            {
-                tx->state = xbridge::TransactionDescr::trPending;
-                stateChanged = true;
-            }
-            else if ((tx->state == xbridge::TransactionDescr::trExpired ||
-                      tx->state == xbridge::TransactionDescr::trOffline) &&
-                     td.total_seconds() > xbridge::Transaction::TTL)
-            {
-                forErase.insert(i.first);
-            }
-            else if (tx->state == xbridge::TransactionDescr::trPending &&
-                     tc.total_seconds() > xbridge::Transaction::deadlineTTL)
+            if (it->second <= deadline)
+                return; // already scheduled earlier
+
+            auto range = m_deadlines.equal_range(it->second);
+            for (auto i = range.first; i != range.second; ++i)
             {
-                forErase.insert(i.first);
+                if (i->second == id)
+                {
+                    m_deadlines.erase(i);
+                    break;
+                }
             }
         }
-        if (stateChanged)
+
+        const bool earliest = m_deadlines.empty() || deadline < m_deadlines.begin()->first;
+        m_orderDeadlines[id] = deadline;
+        m_deadlines.emplace(deadline, id);
+        if (!earliest)
+            return;
+    }
+
+    // timers are not threadsafe, rearm on the timer thread
+    m_timerIo.post(boost::bind(&Impl::armOrderDeadlineTimer, this));
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void App::Impl::armOrderDeadlineTimer()
+{
+    boost::posix_time::ptime next;
+    {
+        LOCK(m_deadlinesLocker);
+        if (m_deadlines.empty())
+            return;
+        next = m_deadlines.begin()->first;
+    }
+
+    m_deadlineTimer.expires_at(next);
+    m_deadlineTimer.async_wait(boost::bind(&Impl::onOrderDeadline, this, boost::asio::placeholders::error));
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void App::Impl::onOrderDeadline(const boost::system::error_code & error)
+{
+    if (error == boost::asio::error::operation_aborted)
+        return; // rearmed or stopped
+
+    std::vector<uint256> due;
+    {
+        LOCK(m_deadlinesLocker);
+        const auto currentTime = boost::posix_time::microsec_clock::universal_time();
+        while (!m_deadlines.empty() && m_deadlines.begin()->first <= currentTime)
         {
-            xuiConnector.NotifyXBridgeTransactionChanged(tx->id);
+            due.push_back(m_deadlines.begin()->second);
+            m_orderDeadlines.erase(m_deadlines.begin()->second);
+            m_deadlines.erase(m_deadlines.begin());
         }
     }
-    // ...erase expired...
+
+    for (const uint256 & id : due)
     {
-        LOCK(m_txLocker);
-        for (const uint256 & id : forErase)
+        m_services.push_back(m_services.front());
+        m_services.pop_front();
+        m_services.front()->post(boost::bind(&Impl::checkOrder, this, id));
+    }
+
+    armOrderDeadlineTimer();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void App::Impl::armBlocksTimer()
+{
+    m_blocksTimer.expires_from_now(boost::posix_time::seconds(static_cast<int>(BLOCK_POLL_INTERVAL)));
+    m_blocksTimer.async_wait([this](const boost::system::error_code & error) {
+        if (error == boost::asio::error::operation_aborted)
+            return;
+        // rpc calls must not block the timer thread
+        m_services.push_back(m_services.front());
+        m_services.pop_front();
+        m_services.front()->post(boost::bind(&Impl::checkWatchedChains, this));
+    });
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void App::Impl::checkWatchedChains()
+{
+    std::set<std::string> depositChains;
+    {
+        LOCK(m_watchDepositsLocker);
+        for (const auto & item : m_watchDeposits)
+            depositChains.insert(item.second->fromCurrency);
+    }
+    std::set<std::string> traderChains;
+    {
+        LOCK(m_watchTradersLocker);
+        for (const auto & item : m_watchTraders)
         {
-            m_transactions.erase(id);
+            traderChains.insert(item.second->a_currency());
+            traderChains.insert(item.second->b_currency());
         }
     }
-    // ...and notify
-//    for (const uint256 & id : forErase)
-//    {
-//        xuiConnector.NotifyXBridgeTransactionRemoved(id);
-//    }
+
+    std::set<std::string> chains(depositChains);
+    chains.insert(traderChains.begin(), traderChains.end());
+
+    // only one check runs at a time (the timer is rearmed when done),
+    // m_watchedChainBlocks needs no lock
+    std::set<std::string> newBlocks;
+    xbridge::App & app = xbridge::App::instance();
+    for (const WalletConnectorPtr & conn : app.connectors())
+    {
+        uint32_t blocks = 0;
+        if (!conn || !conn->getBlockCount(blocks))
+            continue;
+        // the utxo check cache is valid for the polled block
+        conn->setBlockCount(blocks);
+        const std::string & currency = conn->currency;
+        if (!chains.count(currency))
+            continue;
+        uint32_t & lastBlocks = m_watchedChainBlocks[currency];
+        if (lastBlocks != blocks)
+        {
+            lastBlocks = blocks;
+            newBlocks.insert(currency);
+        }
+    }
+
+    auto advanced = [&newBlocks](const std::set<std::string> & watched) {
+        for (const std::string & currency : watched)
+        {
+            if (newBlocks.count(currency))
+                return true;
+        }
+        return false;
+    };
+
+    if (advanced(depositChains))
+        checkWatchesOnDepositSpends();
+    if (advanced(traderChains))
+        watchTraderDeposits();
+
+    m_timerIo.post(boost::bind(&Impl::armBlocksTimer, this));
+}
+
+//******************************************************************************
+//******************************************************************************
+void App::Impl::restoreOrders()
+{
+    m_journal.reset(new OrderJournal(GetDataDir() / "xbridge"));
+
+    std::vector<OrderJournal::Entry> entries;
+    if (!m_journal->load(entries))
+    {
+        // keep the files for manual recovery, don't overwrite them
+        ERR() << "order journal is not available, orders in flight are not persisted " << __FUNCTION__;
+        m_journal.reset();
+        return;
+    }
+
+    xbridge::App & xapp = xbridge::App::instance();
+    for (const OrderJournal::Entry & entry : entries)
+    {
+        const TransactionDescrPtr & order = entry.order;
+        const bool active = order->state != TransactionDescr::trFinished &&
+                            order->state != TransactionDescr::trCancelled &&
+                            order->state != TransactionDescr::trDropped &&
+                            order->state != TransactionDescr::trInvalid;
+        if (active)
+        {
+            m_transactions.set(order->id, order);
+            xapp.lockCoins(order->fromCurrency, order->usedCoins);
+            xapp.lockFeeUtxos(order->feeUtxos);
+            scheduleOrderCheck(order->id);
+        }
+        else
+        {
+            m_historicTransactions.set(order->id, order);
+        }
+
+        if (entry.watched)
+        {
+            LOCK(m_watchDepositsLocker);
+            m_watchDeposits[order->id] = order;
+        }
+
+        LOG() << "restored order " << order->id.GetHex() << " state " << order->strState()
+              << (entry.watched ? " (watching deposit)" : "") << " " << __FUNCTION__;
+    }
+
+    m_journal->start(boost::bind(&Impl::journalLookup, this, _1, _2, _3, _4));
+}
+
+//******************************************************************************
+//******************************************************************************
+void App::Impl::journalOrder(const uint256 & id)
+{
+    if (m_journal)
+        m_journal->update(id);
+}
+
+//******************************************************************************
+//******************************************************************************
+bool App::Impl::journalLookup(const uint256 & id, TransactionDescrPtr & order, bool & watched, bool & retain)
+{
+    const bool live = m_transactions.get(id, order);
+    if (!live && !m_historicTransactions.get(id, order))
+        return false;
+
+    {
+        LOCK(m_watchDepositsLocker);
+        watched = m_watchDeposits.count(id) > 0;
+    }
+    retain = order->isLocal() && (live || watched);
+    return true;
 }
 
 //******************************************************************************
@@ -2851,16 +3212,15 @@ void App::Impl::onTimer()
             io->post(boost::bind(&xbridge::App::updateActiveWallets, app));
         }
 
-        // Check orders
-        io->post(boost::bind(&Impl::checkAndRelayPendingOrders, this));
-
-        // erase expired tx
-        io->post(boost::bind(&Impl::checkAndEraseExpiredTransactions, this));
-
+        // erase expired exchange orders, local orders are woken
+        // on their own deadlines (see scheduleOrderCheck)
         Exchange & e = Exchange::instance();
+        io->post(boost::bind(&Exchange::eraseExpiredTransactions, &e));
+
         auto isServicenode = e.isStarted();
 
-        // Check for deposit spends
+        // Check for deposit spends in the mempool, new blocks are
+        // handled as soon as they're seen by checkWatchedChains
         if (!isServicenode) // if not servicenode, watch deposits
             io->post(boost::bind(&Impl::checkWatchesOnDepositSpends, this));
 
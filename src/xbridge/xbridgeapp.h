@@ -399,6 +399,12 @@ public:
      */
     void addToKnown(const std::vector<unsigned char> & message);
     void addToKnown(const uint256 & hash);
+    /**
+     * @brief addToKnownIfNew - atomically checks message status and adds it to processed messages
+     * @param message
+     * @return true, if message was not known before
+     */
+    bool addToKnownIfNew(const std::vector<unsigned char> & message);
 
     //
     /**
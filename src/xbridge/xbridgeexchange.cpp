@@ -842,14 +842,14 @@ bool Exchange::makerUtxosAreStillValid(const TransactionPtr & tx)
     if (!makerConn) // non-fatal just skip
         return true;
 
-    auto & makerUtxos = tx->a_utxos();
-    for (auto entry : makerUtxos) {
-        if (!makerConn->getTxOut(entry)) {
-            // Invalid utxos cancel order
-            ERR() << "bad maker utxo in order " << tx->id().ToString() << " , utxo txid " << entry.txId << " vout " << entry.vout
-                  << " " << __FUNCTION__;
-            return false;
-        }
+    auto makerUtxos = tx->a_utxos();
+    std::vector<wallet::UtxoEntry> badUtxos;
+    if (!makerConn->getTxOuts(makerUtxos, badUtxos)) {
+        // Invalid utxos cancel order
+        const auto & entry = badUtxos.front();
+        ERR() << "bad maker utxo in order " << tx->id().ToString() << " , utxo txid " << entry.txId << " vout " << entry.vout
+              << " " << __FUNCTION__;
+        return false;
     }
 
     return true; // done
@@ -0,0 +1,550 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//*****************************************************************************
+//*****************************************************************************
+
+#include <xbridge/xbridgeorderjournal.h>
+
+#include <xbridge/util/logger.h>
+#include <xbridge/util/xutil.h>
+
+#include <clientversion.h>
+#include <crypto/common.h>
+#include <hash.h>
+#include <streams.h>
+#include <util/system.h>
+
+#include <cstring>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace xbridge
+{
+
+namespace
+{
+
+enum
+{
+    SNAPSHOT_MAGIC = 0x4a4f4258, // XBOJ
+    SNAPSHOT_VERSION = 1,
+    ORDER_VERSION = 1,
+
+    // compact once the journal holds this many records and
+    // at least twice as many records as there are live orders
+    COMPACT_RECORDS = 1000
+};
+
+enum RecordType : uint8_t
+{
+    recUpdate = 1,
+    recErase = 2
+};
+
+// record framing: size (4) | checksum (4) | payload
+const size_t RECORD_HEADER_SIZE = 8;
+
+//*****************************************************************************
+//*****************************************************************************
+uint64_t doubleToBits(const double value)
+{
+    uint64_t bits;
+    static_assert(sizeof(bits) == sizeof(value), "unexpected double size");
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bitsToDouble(const uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void serializeUtxo(CDataStream & s, const wallet::UtxoEntry & u)
+{
+    s << u.txId << u.vout << doubleToBits(u.amount) << u.address << u.scriptPubKey
+      << u.confirmations << u.hasConfirmations << u.rawAddress << u.signature;
+}
+
+void unserializeUtxo(CDataStream & s, wallet::UtxoEntry & u)
+{
+    uint64_t amount;
+    s >> u.txId >> u.vout >> amount >> u.address >> u.scriptPubKey
+      >> u.confirmations >> u.hasConfirmations >> u.rawAddress >> u.signature;
+    u.amount = bitsToDouble(amount);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// requires order lock
+void serializeOrder(CDataStream & s, const TransactionDescr & d)
+{
+    s << static_cast<uint8_t>(ORDER_VERSION);
+
+    s << d.id << d.role << d.hubAddress << d.confirmAddress
+      << d.from << d.fromCurrency << d.fromAmount << d.fromAddr
+      << d.to << d.toCurrency << d.toAmount << d.toAddr
+      << d.lockTime << d.opponentLockTime
+      << static_cast<int32_t>(d.state) << d.reason
+      << timeToInt(d.created) << timeToInt(d.txtime)
+      << d.blockHash;
+
+    s << d.binTxId << d.binTxVout << d.binTx
+      << d.payTxId << d.payTx << d.refTxId << d.refTx;
+
+    s << d.oBinTxId << d.oBinTxVout << d.oHashedSecret << d.oPayTxId
+      << d.oPayTxTries << doubleToBits(d.oOverpayment);
+
+    s << d.lockP2SHAddress << d.lockScript << d.unlockP2SHAddress << d.unlockScript;
+
+    s << d.mPubKey << d.mPrivKey << d.oPubKey << d.xPubKey << d.xPrivKey << d.sPubKey;
+
+    WriteCompactSize(s, d.usedCoins.size());
+    for (const wallet::UtxoEntry & u : d.usedCoins)
+        serializeUtxo(s, u);
+    WriteCompactSize(s, d.feeUtxos.size());
+    for (const wallet::UtxoEntry & u : d.feeUtxos)
+        serializeUtxo(s, u);
+    s << d.rawFeeTx;
+
+    s << d.watchStartBlock << d.watchCurrentBlock << d.watchingDone
+      << d.redeemedCounterpartyDeposit << d.depositSent;
+
+    s << d._excludedSnodes;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void unserializeOrder(CDataStream & s, TransactionDescr & d)
+{
+    uint8_t version;
+    s >> version;
+    if (version != ORDER_VERSION)
+        throw std::ios_base::failure("unknown order version");
+
+    int32_t state;
+    uint64_t created, txtime;
+    s >> d.id >> d.role >> d.hubAddress >> d.confirmAddress
+      >> d.from >> d.fromCurrency >> d.fromAmount >> d.fromAddr
+      >> d.to >> d.toCurrency >> d.toAmount >> d.toAddr
+      >> d.lockTime >> d.opponentLockTime
+      >> state >> d.reason
+      >> created >> txtime
+      >> d.blockHash;
+    d.state   = static_cast<TransactionDescr::State>(state);
+    d.created = intToTime(created);
+    d.txtime  = intToTime(txtime);
+
+    s >> d.binTxId >> d.binTxVout >> d.binTx
+      >> d.payTxId >> d.payTx >> d.refTxId >> d.refTx;
+
+    uint64_t overpayment;
+    s >> d.oBinTxId >> d.oBinTxVout >> d.oHashedSecret >> d.oPayTxId
+      >> d.oPayTxTries >> overpayment;
+    d.oOverpayment = bitsToDouble(overpayment);
+
+    s >> d.lockP2SHAddress >> d.lockScript >> d.unlockP2SHAddress >> d.unlockScript;
+
+    s >> d.mPubKey >> d.mPrivKey >> d.oPubKey >> d.xPubKey >> d.xPrivKey >> d.sPubKey;
+
+    d.usedCoins.resize(ReadCompactSize(s));
+    for (wallet::UtxoEntry & u : d.usedCoins)
+        unserializeUtxo(s, u);
+    const uint64_t feeUtxos = ReadCompactSize(s);
+    for (uint64_t i = 0; i < feeUtxos; ++i)
+    {
+        wallet::UtxoEntry u;
+        unserializeUtxo(s, u);
+        d.feeUtxos.insert(u);
+    }
+    s >> d.rawFeeTx;
+
+    s >> d.watchStartBlock >> d.watchCurrentBlock >> d.watchingDone
+      >> d.redeemedCounterpartyDeposit >> d.depositSent;
+
+    s >> d._excludedSnodes;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+std::vector<unsigned char> makeRecord(const CDataStream & payload)
+{
+    std::vector<unsigned char> record(RECORD_HEADER_SIZE);
+    WriteLE32(record.data(), static_cast<uint32_t>(payload.size()));
+    WriteLE32(record.data() + 4, ReadLE32(Hash(payload.begin(), payload.end()).begin()));
+    record.insert(record.end(), payload.begin(), payload.end());
+    return record;
+}
+
+/**
+ * @brief Reads the next record at offset.
+ * @return false at the end of data or if the record is truncated or corrupted
+ */
+bool nextRecord(const std::vector<char> & data, size_t & offset, CDataStream & payload)
+{
+    if (data.size() - offset < RECORD_HEADER_SIZE)
+        return false;
+
+    const unsigned char * header = reinterpret_cast<const unsigned char *>(data.data() + offset);
+    const uint32_t size = ReadLE32(header);
+    const uint32_t checksum = ReadLE32(header + 4);
+    if (data.size() - offset - RECORD_HEADER_SIZE < size)
+        return false;
+
+    const char * begin = data.data() + offset + RECORD_HEADER_SIZE;
+    if (ReadLE32(Hash(begin, begin + size).begin()) != checksum)
+        return false;
+
+    payload = CDataStream(begin, begin + size, SER_DISK, CLIENT_VERSION);
+    offset += RECORD_HEADER_SIZE + size;
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool readFile(const fs::path & path, std::vector<char> & data)
+{
+    data.clear();
+    if (!fs::exists(path))
+        return true;
+
+    FILE * file = fsbridge::fopen(path, "rb");
+    if (!file)
+        return false;
+
+    char buf[64 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0)
+        data.insert(data.end(), buf, buf + n);
+
+    const bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+} // namespace
+
+//*****************************************************************************
+//*****************************************************************************
+OrderJournal::OrderJournal(const fs::path & directory)
+    : m_snapshotPath(directory / "orders.dat")
+    , m_journalPath(directory / "orders.log")
+{
+}
+
+//*****************************************************************************
+//*****************************************************************************
+OrderJournal::~OrderJournal()
+{
+    stop();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool OrderJournal::load(std::vector<Entry> & entries)
+{
+    TryCreateDirectories(m_snapshotPath.parent_path());
+
+    std::vector<char> snapshot, journal;
+    if (!readFile(m_snapshotPath, snapshot) || !readFile(m_journalPath, journal))
+    {
+        ERR() << "failed to read order journal " << m_journalPath.string() << " " << __FUNCTION__;
+        return false;
+    }
+
+    m_records.clear();
+    m_sequence = 0;
+
+    // records are applied in order, the latest record of an order wins
+    auto apply = [this](CDataStream & payload, const uint64_t minSequence) {
+        const std::vector<unsigned char> record = makeRecord(payload);
+        uint8_t type;
+        uint64_t sequence;
+        uint256 id;
+        payload >> type >> sequence >> id;
+        m_sequence = std::max(m_sequence, sequence);
+        if (sequence <= minSequence)
+            return; // already in the snapshot
+        if (type == recUpdate)
+            m_records[id] = record;
+        else
+            m_records.erase(id);
+    };
+
+    uint64_t snapshotSequence = 0;
+    if (!snapshot.empty())
+    {
+        size_t offset = 0;
+        CDataStream header(SER_DISK, CLIENT_VERSION);
+        try
+        {
+            if (!nextRecord(snapshot, offset, header))
+                throw std::ios_base::failure("bad snapshot header");
+            uint32_t magic, version;
+            header >> magic >> version >> snapshotSequence;
+            if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION)
+                throw std::ios_base::failure("unknown snapshot format");
+
+            CDataStream payload(SER_DISK, CLIENT_VERSION);
+            while (nextRecord(snapshot, offset, payload))
+                apply(payload, 0);
+            if (offset != snapshot.size())
+                throw std::ios_base::failure("corrupted snapshot");
+        }
+        catch (const std::exception & e)
+        {
+            // the snapshot is written atomically, this is not a torn write
+            ERR() << "order journal snapshot " << m_snapshotPath.string()
+                  << " is corrupted: " << e.what() << " " << __FUNCTION__;
+            return false;
+        }
+        m_sequence = std::max(m_sequence, snapshotSequence);
+    }
+
+    size_t offset = 0;
+    size_t replayed = 0;
+    CDataStream payload(SER_DISK, CLIENT_VERSION);
+    try
+    {
+        while (nextRecord(journal, offset, payload))
+        {
+            apply(payload, snapshotSequence);
+            ++replayed;
+        }
+    }
+    catch (const std::exception & e)
+    {
+        ERR() << "bad order journal record: " << e.what() << " " << __FUNCTION__;
+    }
+    if (offset != journal.size())
+    {
+        WARN() << "discarding " << journal.size() - offset
+               << " bytes at the end of the order journal " << __FUNCTION__;
+    }
+
+    for (auto it = m_records.begin(); it != m_records.end(); )
+    {
+        try
+        {
+            const char * begin = reinterpret_cast<const char *>(it->second.data());
+            CDataStream s(begin + RECORD_HEADER_SIZE, begin + it->second.size(), SER_DISK, CLIENT_VERSION);
+            uint8_t type;
+            uint64_t sequence;
+            uint256 id;
+            Entry entry;
+            entry.order.reset(new TransactionDescr);
+            s >> type >> sequence >> id >> entry.watched;
+            unserializeOrder(s, *entry.order);
+            entries.push_back(entry);
+            ++it;
+        }
+        catch (const std::exception & e)
+        {
+            ERR() << "failed to restore order " << it->first.GetHex() << ": " << e.what() << " " << __FUNCTION__;
+            it = m_records.erase(it);
+        }
+    }
+
+    LOG() << "restored " << entries.size() << " orders from the order journal ("
+          << replayed << " journal records) " << __FUNCTION__;
+
+    // start with an empty journal
+    return compact();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void OrderJournal::start(const Lookup & lookup)
+{
+    boost::mutex::scoped_lock l(m_lock);
+    if (m_thread.joinable())
+        return;
+    m_lookup = lookup;
+    m_stop = false;
+    m_thread = boost::thread(&OrderJournal::writerThread, this);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void OrderJournal::stop()
+{
+    {
+        boost::mutex::scoped_lock l(m_lock);
+        if (!m_thread.joinable())
+            return;
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void OrderJournal::update(const uint256 & id)
+{
+    {
+        boost::mutex::scoped_lock l(m_lock);
+        m_dirty.insert(id);
+    }
+    m_cond.notify_one();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void OrderJournal::writerThread()
+{
+    RenameThread("blocknet-xbridge-journal");
+
+    while (true)
+    {
+        std::set<uint256> ids;
+        bool stop;
+        {
+            boost::mutex::scoped_lock l(m_lock);
+            while (m_dirty.empty() && !m_stop)
+                m_cond.wait(l);
+            ids.swap(m_dirty);
+            stop = m_stop;
+        }
+
+        if (!ids.empty())
+            write(ids);
+
+        if (stop)
+            break;
+    }
+
+    compact();
+    if (m_journal)
+    {
+        fclose(m_journal);
+        m_journal = nullptr;
+    }
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void OrderJournal::write(const std::set<uint256> & ids)
+{
+    std::vector<unsigned char> buffer;
+    uint32_t records = 0;
+
+    for (const uint256 & id : ids)
+    {
+        TransactionDescrPtr order;
+        bool watched = false;
+        bool retain = false;
+        const bool found = m_lookup(id, order, watched, retain);
+
+        CDataStream payload(SER_DISK, CLIENT_VERSION);
+        if (found && retain)
+        {
+            payload << static_cast<uint8_t>(recUpdate) << ++m_sequence << id << watched;
+            LOCK(order->_lock);
+            serializeOrder(payload, *order);
+        }
+        else if (m_records.count(id))
+        {
+            payload << static_cast<uint8_t>(recErase) << ++m_sequence << id;
+        }
+        else
+        {
+            continue; // never journaled
+        }
+
+        const std::vector<unsigned char> record = makeRecord(payload);
+        if (found && retain)
+            m_records[id] = record;
+        else
+            m_records.erase(id);
+        buffer.insert(buffer.end(), record.begin(), record.end());
+        ++records;
+    }
+
+    if (buffer.empty())
+        return;
+
+    if (!m_journal && !openJournal())
+        return;
+
+    if (fwrite(buffer.data(), 1, buffer.size(), m_journal) != buffer.size() ||
+        fflush(m_journal) != 0 || !FileCommit(m_journal))
+    {
+        ERR() << "failed to write the order journal " << m_journalPath.string() << " " << __FUNCTION__;
+        // the records are still in memory, write everything with the next snapshot
+        fclose(m_journal);
+        m_journal = nullptr;
+        compact();
+        return;
+    }
+
+    m_journalRecords += records;
+    if (m_journalRecords >= COMPACT_RECORDS && m_journalRecords >= 2 * m_records.size())
+        compact();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool OrderJournal::compact()
+{
+    const fs::path tmp = m_snapshotPath.string() + ".new";
+    FILE * file = fsbridge::fopen(tmp, "wb");
+    if (!file)
+    {
+        ERR() << "failed to create " << tmp.string() << " " << __FUNCTION__;
+        return false;
+    }
+
+    // journal records up to this sequence are contained in the snapshot
+    CDataStream header(SER_DISK, CLIENT_VERSION);
+    header << static_cast<uint32_t>(SNAPSHOT_MAGIC) << static_cast<uint32_t>(SNAPSHOT_VERSION) << m_sequence;
+    std::vector<unsigned char> buffer = makeRecord(header);
+    for (const auto & item : m_records)
+        buffer.insert(buffer.end(), item.second.begin(), item.second.end());
+
+    const bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() &&
+                         fflush(file) == 0 && FileCommit(file);
+    fclose(file);
+    if (!written || !RenameOver(tmp, m_snapshotPath))
+    {
+        ERR() << "failed to write the order journal snapshot " << m_snapshotPath.string() << " " << __FUNCTION__;
+        return false;
+    }
+
+    if (m_journal)
+    {
+        fclose(m_journal);
+        m_journal = nullptr;
+    }
+
+    // truncate the journal, a crash before this point only leaves
+    // records that are skipped by sequence on the next load
+    m_journal = fsbridge::fopen(m_journalPath, "wb");
+    m_journalRecords = 0;
+    if (!m_journal)
+    {
+        ERR() << "failed to open the order journal " << m_journalPath.string() << " " << __FUNCTION__;
+        return false;
+    }
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool OrderJournal::openJournal()
+{
+    m_journal = fsbridge::fopen(m_journalPath, "ab");
+    if (!m_journal)
+    {
+        ERR() << "failed to open the order journal " << m_journalPath.string() << " " << __FUNCTION__;
+        return false;
+    }
+    return true;
+}
+
+} // namespace xbridge
@@ -0,0 +1,116 @@
+// Copyright (c) 2019 The Blocknet developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef BLOCKNET_XBRIDGE_XBRIDGEORDERJOURNAL_H
+#define BLOCKNET_XBRIDGE_XBRIDGEORDERJOURNAL_H
+
+#include <xbridge/xbridgetransactiondescr.h>
+
+#include <fs.h>
+#include <uint256.h>
+
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace xbridge
+{
+
+/**
+ * @brief Append-only binary journal of local order state.
+ *
+ * Order changes only mark the order id dirty, a background thread serializes the
+ * latest state of the dirty orders, appends it to the journal and syncs the file.
+ * Repeated changes of an order between two writes are coalesced and the order path
+ * never waits on disk io. When the journal grows the live records are compacted
+ * into a snapshot file. load() replays the snapshot and the journal, a torn record
+ * at the end of the journal (crash during a write) is discarded.
+ *
+ * The records contain the order keys, the journal is only as safe as the data dir.
+ */
+class OrderJournal
+{
+public:
+    /**
+     * @brief Journal entry restored by load()
+     */
+    struct Entry
+    {
+        TransactionDescrPtr order;
+        bool                watched{false};
+    };
+
+    /**
+     * @brief Returns the order with the specified id, retain is false if the
+     *        order is no longer in flight and its record can be dropped.
+     * @return false if the order is unknown
+     */
+    typedef std::function<bool (const uint256 & id, TransactionDescrPtr & order,
+                                bool & watched, bool & retain)> Lookup;
+
+public:
+    explicit OrderJournal(const fs::path & directory);
+    ~OrderJournal();
+
+    /**
+     * @brief Replay the snapshot and the journal, then rewrite them compacted.
+     * @param entries - restored orders
+     * @return false if the journal could not be read or written
+     */
+    bool load(std::vector<Entry> & entries);
+
+    /**
+     * @brief Start the writer thread.
+     * @param lookup - returns the current state of dirty orders
+     */
+    void start(const Lookup & lookup);
+
+    /**
+     * @brief Write pending changes, compact and stop the writer thread.
+     */
+    void stop();
+
+    /**
+     * @brief Mark the order dirty, the current state is written asynchronously.
+     * @param id - order id
+     */
+    void update(const uint256 & id);
+
+private:
+    void writerThread();
+    void write(const std::set<uint256> & ids);
+    bool compact();
+    bool openJournal();
+
+private:
+    const fs::path                                m_snapshotPath;
+    const fs::path                                m_journalPath;
+
+    boost::mutex                                  m_lock;
+    boost::condition_variable                     m_cond;
+    std::set<uint256>                             m_dirty;
+    bool                                          m_stop{false};
+    boost::thread                                 m_thread;
+    Lookup                                        m_lookup;
+
+    // writer thread only
+    FILE *                                        m_journal{nullptr};
+    uint64_t                                      m_sequence{0};
+    uint32_t                                      m_journalRecords{0};
+    std::map<uint256, std::vector<unsigned char>> m_records;
+};
+
+} // namespace xbridge
+
+#endif // BLOCKNET_XBRIDGE_XBRIDGEORDERJOURNAL_H
@@ -514,13 +514,22 @@ bool Session::Impl::processTransaction(XBridgePacketPtr packet) const
             entry.signature = std::vector<unsigned char>(packet->data()+offset, packet->data()+offset+XBridgePacket::signatureSize);
             offset += XBridgePacket::signatureSize;
 
-            if (!sconn->getTxOut(entry))
-            {
-                LOG() << "not found utxo entry <" << entry.txId
-                      << "> no " << entry.vout << " " << __FUNCTION__;
-                continue;
-            }
+            utxoItems.push_back(entry);
+        }
 
+        // check utxos concurrently
+        std::vector<wallet::UtxoEntry> notFound;
+        sconn->getTxOuts(utxoItems, notFound);
+        for (const wallet::UtxoEntry & entry : notFound)
+        {
+            LOG() << "not found utxo entry <" << entry.txId
+                  << "> no " << entry.vout << " " << __FUNCTION__;
+        }
+
+        std::vector<wallet::UtxoEntry> unspent;
+        unspent.swap(utxoItems);
+        for (const wallet::UtxoEntry & entry : unspent)
+        {
             // check signature
             std::string signature = EncodeBase64(&entry.signature[0], entry.signature.size());
             if (!sconn->verifyMessage(entry.address, entry.toString(), signature))
@@ -872,15 +881,15 @@ bool Session::Impl::processTransactionAccepting(XBridgePacketPtr packet) const
         return true;
     }
 
-    auto & makerUtxos = trPending->a_utxos();
-    for (auto entry : makerUtxos) {
-        if (!makerConn->getTxOut(entry)) {
-            // Invalid utxos cancel order
-            ERR() << "bad maker utxo in order " << id.ToString() << " , utxo txid " << entry.txId << " vout " << entry.vout
-                  << " " << __FUNCTION__;
-            sendCancelTransaction(trPending, crBadUtxo);
-            return false;
-        }
+    auto makerUtxos = trPending->a_utxos();
+    std::vector<wallet::UtxoEntry> badUtxos;
+    if (!makerConn->getTxOuts(makerUtxos, badUtxos)) {
+        // Invalid utxos cancel order
+        const auto & entry = badUtxos.front();
+        ERR() << "bad maker utxo in order " << id.ToString() << " , utxo txid " << entry.txId << " vout " << entry.vout
+              << " " << __FUNCTION__;
+        sendCancelTransaction(trPending, crBadUtxo);
+        return false;
     }
 
     //
@@ -929,13 +938,22 @@ bool Session::Impl::processTransactionAccepting(XBridgePacketPtr packet) const
                                                          packet->data()+offset+XBridgePacket::signatureSize);
             offset += XBridgePacket::signatureSize;
 
-            if (!conn->getTxOut(entry))
-            {
-                LOG() << "not found utxo entry <" << entry.txId
-                      << "> no " << entry.vout << " " << __FUNCTION__;
-                continue;
-            }
+            utxoItems.push_back(entry);
+        }
+
+        // check utxos concurrently
+        std::vector<wallet::UtxoEntry> notFound;
+        conn->getTxOuts(utxoItems, notFound);
+        for (const wallet::UtxoEntry & entry : notFound)
+        {
+            LOG() << "not found utxo entry <" << entry.txId
+                  << "> no " << entry.vout << " " << __FUNCTION__;
+        }
 
+        std::vector<wallet::UtxoEntry> unspent;
+        unspent.swap(utxoItems);
+        for (const wallet::UtxoEntry & entry : unspent)
+        {
             // check signature
             std::string signature = EncodeBase64(&entry.signature[0], entry.signature.size());
             if (!conn->verifyMessage(entry.address, entry.toString(), signature))
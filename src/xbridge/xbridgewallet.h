@@ -79,6 +79,7 @@ public:
         , serviceNodeFee(.015)
         , txWithTimeField(false)
         , isLockCoinsSupported(false)
+        , txOutThreads(4)
     {
         addrPrefix.resize(1, '\0');
         scriptPrefix.resize(1, '\0');
@@ -111,6 +112,7 @@ public:
         requiredConfirmations       = other.requiredConfirmations;
         txWithTimeField             = other.txWithTimeField;
         isLockCoinsSupported        = other.isLockCoinsSupported;
+        txOutThreads                = other.txOutThreads;
         jsonver                     = other.jsonver;
 
         return *this;
@@ -158,6 +160,9 @@ public:
     mutable CCriticalSection     lockedCoinsLocker;
     std::set<wallet::UtxoEntry>  lockedCoins;
 
+    // threads checking order utxos with gettxout (default 4)
+    uint32_t                     txOutThreads;
+
     // json version for use with rpc
     std::string                  jsonver;
 };
@@ -7,8 +7,16 @@
 
 #include <xbridge/xbridgewalletconnector.h>
 #include <xbridge/xbridgetransactiondescr.h>
+#include <xbridge/util/logger.h>
 
 #include <base58.h>
+#include <util/system.h>
+
+#include <atomic>
+
+#include <boost/asio.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
 
 //*****************************************************************************
 //*****************************************************************************
@@ -31,12 +39,35 @@ std::string UtxoEntry::toString() const
 
 } // namespace wallet
 
+//*****************************************************************************
+//*****************************************************************************
+struct WalletConnector::TxOutWorkers
+{
+    boost::asio::io_service                         io;
+    std::unique_ptr<boost::asio::io_service::work>  work;
+    boost::thread_group                             threads;
+    size_t                                          size{0};
+};
+
 //*****************************************************************************
 //*****************************************************************************
 WalletConnector::WalletConnector()
 {
 }
 
+//*****************************************************************************
+//*****************************************************************************
+WalletConnector::~WalletConnector()
+{
+    // no checks are in flight, getTxOuts waits for its jobs
+    if (m_txOutWorkers)
+    {
+        m_txOutWorkers->work.reset();
+        m_txOutWorkers->io.stop();
+        m_txOutWorkers->threads.join_all();
+    }
+}
+
 //******************************************************************************
 //******************************************************************************
 
@@ -87,4 +118,144 @@ std::string WalletConnector::getNewTokenAddress()
     return newaddress;
 }
 
+/**
+ * \brief Record the chain height polled by the app; unspent results cached by getTxOuts
+ * are dropped when it changes.
+ * \param blockCount Current block count of the wallet
+ */
+void WalletConnector::setBlockCount(const uint32_t blockCount)
+{
+    LOCK(m_txOutCacheLock);
+    if (blockCount != m_txOutCacheBlockCount)
+    {
+        m_txOutCache.clear();
+        m_txOutCacheBlockCount = blockCount;
+    }
+}
+
+/**
+ * \brief Check that the specified utxos are unspent; cache misses are requested concurrently.
+ * \param entries Utxos to check. On return only the unspent utxos remain (amount and confirmations populated)
+ * \param notFound Utxos that are spent or unknown to the wallet
+ * \return true if all utxos are unspent.
+ *
+ * Unspent results are cached until the block poll reports a new block (see setBlockCount), so
+ * repeated checks of the same order inputs (e.g. on every order relay) do not require another
+ * gettxout call. Uncached utxos are requested in parallel on the connector's TxOutThreads workers.
+ */
+bool WalletConnector::getTxOuts(std::vector<wallet::UtxoEntry> & entries, std::vector<wallet::UtxoEntry> & notFound)
+{
+    notFound.clear();
+    if (entries.empty())
+        return true;
+
+    std::vector<char> found(entries.size(), 0); // not vector<bool>, written concurrently
+    std::vector<size_t> pending;
+    uint32_t blockCount{0};
+    {
+        LOCK(m_txOutCacheLock);
+        // nothing is cached until the first block poll
+        blockCount = m_txOutCacheBlockCount;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            auto it = m_txOutCache.find(entries[i]);
+            if (it == m_txOutCache.end())
+            {
+                pending.push_back(i);
+                continue;
+            }
+            entries[i].amount = it->amount;
+            if (it->hasConfirmations)
+                entries[i].setConfirmations(it->confirmations);
+            found[i] = 1;
+        }
+    }
+
+    if (!pending.empty())
+    {
+        TxOutWorkers * workers = nullptr;
+        {
+            LOCK(m_txOutWorkersLock);
+            if (!m_txOutWorkers)
+            {
+                m_txOutWorkers.reset(new TxOutWorkers);
+                m_txOutWorkers->work.reset(new boost::asio::io_service::work(m_txOutWorkers->io));
+                m_txOutWorkers->size = std::max<size_t>(txOutThreads, 1);
+                // calling thread participates in the checks
+                for (size_t t = 1; t < m_txOutWorkers->size; ++t)
+                    m_txOutWorkers->threads.create_thread(boost::bind(&boost::asio::io_service::run, &m_txOutWorkers->io));
+            }
+            workers = m_txOutWorkers.get();
+        }
+
+        std::atomic<size_t> next{0};
+        auto check = [this, &entries, &found, &pending, &next]() {
+            for (size_t j = next++; j < pending.size(); j = next++)
+            {
+                try
+                {
+                    found[pending[j]] = getTxOut(entries[pending[j]]) ? 1 : 0;
+                }
+                catch (const std::exception & e)
+                {
+                    ERR() << currency << " gettxout failed " << e.what() << " " << __FUNCTION__;
+                }
+            }
+        };
+
+        boost::mutex mu;
+        boost::condition_variable cv;
+        size_t running = std::min(pending.size(), workers->size) - 1;
+        for (size_t t = 0, n = running; t < n; ++t)
+        {
+            workers->io.post([&check, &mu, &cv, &running]() {
+                check();
+                boost::mutex::scoped_lock l(mu);
+                if (--running == 0)
+                    cv.notify_one();
+            });
+        }
+        check();
+        {
+            // jobs reference this frame, wait for all of them
+            boost::mutex::scoped_lock l(mu);
+            while (running > 0)
+                cv.wait(l);
+        }
+
+        if (blockCount > 0)
+        {
+            LOCK(m_txOutCacheLock);
+            if (blockCount == m_txOutCacheBlockCount)
+            {
+                for (const size_t i : pending)
+                {
+                    if (!found[i])
+                        continue;
+                    wallet::UtxoEntry cached;
+                    cached.txId = entries[i].txId;
+                    cached.vout = entries[i].vout;
+                    cached.amount = entries[i].amount;
+                    if (entries[i].hasConfirmations)
+                        cached.setConfirmations(entries[i].confirmations);
+                    m_txOutCache.insert(cached);
+                }
+            }
+        }
+    }
+
+    std::vector<wallet::UtxoEntry> unspent;
+    unspent.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (found[i])
+            unspent.push_back(std::move(entries[i]));
+        else
+            notFound.push_back(std::move(entries[i]));
+    }
+    entries.swap(unspent);
+
+    return notFound.empty();
+}
+
 } // namespace xbridge
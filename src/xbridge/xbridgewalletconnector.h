@@ -61,6 +61,7 @@ class WalletConnector : public WalletParam
 {
 public:
     WalletConnector();
+    virtual ~WalletConnector();
 
 public:
     WalletConnector & operator = (const WalletParam & other)
@@ -97,6 +98,12 @@ public:
 
     virtual bool getTxOut(wallet::UtxoEntry & entry) = 0;
 
+    bool getTxOuts(std::vector<wallet::UtxoEntry> & entries, std::vector<wallet::UtxoEntry> & notFound);
+
+    virtual bool getBlockCount(uint32_t & blockCount) = 0;
+
+    void setBlockCount(const uint32_t blockCount);
+
     virtual bool sendRawTransaction(const std::string & rawtx,
                                     std::string & txid,
                                     int32_t & errorCode,
@@ -176,6 +183,18 @@ public:
                                  const uint32_t & utxoVoutN, bool & isSpent) = 0;
 
     virtual bool getTransactionsInBlock(const std::string & blockHash, std::vector<std::string> & txids) = 0;
+
+protected:
+    // unspent utxos confirmed at m_txOutCacheBlockCount, see getTxOuts
+    CCriticalSection             m_txOutCacheLock;
+    std::set<wallet::UtxoEntry>  m_txOutCache;
+    uint32_t                     m_txOutCacheBlockCount{0};
+
+private:
+    // gettxout worker threads, started on first use
+    struct TxOutWorkers;
+    CCriticalSection               m_txOutWorkersLock;
+    std::unique_ptr<TxOutWorkers>  m_txOutWorkers;
 };
 
 } // namespace xbridge
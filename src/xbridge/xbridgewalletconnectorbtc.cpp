@@ -260,6 +260,45 @@ bool getblockhash(const std::string & rpcuser, const std::string & rpcpasswd,
     return true;
 }
 
+//*****************************************************************************
+//*****************************************************************************
+bool getblockcount(const std::string & rpcuser, const std::string & rpcpasswd,
+                   const std::string & rpcip, const std::string & rpcport,
+                   uint32_t & blockCount)
+{
+    try
+    {
+        Array params;
+        Object reply = CallRPC(rpcuser, rpcpasswd, rpcip, rpcport, "getblockcount", params);
+
+        // Parse reply
+        const Value & result = find_value(reply, "result");
+        const Value & error  = find_value(reply, "error");
+
+        if (error.type() != null_type)
+        {
+            // Error
+            LOG() << "getblockcount error: " << write_string(error, false);
+            return false;
+        }
+        else if (result.type() != int_type)
+        {
+            // Result
+            LOG() << "getblockcount result is not an int";
+            return false;
+        }
+
+        blockCount = static_cast<uint32_t>(result.get_int());
+    }
+    catch (std::exception & e)
+    {
+        LOG() << "getblockcount exception " << e.what();
+        return false;
+    }
+
+    return true;
+}
+
 //*****************************************************************************
 //*****************************************************************************
 bool listaccounts(const std::string & rpcuser, const std::string & rpcpasswd,
@@ -1635,6 +1674,20 @@ bool BtcWalletConnector<CryptoProvider>::getTxOut(wallet::UtxoEntry & entry)
     return true;
 }
 
+//******************************************************************************
+//******************************************************************************
+template <class CryptoProvider>
+bool BtcWalletConnector<CryptoProvider>::getBlockCount(uint32_t & blockCount)
+{
+    if (!rpc::getblockcount(m_user, m_passwd, m_ip, m_port, blockCount))
+    {
+        LOG() << "rpc::getblockcount failed " << __FUNCTION__;
+        return false;
+    }
+
+    return true;
+}
+
 //******************************************************************************
 //******************************************************************************
 template <class CryptoProvider>
@@ -211,6 +211,8 @@ public:
 
     bool getTxOut(wallet::UtxoEntry & entry);
 
+    bool getBlockCount(uint32_t & blockCount);
+
     bool sendRawTransaction(const std::string & rawtx,
                             std::string & txid,
                             int32_t & errorCode,
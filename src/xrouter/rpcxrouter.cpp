@@ -152,6 +152,70 @@ static UniValue xrGetBlockHash(const JSONRPCRequest& request)
     return uret_xr(xrouter::form_reply(uuid, reply));
 }
 
+static UniValue xrGetBlockAtTime(const JSONRPCRequest& request)
+{
+    if (request.fHelp)
+        throw std::runtime_error(
+            RPCHelpMan{"xrGetBlockAtTime",
+                "\nBlock that was the tip of the longest chain at the specified time.\n",
+                {
+                    {"currency", RPCArg::Type::STR, RPCArg::Optional::NO, "Blockchain to query"},
+                    {"timestamp", RPCArg::Type::NUM, RPCArg::Optional::NO, "UNIX epoch time in seconds"},
+                    {"node_count", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "Number of XRouter nodes to query (default=1) "
+                                                                                  "The most common reply will be returned (i.e. the reply "
+                                                                                  "with the most consensus). To see all reply results use "
+                                                                                  "xrGetReply uuid."},
+                },
+                RPCResult{
+                "{\n"
+                "  \"reply\" : {         (object) Block height and hash\n"
+                "    \"height\" : n,\n"
+                "    \"hash\" : \"xxxx\"\n"
+                "  },\n"
+                "  \"uuid\" : \"xxxx\"   (string) Request uuid\n"
+                "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("xrGetBlockAtTime", "BLOCK 1559347200")
+                  + HelpExampleRpc("xrGetBlockAtTime", "BLOCK 1559347200")
+                },
+            }.ToString());
+    Value js; json_spirit::read_string(request.params.write(), js); Array params = js.get_array();
+
+    if (params.size() < 1)
+    {
+        Object error;
+        error.emplace_back("error", "Currency not specified");
+        error.emplace_back("code", xrouter::INVALID_PARAMETERS);
+        return uret_xr(error);
+    }
+
+    if (params.size() < 2 || params[1].type() != int_type || params[1].get_int64() < 0)
+    {
+        Object error;
+        error.emplace_back("error", "Timestamp not specified");
+        error.emplace_back("code", xrouter::INVALID_PARAMETERS);
+        return uret_xr(error);
+    }
+
+    int consensus{0};
+    if (params.size() >= 3) {
+        consensus = params[2].get_int();
+        if (consensus < 1) {
+            Object error;
+            error.emplace_back("error", "Consensus must be at least 1");
+            error.emplace_back("code", xrouter::INVALID_PARAMETERS);
+            return uret_xr(error);
+        }
+    }
+
+    std::string currency = params[0].get_str();
+    const int64_t time = params[1].get_int64();
+    std::string uuid;
+    std::string reply = xrouter::App::instance().convertTimeToBlockCount(uuid, currency, consensus, time);
+    return uret_xr(xrouter::form_reply(uuid, reply));
+}
+
 static UniValue xrGetBlock(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1359,6 +1423,7 @@ static const CRPCCommand commands[] =
     { "xrouter",      "xrDecodeRawTransaction",          &xrDecodeRawTransaction,         {} },
     { "xrouter",      "xrGetBlockCount",                 &xrGetBlockCount,                {} },
     { "xrouter",      "xrGetBlockHash",                  &xrGetBlockHash,                 {} },
+    { "xrouter",      "xrGetBlockAtTime",                &xrGetBlockAtTime,               {} },
     { "xrouter",      "xrGetBlock",                      &xrGetBlock,                     {} },
     { "xrouter",      "xrGetBlocks",                     &xrGetBlocks,                    {} },
     { "xrouter",      "xrGetTransaction",                &xrGetTransaction,               {} },
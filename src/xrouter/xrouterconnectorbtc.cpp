@@ -209,76 +209,82 @@ std::string BtcWalletConnectorXRouter::sendTransaction(const std::string & trans
     return checkError(CallRPC(m_user, m_passwd, m_ip, m_port, command, { transaction }), BAD_REQUEST);
 }
 
+static std::string errorReply(const std::string & msg, int code)
+{
+    Object o;
+    o.emplace_back("error", msg);
+    o.emplace_back("code", code);
+    return write_string(Value(o), false);
+}
+
 std::string BtcWalletConnectorXRouter::convertTimeToBlockCount(const std::string & timestamp) const
 {
-//    const auto & blockCountObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblockcount", {});
-//    Value res = getResult(blockCountObj);
-//    int blockcount = res.get_int();
-//    if (blockcount <= 51)
-//        return "0";
-//
-//    // Estimate average block creation time from the last 10 blocks
-//    Array paramsGBH { blockcount };
-//    Object blockHashObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblockhash", paramsGBH);
-//    std::string hash = getResult(blockHashObj).get_str();
-//    Array paramsGB { hash };
-//    Object blockObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblock", paramsGB);
-//    Object block = getResult(blockObj).get_obj();
-//    int curblocktime = find_value(block, "time").get_int();
-//
-//    Array paramsGBH2 { blockcount-50 };
-//    blockHashObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblockhash", paramsGBH2);
-//    hash = getResult(blockHashObj).get_str();
-//    Array paramsGB2 { hash };
-//    blockObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblock", paramsGB2);
-//    block = getResult(blockObj).get_obj();
-//    int blocktime50ago = find_value(block, "time").get_int();
-//
-//    int averageBlockTime = (curblocktime - blocktime50ago) / 50;
-//
-//    int time = std::stoi(timestamp);
-//
-//    if (time >= curblocktime)
-//        return std::to_string(blockcount);
-//
-//    int blockEstimate = blockcount - (curblocktime - time) / averageBlockTime;
-//    if (blockEstimate <= 1)
-//        return "0";
-//
-//    Array paramsGBH3 { blockEstimate };
-//    blockHashObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblockhash", paramsGBH3);
-//    hash = getResult(blockHashObj).get_str();
-//    Array paramsGB3 { hash };
-//    blockObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblock", paramsGB3);
-//    block = getResult(blockObj).get_obj();
-//    int cur_estimate = find_value(block, "time").get_int();
-//
-//    int sign = 1;
-//    if (cur_estimate > time)
-//        sign = -1;
-//
-//    while (true) {
-//        blockEstimate += sign;
-//        Array paramsGBH { blockEstimate };
-//        Object blockHashObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblockhash", paramsGBH);
-//        std::string hash = getResult(blockHashObj).get_str();
-//        Array paramsGB { hash };
-//        Object blockObj = CallRPC(m_user, m_passwd, m_ip, m_port, "getblock", paramsGB);
-//        Object block = getResult(blockObj).get_obj();
-//        int new_estimate = find_value(block, "time").get_int();
-//        //std::cout << blockEstimate << " " << new_estimate << " " << cur_estimate << " " << (new_estimate - time) << " " << (cur_estimate - time) << " " << (cur_estimate - time) * (new_estimate - time) << std::endl << std::flush;
-//        int sign1 = (cur_estimate - time > 0) ? 1 : -1;
-//        if (sign1 * (new_estimate - time) < 0) {
-//            if (sign > 0)
-//                return std::to_string(blockEstimate - 1);
-//            else
-//                return std::to_string(blockEstimate);
-//        }
-//
-//        cur_estimate = new_estimate;
-//    }
-    
-    return "0"; // TODO Implement
+    static const std::string commandGBAT("getblockattime");
+    static const std::string commandGBC("getblockcount");
+    static const std::string commandGBH("getblockhash");
+    static const std::string commandGBHD("getblockheader");
+
+    const int64_t time = std::stoll(timestamp);
+
+    // Blocknet wallets look up the time in their block time index
+    const auto & reply = CallRPC(m_user, m_passwd, m_ip, m_port, commandGBAT, { time });
+    if (!hasError(reply))
+        return reply;
+
+    // Otherwise binary search the block times, which costs O(log n) calls.
+    // Block times are not strictly monotonic, the search finds the highest
+    // block at or before the time among the blocks it visits.
+    auto blockAtHeight = [&](const int height, std::string & hash, int64_t & blockTime) -> bool {
+        const auto & hashReply = CallRPC(m_user, m_passwd, m_ip, m_port, commandGBH, { height });
+        if (hasError(hashReply))
+            return false;
+        hash = getResult(hashReply).get_str();
+        const auto & headerReply = CallRPC(m_user, m_passwd, m_ip, m_port, commandGBHD, { hash });
+        if (hasError(headerReply))
+            return false;
+        const Value & timeVal = find_value(getResult(headerReply).get_obj(), "time");
+        if (timeVal.type() != int_type)
+            return false;
+        blockTime = timeVal.get_int64();
+        return true;
+    };
+
+    const auto & countReply = CallRPC(m_user, m_passwd, m_ip, m_port, commandGBC, Array());
+    if (hasError(countReply))
+        return checkError(countReply, BAD_CONNECTOR);
+
+    int lo = 0;
+    int hi = getResult(countReply).get_int();
+    std::string loHash, hiHash;
+    int64_t blockTime;
+    if (!blockAtHeight(hi, hiHash, blockTime))
+        return errorReply("Failed to read the block at height " + std::to_string(hi), BAD_CONNECTOR);
+    if (blockTime <= time) {
+        lo = hi;
+        loHash = hiHash;
+    } else {
+        if (!blockAtHeight(lo, loHash, blockTime))
+            return errorReply("Failed to read the genesis block", BAD_CONNECTOR);
+        if (blockTime > time)
+            return errorReply("Timestamp is before the genesis block", INVALID_PARAMETERS);
+        while (hi - lo > 1) {
+            const int mid = lo + (hi - lo) / 2;
+            std::string midHash;
+            if (!blockAtHeight(mid, midHash, blockTime))
+                return errorReply("Failed to read the block at height " + std::to_string(mid), BAD_CONNECTOR);
+            if (blockTime <= time) {
+                lo = mid;
+                loHash = midHash;
+            } else {
+                hi = mid;
+            }
+        }
+    }
+
+    Object result;
+    result.emplace_back("height", lo);
+    result.emplace_back("hash", loHash);
+    return write_string(Value(result), false);
 }
 
 std::string BtcWalletConnectorXRouter::getBalance(const std::string & address) const
@@ -143,7 +143,7 @@ inline std::set<XRouterCommand> XRouterCommands()
 //    r.insert(xrGenerateBloomFilter);
     r.insert(xrGetBlocks);
     r.insert(xrGetTransactions);
-//    r.insert(xrGetBlockAtTime);
+    r.insert(xrGetBlockAtTime);
     r.insert(xrDecodeRawTransaction);
 //    r.insert(xrGetBalance);
     return r;
@@ -5,6 +5,7 @@
 #include <xrouter/xrouterserver.h>
 
 #include <servicenode/servicenodemgr.h>
+#include <util/strencodings.h>
 #include <xbridge/util/settings.h>
 #include <xrouter/xrouterapp.h>
 #include <xrouter/xroutererror.h>
@@ -388,8 +389,7 @@ void XRouterServer::onMessageReceived(CNode* node, XRouterPacketPtr packet, CVal
 //                        reply = parseResult(processGenerateBloomFilter(service, params));
                         break;
                     case xrGetBlockAtTime:
-                        throw XRouterError("This call is not supported: " + fqService, xrouter::UNSUPPORTED_SERVICE);
-//                        reply = parseResult(processConvertTimeToBlockCount(service, params));
+                        reply = parseResult(processConvertTimeToBlockCount(service, params));
                         break;
                     case xrGetReply:
                         reply = parseResult(processFetchReply(uuid));
@@ -630,6 +630,9 @@ std::string XRouterServer::processGenerateBloomFilter(const std::string & curren
 
 std::string XRouterServer::processConvertTimeToBlockCount(const std::string & currency, const std::vector<std::string> & params) {
     const std::string timestamp(params[0]);
+    int64_t time;
+    if (!ParseInt64(timestamp, &time) || time < 0)
+        throw XRouterError("Bad timestamp " + timestamp, xrouter::INVALID_PARAMETERS);
 
     xrouter::WalletConnectorXRouterPtr conn = connectorByCurrency(currency);
     if (conn && hasConnectorLock(currency)) {
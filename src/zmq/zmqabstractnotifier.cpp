@@ -21,3 +21,18 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyXBridgeOrder(const xbridge::TransactionDescr &/*order*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyXBridgeOrderState(const xbridge::TransactionDescr &/*order*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyXBridgeTrade(const xbridge::TransactionDescr &/*order*/)
+{
+    return true;
+}
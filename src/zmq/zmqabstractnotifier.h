@@ -10,6 +10,10 @@
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+namespace xbridge {
+struct TransactionDescr;
+}
+
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
 class CZMQAbstractNotifier
@@ -43,6 +47,11 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
 
+    // XBridge order events
+    virtual bool NotifyXBridgeOrder(const xbridge::TransactionDescr &order);
+    virtual bool NotifyXBridgeOrderState(const xbridge::TransactionDescr &order);
+    virtual bool NotifyXBridgeTrade(const xbridge::TransactionDescr &order);
+
 protected:
     void *psocket;
     std::string type;
@@ -9,13 +9,21 @@
 #include <validation.h>
 #include <streams.h>
 #include <util/system.h>
+#include <xbridge/xbridgeapp.h>
+#include <xbridge/xbridgetransactiondescr.h>
+#include <xbridge/xuiconnector.h>
+
+#include <functional>
+
+/** Number of finished orders remembered to publish each trade only once */
+static constexpr size_t MAX_XBRIDGE_TRADES = 1000;
 
 void zmqError(const char *str)
 {
     LogPrint(BCLog::ZMQ, "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr), xbridgeTrades(MAX_XBRIDGE_TRADES)
 {
 }
 
@@ -48,6 +56,9 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubxborder"] = CZMQAbstractNotifier::Create<CZMQPublishXBridgeOrderNotifier>;
+    factories["pubxborderstate"] = CZMQAbstractNotifier::Create<CZMQPublishXBridgeOrderStateNotifier>;
+    factories["pubxbtrade"] = CZMQAbstractNotifier::Create<CZMQPublishXBridgeTradeNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -117,6 +128,11 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    connXBridgeOrderReceived = xuiConnector.NotifyXBridgeTransactionReceived.connect(
+            std::bind(&CZMQNotificationInterface::XBridgeOrderReceived, this, std::placeholders::_1));
+    connXBridgeOrderChanged = xuiConnector.NotifyXBridgeTransactionChanged.connect(
+            std::bind(&CZMQNotificationInterface::XBridgeOrderChanged, this, std::placeholders::_1));
+
     return true;
 }
 
@@ -124,8 +140,11 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint(BCLog::ZMQ, "zmq: Shutdown notification interface\n");
+    connXBridgeOrderReceived.disconnect();
+    connXBridgeOrderChanged.disconnect();
     if (pcontext)
     {
+        LOCK(cs_notifiers);
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -138,15 +157,14 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+template <typename Function>
+void CZMQNotificationInterface::TryForEachAndRemoveFailed(Function func)
 {
-    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
-        return;
-
+    LOCK(cs_notifiers);
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindexNew))
+        if (func(notifier))
         {
             i++;
         }
@@ -158,25 +176,76 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, co
     }
 }
 
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
+        return;
+
+    TryForEachAndRemoveFailed([pindexNew](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyBlock(pindexNew);
+    });
+}
+
 void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx)
 {
     // Used by BlockConnected and BlockDisconnected as well, because they're
     // all the same external callback.
     const CTransaction& tx = *ptx;
 
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
+    TryForEachAndRemoveFailed([&tx](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyTransaction(tx);
+    });
+}
+
+// Copies the published fields of an order, xbridge threads update orders under their lock
+static void CopyXBridgeOrder(xbridge::TransactionDescr& order, xbridge::TransactionDescr& copy)
+{
+    LOCK(order._lock);
+    copy.id = order.id;
+    copy.fromCurrency = order.fromCurrency;
+    copy.fromAmount = order.fromAmount;
+    copy.toCurrency = order.toCurrency;
+    copy.toAmount = order.toAmount;
+    copy.state = order.state;
+    copy.created = order.created;
+    copy.txtime = order.txtime;
+}
+
+void CZMQNotificationInterface::XBridgeOrderReceived(const xbridge::TransactionDescrPtr& order)
+{
+    if (!order)
+        return;
+
+    xbridge::TransactionDescr copy;
+    CopyXBridgeOrder(*order, copy);
+    TryForEachAndRemoveFailed([&copy](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyXBridgeOrder(copy);
+    });
+}
+
+void CZMQNotificationInterface::XBridgeOrderChanged(const uint256& id)
+{
+    xbridge::TransactionDescrPtr order = xbridge::App::instance().transaction(id);
+    if (!order)
+        return;
+
+    xbridge::TransactionDescr copy;
+    CopyXBridgeOrder(*order, copy);
+
+    // Orders can be reported in the finished state more than once,
+    // the trade is only published on the transition into it. Repeats
+    // follow the transition closely, only the latest trades are kept.
+    bool finished = false;
+    if (copy.state == xbridge::TransactionDescr::trFinished) {
+        LOCK(cs_notifiers);
+        finished = xbridgeTrades.count(copy.id) == 0;
+        if (finished)
+            xbridgeTrades.insert(std::make_pair(copy.id, ++nXBridgeTrades));
     }
+    TryForEachAndRemoveFailed([&copy, finished](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyXBridgeOrderState(copy) &&
+               (!finished || notifier->NotifyXBridgeTrade(copy));
+    });
 }
 
 void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted)
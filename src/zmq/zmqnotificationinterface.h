@@ -5,14 +5,25 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include <limitedmap.h>
+#include <sync.h>
+#include <uint256.h>
 #include <validationinterface.h>
 #include <string>
 #include <map>
 #include <list>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/signals2/connection.hpp>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+namespace xbridge {
+struct TransactionDescr;
+typedef boost::shared_ptr<TransactionDescr> TransactionDescrPtr;
+}
+
 class CZMQNotificationInterface final : public CValidationInterface
 {
 public:
@@ -32,11 +43,27 @@ protected:
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
 
+    // XBridge (xuiConnector signals)
+    void XBridgeOrderReceived(const xbridge::TransactionDescrPtr& order);
+    void XBridgeOrderChanged(const uint256& id);
+
 private:
     CZMQNotificationInterface();
 
+    // Calls func on every notifier, notifiers that fail are shut down and removed
+    template <typename Function>
+    void TryForEachAndRemoveFailed(Function func);
+
     void *pcontext;
+    // xbridge events are raised on xbridge threads, validation events on the scheduler thread
+    CCriticalSection cs_notifiers;
     std::list<CZMQAbstractNotifier*> notifiers;
+    // latest orders published as xbtrade, by publication order
+    limitedmap<uint256, uint64_t> xbridgeTrades GUARDED_BY(cs_notifiers);
+    uint64_t nXBridgeTrades GUARDED_BY(cs_notifiers){0};
+
+    boost::signals2::connection connXBridgeOrderReceived;
+    boost::signals2::connection connXBridgeOrderChanged;
 };
 
 extern CZMQNotificationInterface* g_zmq_notification_interface;
@@ -9,6 +9,8 @@
 #include <validation.h>
 #include <util/system.h>
 #include <rpc/server.h>
+#include <xbridge/xbridgetransactiondescr.h>
+#include <xbridge/util/xutil.h>
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
@@ -16,6 +18,9 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_XBORDER      = "xborder";
+static const char *MSG_XBORDERSTATE = "xborderstate";
+static const char *MSG_XBTRADE      = "xbtrade";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -206,3 +211,35 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishXBridgeOrderNotifier::NotifyXBridgeOrder(const xbridge::TransactionDescr &order)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish xborder %s\n", order.id.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << order.id
+       << order.fromCurrency << order.fromAmount
+       << order.toCurrency << order.toAmount
+       << static_cast<int32_t>(order.state)
+       << static_cast<int64_t>(xbridge::timeToInt(order.created) / 1000000);
+    return SendMessage(MSG_XBORDER, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishXBridgeOrderStateNotifier::NotifyXBridgeOrderState(const xbridge::TransactionDescr &order)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish xborderstate %s\n", order.id.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << order.id
+       << static_cast<int32_t>(order.state);
+    return SendMessage(MSG_XBORDERSTATE, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishXBridgeTradeNotifier::NotifyXBridgeTrade(const xbridge::TransactionDescr &order)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish xbtrade %s\n", order.id.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << order.id
+       << order.fromCurrency << order.fromAmount
+       << order.toCurrency << order.toAmount
+       << static_cast<int64_t>(xbridge::timeToInt(order.txtime) / 1000000);
+    return SendMessage(MSG_XBTRADE, &(*ss.begin()), ss.size());
+}
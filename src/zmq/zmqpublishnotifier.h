@@ -52,4 +52,22 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+class CZMQPublishXBridgeOrderNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyXBridgeOrder(const xbridge::TransactionDescr &order) override;
+};
+
+class CZMQPublishXBridgeOrderStateNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyXBridgeOrderState(const xbridge::TransactionDescr &order) override;
+};
+
+class CZMQPublishXBridgeTradeNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyXBridgeTrade(const xbridge::TransactionDescr &order) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H